@@ -0,0 +1,295 @@
+// Collection-only EnvSet benchmark
+// Steps an EnvSet the same way the learner does, but with a synthetic policy instead of a model,
+// so numGames, tickSkip, obs builders and rewards can be tuned without libtorch, Python or a training run
+// Reports env steps per second and where the time goes (from the profiler), at 1 thread up to all threads
+// Usage: RG_EnvSetBench [key=value]...
+//	meshes=collision_meshes gameMode=soccar numGames=256 teamSize=1 tickSkip=8 actionDelay=7
+//	obs=default|padded|advanced steps=300 maxThreads=<all> actions=<recorded actions file>
+// The policy is uniform-random over each player's action mask, unless a file of whitespace-separated action indices is given,
+// in which case they are replayed in order (player-major within each step) and looped
+// Built with RG_TRACK_ALLOCS, it also prints heap allocations per arena step by phase,
+//	and assertNoAllocs=1 makes it fail if any step after the warmup allocates
+
+#include <RLGymCPP/EnvSet/EnvSet.h>
+#include <RLGymCPP/Profiler.h>
+#include <RLGymCPP/AllocTracker.h>
+#include <RLGymCPP/ActionParsers/DefaultAction.h>
+#include <RLGymCPP/ObsBuilders/DefaultObs.h>
+#include <RLGymCPP/ObsBuilders/DefaultObsPadded.h>
+#include <RLGymCPP/ObsBuilders/AdvancedObs.h>
+#include <RLGymCPP/Rewards/CommonRewards.h>
+#include <RLGymCPP/Rewards/ZeroSumReward.h>
+#include <RLGymCPP/StateSetters/KickoffState.h>
+#include <RLGymCPP/TerminalConditions/NoTouchCondition.h>
+#include <RLGymCPP/TerminalConditions/GoalScoreCondition.h>
+
+using namespace RLGC;
+
+struct BenchConfig {
+	std::string meshes = "collision_meshes";
+	std::string gameMode = "soccar";
+	int numGames = 256;
+	int teamSize = 1;
+	int tickSkip = 8;
+	int actionDelay = 7;
+	std::string obs = "default";
+	int steps = 300;
+	int maxThreads = std::thread::hardware_concurrency();
+	std::string actions = "";
+	bool assertNoAllocs = false;
+
+	void Set(const std::string& key, const std::string& val) {
+		if (key == "meshes") meshes = val;
+		else if (key == "gameMode") gameMode = val;
+		else if (key == "numGames") numGames = std::stoi(val);
+		else if (key == "teamSize") teamSize = std::stoi(val);
+		else if (key == "tickSkip") tickSkip = std::stoi(val);
+		else if (key == "actionDelay") actionDelay = std::stoi(val);
+		else if (key == "obs") obs = val;
+		else if (key == "steps") steps = std::stoi(val);
+		else if (key == "maxThreads") maxThreads = std::stoi(val);
+		else if (key == "actions") actions = val;
+		else if (key == "assertNoAllocs") assertNoAllocs = std::stoi(val);
+		else RG_ERR_CLOSE("Unknown setting \"" << key << "\"");
+	}
+};
+
+// A typical reward set, so reward time is representative
+EnvCreateResult CreateEnv(const BenchConfig& config, GameMode gameMode) {
+	std::vector<WeightedReward> rewards = {
+		{ new AirReward(), 0.25f },
+		{ new FaceBallReward(), 0.25f },
+		{ new VelocityPlayerToBallReward(), 4 },
+		{ new StrongTouchReward(20, 100), 60 },
+		{ new ZeroSumReward(new VelocityBallToGoalReward(), 1), 2 },
+		{ new PickupBoostReward(), 10 },
+		{ new SaveBoostReward(), 0.2f },
+		{ new ZeroSumReward(new BumpReward(), 0.5f), 20 },
+		{ new GoalReward(), 150 }
+	};
+
+	std::vector<TerminalCondition*> terminalConditions = { new NoTouchCondition(10) };
+	if (gameMode != GameMode::THE_VOID)
+		terminalConditions.push_back(new GoalScoreCondition());
+
+	ObsBuilder* obsBuilder;
+	if (config.obs == "default") {
+		obsBuilder = new DefaultObs();
+	} else if (config.obs == "padded") {
+		obsBuilder = new DefaultObsPadded(3);
+	} else if (config.obs == "advanced") {
+		obsBuilder = new AdvancedObs();
+	} else {
+		RG_ERR_CLOSE("Unknown obs builder \"" << config.obs << "\" (should be default, padded or advanced)");
+	}
+
+	Arena* arena = Arena::Create(gameMode);
+	for (int i = 0; i < config.teamSize; i++) {
+		arena->AddCar(Team::BLUE);
+		arena->AddCar(Team::ORANGE);
+	}
+
+	EnvCreateResult result = {};
+	result.arena = arena;
+	result.rewards = rewards;
+	result.terminalConditions = terminalConditions;
+	result.obsBuilder = obsBuilder;
+	result.actionParser = new DefaultAction();
+	result.stateSetter = new KickoffState();
+	return result;
+}
+
+struct SyntheticPolicy {
+	std::vector<int> recordedActions = {};
+	size_t recordedIdx = 0;
+	std::mt19937 rng = std::mt19937(0);
+	std::vector<int> allowed = {}; // Kept between steps so the policy doesn't allocate
+
+	void GetActions(const DimList2<uint8_t>& actionMasks, IList& outActions) {
+		int numPlayers = actionMasks.size[0], numActions = actionMasks.size[1];
+		outActions.resize(numPlayers);
+
+		if (!recordedActions.empty()) {
+			for (int i = 0; i < numPlayers; i++) {
+				outActions[i] = recordedActions[recordedIdx] % numActions;
+				recordedIdx = (recordedIdx + 1) % recordedActions.size();
+			}
+			return;
+		}
+
+		allowed.reserve(numActions);
+		for (int i = 0; i < numPlayers; i++) {
+			allowed.clear();
+			const uint8_t* mask = actionMasks.data.data() + i * numActions;
+			for (int j = 0; j < numActions; j++)
+				if (mask[j])
+					allowed.push_back(j);
+
+			outActions[i] = allowed.empty() ? 0 : allowed[std::uniform_int_distribution<int>(0, allowed.size() - 1)(rng)];
+		}
+	}
+};
+
+EnvSet* MakeEnvSet(const BenchConfig& config, GameMode gameMode, ThreadPool* threadPool) {
+	EnvSetConfig envSetConfig = {};
+	envSetConfig.envCreateFn = [=](int idx) { return CreateEnv(config, gameMode); };
+	envSetConfig.numArenas = config.numGames;
+	envSetConfig.tickSkip = config.tickSkip;
+	envSetConfig.actionDelay = config.actionDelay;
+	envSetConfig.saveRewards = false;
+	envSetConfig.threadPool = threadPool;
+	return new EnvSet(envSetConfig);
+}
+
+// Mirrors the learner's collection loop, with the policy running while the first half steps
+static void RunSteps(EnvSet* envSet, SyntheticPolicy& policy, int numSteps) {
+	IList actions = {};
+	for (int step = 0; step < numSteps; step++) {
+		envSet->Reset();
+		envSet->StepFirstHalf(true);
+		{
+			RG_PROFILE_SCOPE("Policy");
+			policy.GetActions(envSet->state.actionMasks, actions);
+		}
+		envSet->Sync();
+		envSet->StepSecondHalf(actions, false);
+	}
+}
+
+int main(int argc, char** argv) {
+	BenchConfig config = {};
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		size_t eqPos = arg.find('=');
+		if (eqPos == std::string::npos)
+			RG_ERR_CLOSE("Arguments should be key=value, got \"" << arg << "\"");
+		config.Set(arg.substr(0, eqPos), arg.substr(eqPos + 1));
+	}
+
+	GameMode gameMode = GameMode::SOCCAR;
+	if (config.gameMode == "void") {
+		gameMode = GameMode::THE_VOID;
+	} else {
+		for (int i = 0; i < std::size(GAMEMODE_STRS); i++)
+			if (config.gameMode == GAMEMODE_STRS[i])
+				gameMode = (GameMode)i;
+	}
+
+	// The void has no arena, so it's the only mode that runs without the meshes
+	if (gameMode != GameMode::THE_VOID && !std::filesystem::exists(config.meshes))
+		RG_ERR_CLOSE("No collision meshes at \"" << config.meshes << "\" (use gameMode=void to run without them)");
+	RocketSim::Init(config.meshes, true);
+
+	SyntheticPolicy policy = {};
+	if (!config.actions.empty()) {
+		std::ifstream actionsIn(config.actions);
+		if (!actionsIn.good())
+			RG_ERR_CLOSE("Can't open recorded actions file at \"" << config.actions << "\"");
+		int action;
+		while (actionsIn >> action)
+			policy.recordedActions.push_back(action);
+		if (policy.recordedActions.empty())
+			RG_ERR_CLOSE("No actions in \"" << config.actions << "\"");
+	}
+
+	int numPlayers = config.numGames * config.teamSize * 2;
+	RG_LOG(
+		"EnvSet benchmark (" << config.numGames << " games, " << config.teamSize << "v" << config.teamSize << ", " << config.obs << " obs, "
+		<< "tickSkip " << config.tickSkip << ", " << config.steps << " steps, " << (policy.recordedActions.empty() ? "random" : "recorded") << " actions)"
+	);
+
+	std::vector<int> threadCounts = {};
+	for (int numThreads = 1; numThreads < config.maxThreads; numThreads *= 2)
+		threadCounts.push_back(numThreads);
+	threadCounts.push_back(RS_MAX(config.maxThreads, 1));
+
+	// Each arena step records about 7 events on some worker, so the profiled run is kept short enough that no thread's ring overflows
+	int profileSteps = RS_CLAMP((int)(Profiler::RING_SIZE / (config.numGames * 10)), 1, config.steps);
+
+	// Time columns are summed over all threads, in microseconds per arena step
+	std::cout
+		<< std::setw(8) << "threads" << std::setw(14) << "steps/s" << std::setw(14) << "arena steps/s"
+		<< std::setw(12) << "first half" << std::setw(12) << "second half" << std::setw(12) << "(sim)"
+		<< std::setw(12) << "(rewards)" << std::setw(12) << "(obs)" << std::setw(12) << "resets" << std::setw(12) << "policy"
+		<< std::endl;
+	std::cout << std::fixed;
+
+	for (int numThreads : threadCounts) {
+		ThreadPool* threadPool = new ThreadPool(numThreads);
+		EnvSet* envSet = MakeEnvSet(config, gameMode, threadPool);
+
+		// Warmup
+		RunSteps(envSet, policy, RS_MIN(10, config.steps));
+
+		auto startTime = std::chrono::steady_clock::now();
+		RunSteps(envSet, policy, config.steps);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+		Profiler::Start();
+		RunSteps(envSet, policy, profileSteps);
+		Profiler::Stop();
+		auto totals = Profiler::GetTotals();
+
+		double numArenaSteps = (double)profileSteps * config.numGames;
+		auto fnUSPerArenaStep = [&](const char* name) {
+			return totals[name].totalNS / 1000.0 / numArenaSteps;
+		};
+
+		std::cout
+			<< std::setw(8) << numThreads
+			<< std::setprecision(0)
+			<< std::setw(14) << (config.steps * numPlayers / elapsed.count())
+			<< std::setw(14) << (config.steps * config.numGames / elapsed.count())
+			<< std::setprecision(2)
+			<< std::setw(12) << fnUSPerArenaStep("EnvSet::StepFirstHalf")
+			<< std::setw(12) << fnUSPerArenaStep("EnvSet::StepSecondHalf")
+			<< std::setw(12) << fnUSPerArenaStep("Arena::Step")
+			<< std::setw(12) << fnUSPerArenaStep("Rewards")
+			<< std::setw(12) << fnUSPerArenaStep("Obs")
+			<< std::setw(12) << fnUSPerArenaStep("EnvSet::ResetArena")
+			<< std::setw(12) << fnUSPerArenaStep("Policy")
+			<< std::endl;
+
+		delete envSet;
+		delete threadPool;
+	}
+
+	std::cout << "(sim), (rewards) and (obs) are included in the halves, (sim) covers both halves" << std::endl;
+
+	if (AllocTracker::ENABLED) {
+		ThreadPool* threadPool = new ThreadPool(config.maxThreads);
+		EnvSet* envSet = MakeEnvSet(config, gameMode, threadPool);
+		RunSteps(envSet, policy, RS_MIN(10, config.steps)); // Warmup, so buffers have grown to their steady-state sizes
+
+		auto startSnapshot = AllocTracker::GetSnapshot();
+		RunSteps(envSet, policy, config.steps);
+		auto allocs = AllocTracker::GetSnapshot() - startSnapshot;
+
+		double numArenaSteps = (double)config.steps * config.numGames;
+		std::cout << std::endl << "Heap allocations per arena step:" << std::endl;
+		std::cout << std::setw(18) << "phase" << std::setw(12) << "allocs" << std::setw(12) << "bytes" << std::endl;
+		for (int i = 0; i < AllocTracker::PHASE_AMOUNT; i++) {
+			std::cout
+				<< std::setw(18) << AllocTracker::PHASE_NAMES[i] << std::setprecision(2)
+				<< std::setw(12) << (allocs.phases[i].allocs / numArenaSteps)
+				<< std::setw(12) << (allocs.phases[i].bytes / numArenaSteps)
+				<< std::endl;
+		}
+
+		if (config.assertNoAllocs) {
+			for (int step = 0; step < config.steps; step++) {
+				std::string stepName = RS_STR("Step " << step);
+				auto beforeSnapshot = AllocTracker::GetSnapshot();
+				RunSteps(envSet, policy, 1);
+				AllocTracker::AssertNoAllocs(beforeSnapshot, AllocTracker::GetSnapshot(), stepName);
+			}
+			std::cout << "No allocations in " << config.steps << " steps" << std::endl;
+		}
+
+		delete envSet;
+		delete threadPool;
+	} else if (config.assertNoAllocs) {
+		RG_ERR_CLOSE("assertNoAllocs needs a build with RG_TRACK_ALLOCS");
+	}
+	return 0;
+}
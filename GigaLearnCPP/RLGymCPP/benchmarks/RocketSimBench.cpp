@@ -0,0 +1,308 @@
+// RocketSim throughput benchmark
+// Runs fixed-seed scenarios with scripted inputs, single-threaded and with one arena per thread,
+// for both arena memory weight modes, and prints one CSV row per run to stdout (progress goes to stderr)
+// Compare builds (e.g. with and without RS_MAX_SPEED) by running each and diffing the rows
+// Usage: RG_RocketSimBench [collision meshes folder] [ticks per thread] [max threads] [game mode]
+
+#include "../RocketSim/src/RocketSim.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <fstream>
+#endif
+
+using namespace RocketSim;
+
+struct Scenario {
+	const char* name;
+	int carsPerTeam;
+	int resetInterval; // In ticks
+
+	void (*reset)(Arena* arena, std::mt19937& rng);
+	void (*control)(Arena* arena, int ticksSinceReset);
+};
+
+static void SetCarState(Car* car, Vec pos, Vec forward, Vec vel) {
+	CarState state = {};
+	state.pos = pos;
+	state.rotMat = RotMat::LookAt(forward, Vec(0, 0, 1));
+	state.vel = vel;
+	state.boost = 100;
+	car->SetState(state);
+}
+
+static void SetBallState(Arena* arena, Vec pos, Vec vel) {
+	BallState state = {};
+	state.pos = pos;
+	state.vel = vel;
+	arena->ball->SetState(state);
+}
+
+// Steers towards the ball, like a bot chasing it
+static void ChaseBall(Arena* arena, Car* car) {
+	CarState carState = car->GetState();
+	Vec toBall = arena->ball->GetState().pos - carState.pos;
+	float side = carState.rotMat.right.Dot(toBall.Normalized());
+	car->controls.throttle = 1;
+	car->controls.steer = RS_CLAMP(side * 4, -1, 1);
+	car->controls.boost = carState.rotMat.forward.Dot(toBall.Normalized()) > 0.8f;
+}
+
+static const Scenario SCENARIOS[] = {
+	{
+		"kickoff_1v1", 1, 480,
+		[](Arena* arena, std::mt19937& rng) { arena->ResetToRandomKickoff(rng()); },
+		[](Arena* arena, int ticks) { for (Car* car : arena->GetCars()) ChaseBall(arena, car); }
+	},
+	{
+		"kickoff_2v2", 2, 480,
+		[](Arena* arena, std::mt19937& rng) { arena->ResetToRandomKickoff(rng()); },
+		[](Arena* arena, int ticks) { for (Car* car : arena->GetCars()) ChaseBall(arena, car); }
+	},
+	{
+		"kickoff_3v3", 3, 480,
+		[](Arena* arena, std::mt19937& rng) { arena->ResetToRandomKickoff(rng()); },
+		[](Arena* arena, int ticks) { for (Car* car : arena->GetCars()) ChaseBall(arena, car); }
+	},
+	{
+		// Cars drive into the side walls at speed and up them, with the ball rolling along the wall
+		"wall_play", 2, 240,
+		[](Arena* arena, std::mt19937& rng) {
+			std::uniform_real_distribution<float> yDist(-3000, 3000);
+			for (Car* car : arena->GetCars()) {
+				float dir = (car->id % 2) ? 1 : -1;
+				SetCarState(car, Vec(dir * 3000, yDist(rng), 17), Vec(dir, 0, 0), Vec(dir * 1400, 0, 0));
+			}
+			SetBallState(arena, Vec(3900, yDist(rng), 800), Vec(0, 1000, 0));
+		},
+		[](Arena* arena, int ticks) {
+			for (Car* car : arena->GetCars()) {
+				car->controls.throttle = 1;
+				car->controls.boost = true;
+				car->controls.steer = (car->id % 3) * 0.3f - 0.3f;
+			}
+		}
+	},
+	{
+		// Double jumps into boosted aerials towards a ball in the air
+		"aerials", 2, 360,
+		[](Arena* arena, std::mt19937& rng) {
+			std::uniform_real_distribution<float> posDist(-2000, 2000);
+			for (Car* car : arena->GetCars())
+				SetCarState(car, Vec(posDist(rng), posDist(rng), 17), Vec(0, 1, 0), Vec());
+			SetBallState(arena, Vec(posDist(rng), posDist(rng), 1200), Vec(0, 0, 300));
+		},
+		[](Arena* arena, int ticks) {
+			for (Car* car : arena->GetCars()) {
+				car->controls.jump = (ticks < 10) || (ticks >= 15 && ticks < 20);
+				car->controls.pitch = (ticks < 40) ? 1 : 0;
+				car->controls.boost = true;
+				car->controls.throttle = 1;
+			}
+		}
+	},
+	{
+		// Many cars converging on the ball at the center, so there are lots of car-car and car-ball contacts
+		"pileup_4v4", 4, 360,
+		[](Arena* arena, std::mt19937& rng) {
+			std::uniform_real_distribution<float> angleOffsetDist(0, M_PI * 2);
+			float angleOffset = angleOffsetDist(rng);
+			int numCars = arena->GetCars().size();
+			for (Car* car : arena->GetCars()) {
+				float angle = angleOffset + M_PI * 2 * (car->id % numCars) / numCars;
+				Vec pos = Vec(cosf(angle), sinf(angle), 0) * 1500 + Vec(0, 0, 17);
+				SetCarState(car, pos, -Vec(pos.x, pos.y, 0), Vec());
+			}
+			SetBallState(arena, Vec(0, 0, 93), Vec());
+		},
+		[](Arena* arena, int ticks) {
+			for (Car* car : arena->GetCars()) {
+				car->controls.throttle = 1;
+				car->controls.boost = true;
+				car->controls.steer = sinf(ticks * 0.05f + car->id) * 0.5f;
+				car->controls.jump = (ticks % 120) == (int)(car->id % 8) * 10;
+			}
+		}
+	},
+	{
+		// Just the ball bouncing around the arena
+		"ball_only", 0, 480,
+		[](Arena* arena, std::mt19937& rng) {
+			std::uniform_real_distribution<float> posDist(-2500, 2500), velDist(-3000, 3000);
+			SetBallState(arena, Vec(posDist(rng), posDist(rng), 500), Vec(velDist(rng), velDist(rng), velDist(rng)));
+		},
+		[](Arena* arena, int ticks) {}
+	},
+};
+
+static Arena* CreateArena(const Scenario& scenario, GameMode gameMode, ArenaMemWeightMode memWeightMode) {
+	ArenaConfig arenaConfig = {};
+	arenaConfig.memWeightMode = memWeightMode;
+	Arena* arena = Arena::Create(gameMode, arenaConfig);
+	for (int i = 0; i < scenario.carsPerTeam; i++) {
+		arena->AddCar(Team::BLUE);
+		arena->AddCar(Team::ORANGE);
+	}
+	return arena;
+}
+
+// Simulates the scenario on a new arena, recording the time of every tick
+static void RunScenario(const Scenario& scenario, GameMode gameMode, ArenaMemWeightMode memWeightMode, int numTicks, uint32_t seed, std::vector<float>& outTickTimesUS) {
+	Arena* arena = CreateArena(scenario, gameMode, memWeightMode);
+	std::mt19937 rng = std::mt19937(seed);
+
+	outTickTimesUS.resize(numTicks);
+	for (int tick = 0; tick < numTicks; tick++) {
+		int ticksSinceReset = tick % scenario.resetInterval;
+		if (ticksSinceReset == 0)
+			scenario.reset(arena, rng);
+		scenario.control(arena, ticksSinceReset);
+
+		auto startTime = std::chrono::steady_clock::now();
+		arena->Step(1);
+		std::chrono::duration<float, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+		outTickTimesUS[tick] = elapsed.count();
+	}
+
+	delete arena;
+}
+
+static size_t GetResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.WorkingSetSize;
+#else
+	std::ifstream statm("/proc/self/statm");
+	size_t totalPages = 0, residentPages = 0;
+	statm >> totalPages >> residentPages;
+	return residentPages * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Average resident memory added by each arena, once its cars exist and it has been stepped
+static double MeasureKBPerArena(const Scenario& scenario, GameMode gameMode, ArenaMemWeightMode memWeightMode) {
+	constexpr int NUM_ARENAS = 32;
+
+	size_t startBytes = GetResidentBytes();
+	std::vector<Arena*> arenas = {};
+	std::mt19937 rng = std::mt19937(0);
+	for (int i = 0; i < NUM_ARENAS; i++) {
+		Arena* arena = CreateArena(scenario, gameMode, memWeightMode);
+		scenario.reset(arena, rng);
+		arena->Step(1);
+		arenas.push_back(arena);
+	}
+	size_t endBytes = GetResidentBytes();
+
+	for (Arena* arena : arenas)
+		delete arena;
+
+	if (endBytes == 0)
+		return -1; // Unsupported platform
+	return (double)(endBytes - RS_MIN(startBytes, endBytes)) / NUM_ARENAS / 1024;
+}
+
+// GAMEMODE_STRS has no entry for the void
+static const char* GetGameModeName(GameMode gameMode) {
+	return (gameMode == GameMode::THE_VOID) ? "void" : GAMEMODE_STRS[(int)gameMode];
+}
+
+static float GetPercentile(std::vector<float>& sortedTimes, float percentile) {
+	size_t idx = RS_MIN((size_t)(sortedTimes.size() * percentile), sortedTimes.size() - 1);
+	return sortedTimes[idx];
+}
+
+int main(int argc, char** argv) {
+	std::filesystem::path meshesFolder = argc > 1 ? argv[1] : "collision_meshes";
+	int numTicks = argc > 2 ? std::stoi(argv[2]) : 120 * 60;
+	int maxThreads = argc > 3 ? std::stoi(argv[3]) : (int)std::thread::hardware_concurrency();
+	std::string gameModeName = argc > 4 ? argv[4] : "soccar";
+
+	GameMode gameMode = GameMode::SOCCAR;
+	for (int i = 0; i <= (int)GameMode::THE_VOID; i++)
+		if (gameModeName == GetGameModeName((GameMode)i))
+			gameMode = (GameMode)i;
+
+	// The void has no arena, so it's the only mode that runs without the meshes
+	if (gameMode != GameMode::THE_VOID && !std::filesystem::exists(meshesFolder)) {
+		std::cerr << "ERROR: No collision meshes at " << meshesFolder << " (use the \"void\" game mode to run without them)" << std::endl;
+		return 1;
+	}
+	RocketSim::Init(meshesFolder, true);
+
+#ifdef RS_MAX_SPEED
+	constexpr int RS_MAX_SPEED_ENABLED = 1;
+#else
+	constexpr int RS_MAX_SPEED_ENABLED = 0;
+#endif
+
+	std::cout << "scenario,game_mode,mem_weight_mode,cars,threads,ticks_per_thread,ticks_per_sec,p50_us,p90_us,p99_us,max_us,arena_kb,rs_max_speed" << std::endl;
+
+	std::vector<int> threadCounts = {};
+	for (int numThreads = 1; numThreads < maxThreads; numThreads *= 2)
+		threadCounts.push_back(numThreads);
+	threadCounts.push_back(RS_MAX(maxThreads, 1));
+
+	for (ArenaMemWeightMode memWeightMode : { ArenaMemWeightMode::HEAVY, ArenaMemWeightMode::LIGHT }) {
+		const char* memWeightModeName = (memWeightMode == ArenaMemWeightMode::HEAVY) ? "heavy" : "light";
+
+		for (const Scenario& scenario : SCENARIOS) {
+			double arenaKB = MeasureKBPerArena(scenario, gameMode, memWeightMode);
+
+			for (int numThreads : threadCounts) {
+				std::cerr << scenario.name << " (" << memWeightModeName << ", " << numThreads << " threads)..." << std::endl;
+
+				// Every thread runs its own arena with its own seed, so runs are repeatable at any thread count
+				std::vector<std::vector<float>> threadTickTimes(numThreads);
+				auto startTime = std::chrono::steady_clock::now();
+				{
+					std::vector<std::thread> threads = {};
+					for (int i = 0; i < numThreads; i++)
+						threads.emplace_back(RunScenario, std::cref(scenario), gameMode, memWeightMode, numTicks, (uint32_t)i, std::ref(threadTickTimes[i]));
+					for (auto& thread : threads)
+						thread.join();
+				}
+				std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+
+				std::vector<float> allTickTimes = {};
+				for (auto& tickTimes : threadTickTimes)
+					allTickTimes.insert(allTickTimes.end(), tickTimes.begin(), tickTimes.end());
+				std::sort(allTickTimes.begin(), allTickTimes.end());
+
+				// Includes arena creation, which is tiny next to thousands of ticks
+				double ticksPerSec = (double)numTicks * numThreads / elapsed.count();
+
+				std::cout
+					<< scenario.name << ','
+					<< GetGameModeName(gameMode) << ','
+					<< memWeightModeName << ','
+					<< scenario.carsPerTeam * 2 << ','
+					<< numThreads << ','
+					<< numTicks << ','
+					<< (int64_t)ticksPerSec << ','
+					<< GetPercentile(allTickTimes, 0.5f) << ','
+					<< GetPercentile(allTickTimes, 0.9f) << ','
+					<< GetPercentile(allTickTimes, 0.99f) << ','
+					<< allTickTimes.back() << ','
+					<< (int64_t)arenaKB << ','
+					<< RS_MAX_SPEED_ENABLED
+					<< std::endl;
+			}
+		}
+	}
+
+	return 0;
+}
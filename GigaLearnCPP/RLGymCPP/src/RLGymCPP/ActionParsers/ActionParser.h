@@ -16,5 +16,12 @@ namespace RLGC {
 		virtual std::vector<uint8_t> GetActionMask(const Player& player, const GameState& state) {
 			return std::vector<uint8_t>(GetActionAmount(), true);
 		}
+
+		// Returns the action for every index, if ParseAction() never depends on the player or state
+		// Parsers whose actions do depend on them should return an empty list, which is the default
+		// Used to export policies with their action table (see GGL::Learner::ExportPolicy())
+		virtual std::vector<Action> GetActionTable() {
+			return {};
+		}
 	};
 }
\ No newline at end of file
@@ -20,6 +20,10 @@ namespace RLGC {
 			return actions.size();
 		}
 
+		virtual std::vector<Action> GetActionTable() override {
+			return actions;
+		}
+
 		virtual std::vector<uint8_t> GetActionMask(const Player& player, const GameState& state) override;
 	};
 }
\ No newline at end of file
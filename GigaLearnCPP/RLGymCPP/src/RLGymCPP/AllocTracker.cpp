@@ -0,0 +1,179 @@
+#include "AllocTracker.h"
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+using namespace RLGC::AllocTracker;
+
+namespace {
+	struct ThreadCounters {
+		std::atomic<uint64_t> allocs[PHASE_AMOUNT], bytes[PHASE_AMOUNT];
+	};
+
+	// Counters are registered in a fixed array and never freed, so registering never allocates through operator new,
+	//	and threads can exit without losing their counts
+	constexpr int MAX_THREADS = 4096;
+	std::atomic<ThreadCounters*> g_ThreadCounters[MAX_THREADS] = {};
+	std::atomic<int> g_NumThreadCounters = 0;
+
+	// Shared by any threads past MAX_THREADS
+	ThreadCounters g_OverflowCounters = {};
+
+	thread_local Phase t_Phase = PHASE_OTHER;
+
+#ifdef RG_TRACK_ALLOCS
+	thread_local ThreadCounters* t_Counters = NULL;
+
+	ThreadCounters* GetThreadCounters() {
+		if (!t_Counters) {
+			int idx = g_NumThreadCounters.fetch_add(1);
+			if (idx < MAX_THREADS) {
+				// Placement new into malloc'd memory, since operator new would recurse into us
+				t_Counters = new (malloc(sizeof(ThreadCounters))) ThreadCounters();
+				g_ThreadCounters[idx].store(t_Counters, std::memory_order_release);
+			} else {
+				t_Counters = &g_OverflowCounters;
+			}
+		}
+		return t_Counters;
+	}
+
+	void CountAlloc(size_t size) {
+		ThreadCounters* counters = GetThreadCounters();
+		counters->allocs[t_Phase].fetch_add(1, std::memory_order_relaxed);
+		counters->bytes[t_Phase].fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void* TrackedAlloc(size_t size, size_t alignment) {
+		CountAlloc(size);
+
+		if (size == 0)
+			size = 1;
+
+		void* ptr;
+		if (alignment <= alignof(std::max_align_t)) {
+			ptr = malloc(size);
+		} else {
+#ifdef _WIN32
+			ptr = _aligned_malloc(size, alignment);
+#else
+			// aligned_alloc() needs the size to be a multiple of the alignment
+			ptr = aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+		}
+
+		if (!ptr)
+			throw std::bad_alloc();
+		return ptr;
+	}
+
+	void TrackedFree(void* ptr, size_t alignment) {
+#ifdef _WIN32
+		if (alignment > alignof(std::max_align_t)) {
+			_aligned_free(ptr);
+			return;
+		}
+#else
+		(void)alignment; // free() also releases aligned_alloc() memory
+#endif
+		free(ptr);
+	}
+#endif
+}
+
+RLGC::AllocTracker::Counts RLGC::AllocTracker::Snapshot::GetTotal() const {
+	Counts total = {};
+	for (const Counts& counts : phases) {
+		total.allocs += counts.allocs;
+		total.bytes += counts.bytes;
+	}
+	return total;
+}
+
+RLGC::AllocTracker::Snapshot RLGC::AllocTracker::Snapshot::operator-(const Snapshot& other) const {
+	Snapshot result = {};
+	for (int i = 0; i < PHASE_AMOUNT; i++) {
+		result.phases[i].allocs = phases[i].allocs - other.phases[i].allocs;
+		result.phases[i].bytes = phases[i].bytes - other.phases[i].bytes;
+	}
+	return result;
+}
+
+RLGC::AllocTracker::Snapshot RLGC::AllocTracker::GetSnapshot() {
+	Snapshot snapshot = {};
+
+	auto fnAdd = [&](const ThreadCounters* counters) {
+		for (int i = 0; i < PHASE_AMOUNT; i++) {
+			snapshot.phases[i].allocs += counters->allocs[i].load(std::memory_order_relaxed);
+			snapshot.phases[i].bytes += counters->bytes[i].load(std::memory_order_relaxed);
+		}
+	};
+
+	int numThreads = RS_MIN(g_NumThreadCounters.load(), MAX_THREADS);
+	for (int i = 0; i < numThreads; i++)
+		if (ThreadCounters* counters = g_ThreadCounters[i].load(std::memory_order_acquire)) // NULL if that thread is still registering
+			fnAdd(counters);
+	fnAdd(&g_OverflowCounters);
+
+	return snapshot;
+}
+
+RLGC::AllocTracker::Phase RLGC::AllocTracker::GetPhase() {
+	return t_Phase;
+}
+
+void RLGC::AllocTracker::SetPhase(Phase phase) {
+	t_Phase = phase;
+}
+
+void RLGC::AllocTracker::AssertNoAllocs(const Snapshot& before, const Snapshot& after, const std::string& what) {
+	if (!ENABLED)
+		return;
+
+	Snapshot diff = after - before;
+	Counts total = diff.GetTotal();
+	if (total.allocs == 0)
+		return;
+
+	std::stringstream breakdown;
+	for (int i = 0; i < PHASE_AMOUNT; i++)
+		if (diff.phases[i].allocs > 0)
+			breakdown << "\n\t" << PHASE_NAMES[i] << ": " << diff.phases[i].allocs << " allocs (" << diff.phases[i].bytes << " bytes)";
+
+	RG_ERR_CLOSE("AllocTracker: " << what << " allocated " << total.allocs << " times (" << total.bytes << " bytes):" << breakdown.str());
+}
+
+#ifdef RG_TRACK_ALLOCS
+// Replacing these replaces allocation for the whole program (the array and nothrow forms call these by default)
+// NOTE: On Windows, this only covers allocations from the module RLGymCPP is linked into
+
+void* operator new(size_t size) {
+	return TrackedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return TrackedAlloc(size, (size_t)alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+	TrackedFree(ptr, 0);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+	TrackedFree(ptr, (size_t)alignment);
+}
+
+// Sized forms, which the compiler calls directly when it knows the size
+void operator delete(void* ptr, size_t) noexcept {
+	TrackedFree(ptr, 0);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t alignment) noexcept {
+	TrackedFree(ptr, (size_t)alignment);
+}
+#endif
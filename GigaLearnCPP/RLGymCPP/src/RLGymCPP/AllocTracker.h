@@ -0,0 +1,94 @@
+#pragma once
+#include "Framework.h"
+
+namespace RLGC {
+	// Heap allocation counter for finding allocations in the env hot path
+	// Only active in builds with RG_TRACK_ALLOCS defined, which replace the global operator new to count every allocation
+	// Counts are kept per thread and attributed to the phase scope (RG_ALLOC_SCOPE) the allocating thread is in
+	// Without RG_TRACK_ALLOCS, scopes compile out and all counts stay zero
+	namespace AllocTracker {
+		enum Phase {
+			PHASE_OTHER, // Outside of any phase scope
+
+			PHASE_STEP_FIRST_HALF,
+			PHASE_ARENA_STEP,
+			PHASE_STEP_SECOND_HALF,
+			PHASE_PARSE_ACTIONS,
+			PHASE_UPDATE_STATE,
+			PHASE_TERMINALS,
+			PHASE_REWARDS,
+			PHASE_OBS,
+			PHASE_ACTION_MASKS,
+			PHASE_RESET,
+
+			PHASE_AMOUNT
+		};
+
+		constexpr const char* PHASE_NAMES[PHASE_AMOUNT] = {
+			"Other",
+			"StepFirstHalf",
+			"Arena Step",
+			"StepSecondHalf",
+			"ParseAction",
+			"UpdateFromArena",
+			"Terminals",
+			"Rewards",
+			"BuildObs",
+			"GetActionMask",
+			"Reset"
+		};
+
+#ifdef RG_TRACK_ALLOCS
+		constexpr bool ENABLED = true;
+#else
+		constexpr bool ENABLED = false;
+#endif
+
+		struct Counts {
+			uint64_t allocs = 0, bytes = 0;
+		};
+
+		// Allocations since the start of the process, summed over all threads
+		// Take two and subtract them to get the allocations in between
+		struct Snapshot {
+			Counts phases[PHASE_AMOUNT] = {};
+
+			Counts GetTotal() const;
+			Snapshot operator-(const Snapshot& other) const;
+		};
+
+		Snapshot GetSnapshot();
+
+		Phase GetPhase();
+		void SetPhase(Phase phase);
+
+		// For tests of the steady-state hot path: throws with a per-phase breakdown if anything was allocated between the snapshots
+		// Does nothing without RG_TRACK_ALLOCS
+		void AssertNoAllocs(const Snapshot& before, const Snapshot& after, const std::string& what);
+
+		struct PhaseScope {
+			Phase prevPhase;
+
+			PhaseScope(Phase phase) {
+				prevPhase = GetPhase();
+				SetPhase(phase);
+			}
+
+			~PhaseScope() {
+				SetPhase(prevPhase);
+			}
+
+			RG_NO_COPY(PhaseScope);
+		};
+	}
+}
+
+#define _RG_ALLOC_CONCAT_INNER(a, b) a##b
+#define _RG_ALLOC_CONCAT(a, b) _RG_ALLOC_CONCAT_INNER(a, b)
+
+#ifdef RG_TRACK_ALLOCS
+// Attributes allocations on this thread to the phase (e.g. PHASE_OBS) until the end of the current scope
+#define RG_ALLOC_SCOPE(phase) RLGC::AllocTracker::PhaseScope _RG_ALLOC_CONCAT(_allocScope, __LINE__)(RLGC::AllocTracker::phase)
+#else
+#define RG_ALLOC_SCOPE(phase) {}
+#endif
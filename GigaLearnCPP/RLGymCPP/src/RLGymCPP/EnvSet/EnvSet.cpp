@@ -1,5 +1,7 @@
 #include "EnvSet.h"
 #include  "../Rewards/ZeroSumReward.h"
+#include "../Profiler.h"
+#include "../AllocTracker.h"
 
 template<bool RLGC::PlayerEventState::* DATA_VAR>
 void IncPlayerCounter(Car* car, void* userInfoPtr) {
@@ -43,6 +45,38 @@ void _BumpCallback(Arena* arena, Car* bumper, Car* victim, bool isDemo, void* us
 
 /////////////////////////////
 
+size_t RLGC::EnvState::GetMemoryBytes() const {
+	auto fnVecBytes = [](const auto& vec) -> size_t {
+		using T = typename std::decay_t<decltype(vec)>::value_type;
+		if constexpr (std::is_same<T, bool>::value) {
+			return vec.capacity() / 8;
+		} else {
+			return vec.capacity() * sizeof(T);
+		}
+	};
+
+	auto fnGameStatesBytes = [&](const std::vector<GameState>& states) -> size_t {
+		size_t bytes = fnVecBytes(states);
+		for (auto& state : states)
+			bytes +=
+				fnVecBytes(state.players)
+				+ fnVecBytes(state.boostPads) + fnVecBytes(state.boostPadsInv)
+				+ fnVecBytes(state.boostPadTimers) + fnVecBytes(state.boostPadTimersInv);
+		return bytes;
+	};
+
+	size_t bytes =
+		fnGameStatesBytes(gameStates) + fnGameStatesBytes(prevGameStates)
+		+ fnVecBytes(obs.data) + fnVecBytes(actionMasks.data)
+		+ fnVecBytes(rewards) + fnVecBytes(lastRewards) + fnVecBytes(terminals)
+		+ fnVecBytes(arenaPlayerStartIdx);
+	for (auto& arenaRewards : lastRewards)
+		bytes += fnVecBytes(arenaRewards);
+	return bytes;
+}
+
+/////////////////////////////
+
 RLGC::EnvSet::EnvSet(const EnvSetConfig& config) : config(config) {
 
 	RG_ASSERT(config.tickSkip > 0);
@@ -86,7 +120,7 @@ RLGC::EnvSet::EnvSet(const EnvSetConfig& config) : config(config) {
 		}
 		appendMutex.unlock();
 	};
-	g_ThreadPool.StartBatchedJobs(fnCreateArenas, config.numArenas, false);
+	GetThreadPool().StartBatchedJobs(fnCreateArenas, config.numArenas, false);
 
 	state.Resize(arenas);
 	
@@ -103,7 +137,7 @@ RLGC::EnvSet::EnvSet(const EnvSetConfig& config) : config(config) {
 	}
 
 	// Reset all arenas initially
-	g_ThreadPool.StartBatchedJobs(
+	GetThreadPool().StartBatchedJobs(
 		std::bind(&RLGC::EnvSet::ResetArena, this, std::placeholders::_1),
 		config.numArenas, false
 	);
@@ -113,6 +147,9 @@ RLGC::EnvSet::EnvSet(const EnvSetConfig& config) : config(config) {
 void RLGC::EnvSet::StepFirstHalf(bool async) {
 
 	auto fnStepArena = [&](int arenaIdx) {
+		RG_PROFILE_SCOPE("EnvSet::StepFirstHalf");
+		RG_ALLOC_SCOPE(PHASE_STEP_FIRST_HALF);
+
 		Arena* arena = arenas[arenaIdx];
 		auto& gs = state.gameStates[arenaIdx];
 
@@ -124,15 +161,21 @@ void RLGC::EnvSet::StepFirstHalf(bool async) {
 		gs.ResetBeforeStep();
 
 		// Step arena with old actions
-		arena->Step(config.actionDelay);
+		{
+			RG_PROFILE_SCOPE("Arena::Step");
+			RG_ALLOC_SCOPE(PHASE_ARENA_STEP);
+			arena->Step(config.actionDelay);
+		}
 	};
 
-	g_ThreadPool.StartBatchedJobs(fnStepArena, arenas.size(), async);
+	GetThreadPool().StartBatchedJobs(fnStepArena, arenas.size(), async);
 }
 
 void RLGC::EnvSet::StepSecondHalf(const IList& actionIndices, bool async) {
 
 	auto fnStepArenas = [&](int arenaIdx) {
+		RG_PROFILE_SCOPE("EnvSet::StepSecondHalf");
+		RG_ALLOC_SCOPE(PHASE_STEP_SECOND_HALF);
 
 		Arena* arena = arenas[arenaIdx];
 		auto& gs = state.gameStates[arenaIdx];
@@ -140,20 +183,28 @@ void RLGC::EnvSet::StepSecondHalf(const IList& actionIndices, bool async) {
 			
 		// Parse and set actions
 		auto actions = std::vector<Action>(gs.players.size());
-		auto carItr = arena->_cars.begin();
-		for (int i = 0; i < gs.players.size(); i++, carItr++) {
-			auto& player = gs.players[i];
-			Car* car = *carItr;
-			Action action = actionParsers[arenaIdx]->ParseAction(actionIndices[playerStartIdx + i], player, gs);
-			car->controls = (CarControls)action;
-			actions[i] = action;
+		{
+			RG_ALLOC_SCOPE(PHASE_PARSE_ACTIONS);
+			auto carItr = arena->_cars.begin();
+			for (int i = 0; i < gs.players.size(); i++, carItr++) {
+				auto& player = gs.players[i];
+				Car* car = *carItr;
+				Action action = actionParsers[arenaIdx]->ParseAction(actionIndices[playerStartIdx + i], player, gs);
+				car->controls = (CarControls)action;
+				actions[i] = action;
+			}
 		}
 
 		// Step arena with new actions we got from observing the last state
 		// Update the gamestate after
 		{
-			arena->Step(config.tickSkip - config.actionDelay);
+			{
+				RG_PROFILE_SCOPE("Arena::Step");
+				RG_ALLOC_SCOPE(PHASE_ARENA_STEP);
+				arena->Step(config.tickSkip - config.actionDelay);
+			}
 
+			RG_ALLOC_SCOPE(PHASE_UPDATE_STATE);
 			if (eventTrackers[arenaIdx])
 				eventTrackers[arenaIdx]->Update(arena);
 
@@ -167,6 +218,7 @@ void RLGC::EnvSet::StepSecondHalf(const IList& actionIndices, bool async) {
 		// Update terminal
 		uint8_t terminalType = TerminalType::NOT_TERMINAL;
 		{
+			RG_ALLOC_SCOPE(PHASE_TERMINALS);
 			for (auto cond : terminalConditions[arenaIdx]) {
 				if (cond->IsTerminal(gs)) {
 					bool isTrunc = cond->IsTruncation();
@@ -189,12 +241,16 @@ void RLGC::EnvSet::StepSecondHalf(const IList& actionIndices, bool async) {
 		
 		// Pre-step rewards
 		{
+			RG_PROFILE_SCOPE("Rewards");
+			RG_ALLOC_SCOPE(PHASE_REWARDS);
 			for (auto& weighted : rewards[arenaIdx])
 				weighted.reward->PreStep(gs);
 		}
 
 		// Update rewards
 		{
+			RG_PROFILE_SCOPE("Rewards");
+			RG_ALLOC_SCOPE(PHASE_REWARDS);
 			FList allRewards = FList(gs.players.size(), 0);
 			for (int rewardIdx = 0; rewardIdx < rewards[arenaIdx].size(); rewardIdx++) {
 				auto& weightedReward = rewards[arenaIdx][rewardIdx];
@@ -240,21 +296,30 @@ void RLGC::EnvSet::StepSecondHalf(const IList& actionIndices, bool async) {
 
 		// Update observations
 		{
-			for (int i = 0; i < gs.players.size(); i++)
+			RG_PROFILE_SCOPE("Obs");
+			RG_ALLOC_SCOPE(PHASE_OBS);
+			for (int i = 0; i < gs.players.size(); i++) {
 				state.obs.Set(playerStartIdx + i, obsBuilders[arenaIdx]->BuildObs(gs.players[i], gs));
+				if (obsPostProcessFn)
+					obsPostProcessFn(&state.obs.At(playerStartIdx + i, 0), obsSize);
+			}
 		}
 
 		// Update action masks
 		{
+			RG_ALLOC_SCOPE(PHASE_ACTION_MASKS);
 			for (int i = 0; i < gs.players.size(); i++)
 				state.actionMasks.Set(playerStartIdx + i, actionParsers[arenaIdx]->GetActionMask(gs.players[i], gs));
 		}
 	};
 
-	g_ThreadPool.StartBatchedJobs(fnStepArenas, arenas.size(), async);
+	GetThreadPool().StartBatchedJobs(fnStepArenas, arenas.size(), async);
 }
 
 void RLGC::EnvSet::ResetArena(int index) {
+	RG_PROFILE_SCOPE("EnvSet::ResetArena");
+	RG_ALLOC_SCOPE(PHASE_RESET);
+
 	stateSetters[index]->ResetArena(arenas[index]);
 	GameState newState = GameState(arenas[index]);
 	state.gameStates[index] = newState;
@@ -278,6 +343,8 @@ void RLGC::EnvSet::ResetArena(int index) {
 		// Update obs
 		auto obs = obsBuilders[index]->BuildObs(newState.players[i], newState);
 		state.obs.Set(playerStartIdx + i, obs);
+		if (obsPostProcessFn)
+			obsPostProcessFn(&state.obs.At(playerStartIdx + i, 0), obsSize);
 
 		// Update action mask
 		auto actionMask = actionParsers[index]->GetActionMask(newState.players[i], newState);
@@ -289,9 +356,12 @@ void RLGC::EnvSet::ResetArena(int index) {
 }
 
 void RLGC::EnvSet::Reset() {
+	RG_PROFILE_SCOPE("EnvSet::Reset");
+	RG_ALLOC_SCOPE(PHASE_RESET);
+
 	for (int i = 0; i < arenas.size(); i++)
 		if (state.terminals[i])
-			g_ThreadPool.StartJobAsync(std::bind(&EnvSet::ResetArena, this, std::placeholders::_1), i);
+			GetThreadPool().StartJobAsync(std::bind(&EnvSet::ResetArena, this, std::placeholders::_1), i);
 	std::fill(state.terminals.begin(), state.terminals.end(), 0);
-	g_ThreadPool.WaitUntilDone();
+	GetThreadPool().WaitUntilDone();
 }
\ No newline at end of file
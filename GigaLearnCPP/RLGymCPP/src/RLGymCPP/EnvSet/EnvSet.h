@@ -3,7 +3,7 @@
 #include "../BasicTypes/Action.h"
 #include "../TerminalConditions/TerminalCondition.h"
 #include "../Rewards/Reward.h"
-#include "../OBSBuilders/OBSBuilder.h"
+#include "../ObsBuilders/ObsBuilder.h"
 #include "../ActionParsers/ActionParser.h"
 #include "../StateSetters/StateSetter.h"
 #include "../ThreadPool.h"
@@ -23,6 +23,9 @@ namespace RLGC {
 	};
 	typedef std::function<EnvCreateResult(int index)> EnvCreateFn;
 
+	// Called on each player's obs right after it is built, from within the worker threads
+	typedef std::function<void(float* obs, int obsSize)> ObsPostProcessFn;
+
 	struct EnvSetConfig {
 		EnvCreateFn envCreateFn;
 		int numArenas;
@@ -30,6 +33,9 @@ namespace RLGC {
 		int actionDelay;
 		bool saveRewards;
 		bool shuffleRewardSampling = true;
+
+		// Thread pool to step the arenas on, NULL uses the global thread pool
+		ThreadPool* threadPool = NULL;
 	};
 
 	struct EnvState {
@@ -57,6 +63,9 @@ namespace RLGC {
 			lastRewards.resize(arenas.size());
 			terminals.resize(arenas.size());
 		}
+
+		// Heap memory held by the state's containers, based on their capacities
+		size_t GetMemoryBytes() const;
 	};
 
 	struct EnvSet {
@@ -86,6 +95,9 @@ namespace RLGC {
 
 		EnvState state = {};
 
+		// Optional, can be used to transform obs (e.g. standardization) without another pass over them
+		ObsPostProcessFn obsPostProcessFn = NULL;
+
 		EnvSet(const EnvSetConfig& config);
 
 		RG_NO_COPY(EnvSet);
@@ -104,7 +116,8 @@ namespace RLGC {
 		
 		void StepFirstHalf(bool async);
 		void StepSecondHalf(const IList& actionIndices, bool async);
-		void Sync() { g_ThreadPool.WaitUntilDone(); }
+		void Sync() { GetThreadPool().WaitUntilDone(); }
+		ThreadPool& GetThreadPool() { return config.threadPool ? *config.threadPool : g_ThreadPool; }
 		void ResetArena(int index);
 		void Reset();
 	};
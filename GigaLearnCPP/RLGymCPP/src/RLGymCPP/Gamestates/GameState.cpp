@@ -78,6 +78,25 @@ void RLGC::GameState::UpdateFromArena(Arena* arena, const std::vector<Action>& a
 		carItr++;
 	}
 
+	if (arena->_boostPads.empty()) {
+		// No boost pads (e.g. THE_VOID), so every pad location reads as permanently inactive
+		// This keeps the pad lists the usual size for obs builders that go through every location
+		boostPads.assign(CommonValues::BOOST_LOCATIONS_AMOUNT, false);
+		boostPadsInv.assign(CommonValues::BOOST_LOCATIONS_AMOUNT, false);
+		boostPadTimers.assign(CommonValues::BOOST_LOCATIONS_AMOUNT, 0);
+		boostPadTimersInv.assign(CommonValues::BOOST_LOCATIONS_AMOUNT, 0);
+	} else {
+		UpdateBoostPads(arena);
+	}
+
+	// Update goal scoring
+	// If you don't have a GoalScoreCondition then that's not my problem lmao
+	goalScored = arena->IsBallScored();
+
+	lastTickCount = arena->tickCount;
+}
+
+void RLGC::GameState::UpdateBoostPads(Arena* arena) {
 	if (!boostPadIndexMapBuilt) {
 		boostPadIndexMapMutex.lock();
 		// Check again? This seems stupid but also makes sense to me
@@ -106,10 +125,4 @@ void RLGC::GameState::UpdateFromArena(Arena* arena, const std::vector<Action>& a
 		boostPadTimers[i] = state.cooldown;
 		boostPadTimersInv[i] = stateInv.cooldown;
 	}
-
-	// Update goal scoring
-	// If you don't have a GoalScoreCondition then that's not my problem lmao
-	goalScored = arena->IsBallScored();
-
-	lastTickCount = arena->tickCount;
 }
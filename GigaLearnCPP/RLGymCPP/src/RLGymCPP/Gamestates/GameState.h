@@ -64,6 +64,7 @@ namespace RLGC {
 		void ResetBeforeStep();
 
 		void UpdateFromArena(Arena* arena, const std::vector<Action>& actions, GameState* prev);
+		void UpdateBoostPads(Arena* arena);
 
 		bool IsEmpty() const {
 			return players.empty();
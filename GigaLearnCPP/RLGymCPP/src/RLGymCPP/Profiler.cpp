@@ -0,0 +1,163 @@
+#include "Profiler.h"
+
+namespace {
+	struct ThreadBuffer {
+		int threadIdx;
+		std::string name;
+		RLGC::Profiler::Event* events;
+
+		// Only the owning thread writes events, other threads read up to the last published event
+		std::atomic<uint64_t> numRecorded = 0;
+
+		// Recording generation the events belong to, see g_Generation
+		// Only the owning thread changes it, right after clearing its events
+		std::atomic<uint64_t> generation = 0;
+	};
+
+	// Incremented by each Start(), so that each owning thread clears its own events before recording new ones
+	// Buffers from an older generation are stale, and are skipped by readers
+	std::atomic<uint64_t> g_Generation = 0;
+
+	// Buffers are never freed, so threads can come and go without invalidating recorded events
+	std::mutex g_BuffersMutex = {};
+	std::vector<ThreadBuffer*> g_Buffers = {};
+
+	ThreadBuffer* GetThreadBuffer() {
+		thread_local ThreadBuffer* buffer = NULL;
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(g_BuffersMutex);
+			buffer = new ThreadBuffer();
+			buffer->threadIdx = g_Buffers.size();
+			buffer->name = "Thread " + std::to_string(buffer->threadIdx);
+			buffer->events = new RLGC::Profiler::Event[RLGC::Profiler::RING_SIZE];
+			g_Buffers.push_back(buffer);
+		}
+		return buffer;
+	}
+
+	// Number of events the buffer holds from the current recording
+	uint64_t GetNumRecorded(const ThreadBuffer* buffer) {
+		if (buffer->generation.load(std::memory_order_acquire) != g_Generation.load(std::memory_order_acquire))
+			return 0;
+		return buffer->numRecorded.load(std::memory_order_acquire);
+	}
+
+	void WriteJSONString(std::ostream& out, const std::string& str) {
+		out << '"';
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				out << '\\' << c;
+			} else if ((unsigned char)c < 0x20) {
+				out << ' ';
+			} else {
+				out << c;
+			}
+		}
+		out << '"';
+	}
+}
+
+std::atomic<bool> RLGC::Profiler::g_Recording = false;
+
+int64_t RLGC::Profiler::GetTimeNS() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RLGC::Profiler::Record(const char* name, int64_t startNS, int64_t endNS) {
+	ThreadBuffer* buffer = GetThreadBuffer();
+
+	uint64_t generation = g_Generation.load(std::memory_order_acquire);
+	if (buffer->generation.load(std::memory_order_relaxed) != generation) {
+		buffer->numRecorded.store(0, std::memory_order_relaxed);
+		buffer->generation.store(generation, std::memory_order_release);
+	}
+
+	uint64_t idx = buffer->numRecorded.load(std::memory_order_relaxed);
+	buffer->events[idx % RING_SIZE] = { name, startNS, endNS };
+	buffer->numRecorded.store(idx + 1, std::memory_order_release);
+}
+
+void RLGC::Profiler::Start() {
+	// Buffers are only ever cleared by their own thread, on its next Record()
+	// A scope that started during the previous recording and is still open can still add its event after this
+	g_Generation.fetch_add(1, std::memory_order_acq_rel);
+	g_Recording.store(true, std::memory_order_release);
+}
+
+void RLGC::Profiler::Stop() {
+	g_Recording.store(false, std::memory_order_release);
+}
+
+void RLGC::Profiler::SetThreadName(const std::string& name) {
+	ThreadBuffer* buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock(g_BuffersMutex);
+	buffer->name = name;
+}
+
+void RLGC::Profiler::WriteTrace(std::filesystem::path path) {
+	constexpr const char* ERROR_PREFIX = "Profiler::WriteTrace(): ";
+
+	std::ofstream fOut(path);
+	if (!fOut.good())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Can't open file at " << path);
+
+	std::lock_guard<std::mutex> lock(g_BuffersMutex);
+
+	// Chrome traces use microseconds, relative to the earliest event to keep the numbers small
+	int64_t firstNS = INT64_MAX;
+	for (ThreadBuffer* buffer : g_Buffers) {
+		uint64_t numRecorded = GetNumRecorded(buffer);
+		for (uint64_t i = (numRecorded > RING_SIZE ? numRecorded - RING_SIZE : 0); i < numRecorded; i++)
+			firstNS = RS_MIN(firstNS, buffer->events[i % RING_SIZE].startNS);
+	}
+
+	fOut << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+	for (ThreadBuffer* buffer : g_Buffers) {
+		uint64_t numRecorded = GetNumRecorded(buffer);
+		if (numRecorded == 0)
+			continue;
+
+		if (!first)
+			fOut << ',';
+		first = false;
+		fOut << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":0,\"tid\":" << buffer->threadIdx << ",\"args\":{\"name\":";
+		WriteJSONString(fOut, buffer->name);
+		fOut << "}}";
+
+		if (numRecorded > RING_SIZE)
+			RG_LOG(ERROR_PREFIX << "WARNING: " << buffer->name << " recorded more than " << RING_SIZE << " events, only the latest were kept");
+
+		fOut << std::fixed << std::setprecision(3);
+		for (uint64_t i = (numRecorded > RING_SIZE ? numRecorded - RING_SIZE : 0); i < numRecorded; i++) {
+			const Event& event = buffer->events[i % RING_SIZE];
+			fOut << ",\n{\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadIdx << ",\"name\":";
+			WriteJSONString(fOut, event.name);
+			fOut << ",\"ts\":" << (event.startNS - firstNS) / 1000.0 << ",\"dur\":" << (event.endNS - event.startNS) / 1000.0 << "}";
+		}
+	}
+	fOut << "\n]}\n";
+
+	if (!fOut.good())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to write to " << path);
+}
+
+std::map<std::string, RLGC::Profiler::Total> RLGC::Profiler::GetTotals() {
+	std::map<std::string, Total> totals = {};
+
+	std::lock_guard<std::mutex> lock(g_BuffersMutex);
+	for (ThreadBuffer* buffer : g_Buffers) {
+		uint64_t numRecorded = GetNumRecorded(buffer);
+		if (numRecorded > RING_SIZE)
+			RG_LOG("Profiler::GetTotals(): WARNING: " << buffer->name << " recorded more than " << RING_SIZE << " events, only the latest are counted");
+
+		for (uint64_t i = (numRecorded > RING_SIZE ? numRecorded - RING_SIZE : 0); i < numRecorded; i++) {
+			const Event& event = buffer->events[i % RING_SIZE];
+			Total& total = totals[event.name];
+			total.count++;
+			total.totalNS += event.endNS - event.startNS;
+		}
+	}
+
+	return totals;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include "Framework.h"
+
+#include <atomic>
+
+namespace RLGC {
+	// Low-overhead scoped event profiler, which dumps Chrome trace JSON (open in chrome://tracing or https://ui.perfetto.dev)
+	// Every thread records into its own fixed-size ring buffer that only it writes to, so recording never locks
+	// While not recording, a scope only costs one relaxed atomic load
+	// Define RG_NO_PROFILER to compile all scopes out entirely
+	namespace Profiler {
+		struct Event {
+			const char* name; // Must be a string literal, or otherwise outlive the profiler
+			int64_t startNS, endNS;
+		};
+
+		// Events per thread, older events are overwritten once a thread records more than this
+		constexpr size_t RING_SIZE = 1 << 16;
+
+		extern std::atomic<bool> g_Recording;
+
+		int64_t GetTimeNS();
+		void Record(const char* name, int64_t startNS, int64_t endNS);
+
+		// Clears all previously recorded events, then starts recording
+		void Start();
+		void Stop();
+
+		inline bool IsRecording() {
+			return g_Recording.load(std::memory_order_relaxed);
+		}
+
+		// Names the calling thread in the trace
+		void SetThreadName(const std::string& name);
+
+		// Writes every recorded event as Chrome trace JSON
+		// Should be called after Stop(), since events still being recorded by other threads can be missed
+		void WriteTrace(std::filesystem::path path);
+
+		struct Total {
+			uint64_t count = 0;
+			int64_t totalNS = 0;
+		};
+
+		// Sums the recorded events of each name across all threads (nested events count towards both themselves and their parents)
+		// Like WriteTrace(), should be called after Stop()
+		std::map<std::string, Total> GetTotals();
+
+		struct Scope {
+			const char* name;
+			int64_t startNS;
+
+			Scope(const char* name) {
+				if (IsRecording()) {
+					this->name = name;
+					startNS = GetTimeNS();
+				} else {
+					this->name = NULL;
+				}
+			}
+
+			~Scope() {
+				if (name)
+					Record(name, startNS, GetTimeNS());
+			}
+
+			RG_NO_COPY(Scope);
+		};
+	}
+}
+
+#define _RG_PROFILE_CONCAT_INNER(a, b) a##b
+#define _RG_PROFILE_CONCAT(a, b) _RG_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef RG_NO_PROFILER
+#define RG_PROFILE_SCOPE(name) {}
+#else
+// Records an event from here until the end of the current scope, name must be a string literal
+#define RG_PROFILE_SCOPE(name) RLGC::Profiler::Scope _RG_PROFILE_CONCAT(_profileScope, __LINE__)(name)
+#endif
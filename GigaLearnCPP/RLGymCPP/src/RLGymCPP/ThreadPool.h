@@ -13,6 +13,10 @@ namespace RLGC {
 			_tp = new dp::thread_pool();
 		}
 
+		ThreadPool(int numThreads) {
+			_tp = new dp::thread_pool(RS_MAX(numThreads, 1));
+		}
+
 		RG_NO_COPY(ThreadPool);
 
 		~ThreadPool() {
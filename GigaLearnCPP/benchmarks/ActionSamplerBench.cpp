@@ -0,0 +1,98 @@
+// Per-step microbenchmark of CPU action sampling
+// Compares the unfused torch chain (softmax -> clamp -> multinomial -> log -> gather) against the fused ActionSampler
+// Usage: GGL_ActionSamplerBench [numActions] [iterations]
+
+#include <torch/torch.h>
+#include <ATen/Parallel.h>
+#include <GigaLearnCPP/PPO/ActionSampler.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace GGL;
+
+constexpr float ACTION_DISABLED_LOGIT = -1e10f;
+constexpr float TEMPERATURE = 1.f;
+
+static void SampleUnfused(torch::Tensor logits, torch::Tensor masks, torch::Tensor& outActions, torch::Tensor& outLogProbs) {
+	auto probs = torch::softmax(logits / TEMPERATURE + ACTION_DISABLED_LOGIT * masks.to(torch::kBool).logical_not(), -1);
+	probs = probs.clamp(ActionSampler::ACTION_MIN_PROB, 1);
+	auto action = torch::multinomial(probs, 1, true);
+	outLogProbs = torch::log(probs).gather(-1, action).flatten();
+	outActions = action.flatten();
+}
+
+static void SampleFused(torch::Tensor logits, torch::Tensor masks, uint64_t seed, torch::Tensor& outActions, torch::Tensor& outLogProbs) {
+	int64_t numRows = logits.size(0), numActions = logits.size(1);
+	outActions = torch::empty({ numRows }, torch::kInt64);
+	outLogProbs = torch::empty({ numRows }, torch::kFloat32);
+
+	const float* logitsPtr = logits.data_ptr<float>();
+	const uint8_t* masksPtr = masks.data_ptr<uint8_t>();
+	int64_t* actionsPtr = outActions.data_ptr<int64_t>();
+	float* logProbsPtr = outLogProbs.data_ptr<float>();
+	at::parallel_for(0, numRows, 256,
+		[&](int64_t start, int64_t end) {
+			ActionSampler::Sample(logitsPtr, numActions, masksPtr, numActions, start, end, TEMPERATURE, false, seed, actionsPtr, logProbsPtr);
+		}
+	);
+}
+
+template <typename FN>
+static double TimePerStepUS(int iterations, FN&& fn) {
+	fn(); // Warmup
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		fn();
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+	return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+	int numActions = argc > 1 ? std::stoi(argv[1]) : 90;
+	int iterations = argc > 2 ? std::stoi(argv[2]) : 200;
+
+	torch::manual_seed(0);
+	torch::NoGradGuard noGrad = {};
+
+	std::cout << "Action sampling benchmark (" << numActions << " actions, " << at::get_num_threads() << " threads)" << std::endl;
+	std::cout << std::setw(8) << "rows" << std::setw(16) << "unfused us/step" << std::setw(16) << "fused us/step" << std::setw(10) << "speedup" << std::endl;
+
+	for (int64_t numRows : { 1, 8, 64, 512, 4096, 32768 }) {
+		auto logits = torch::randn({ numRows, numActions }) * 2;
+		auto masks = (torch::rand({ numRows, numActions }) > 0.2f).to(torch::kUInt8);
+		masks.select(1, 0).fill_(1); // Every row needs at least one allowed action
+
+		torch::Tensor actions, logProbs;
+		double unfusedTime = TimePerStepUS(iterations, [&]() { SampleUnfused(logits, masks, actions, logProbs); });
+
+		uint64_t seed = 0;
+		double fusedTime = TimePerStepUS(iterations, [&]() { SampleFused(logits, masks, seed++, actions, logProbs); });
+
+		std::cout
+			<< std::setw(8) << numRows
+			<< std::setw(16) << std::fixed << std::setprecision(2) << unfusedTime
+			<< std::setw(16) << fusedTime
+			<< std::setw(9) << (unfusedTime / fusedTime) << "x" << std::endl;
+	}
+
+	// Sanity check: sampled log probs should match the unfused log probs of the same actions
+	{
+		auto logits = torch::randn({ 4096, numActions }) * 2;
+		auto masks = (torch::rand({ 4096, numActions }) > 0.2f).to(torch::kUInt8);
+		masks.select(1, 0).fill_(1);
+
+		torch::Tensor actions, logProbs;
+		SampleFused(logits, masks, 1234, actions, logProbs);
+
+		auto probs = torch::softmax(logits / TEMPERATURE + ACTION_DISABLED_LOGIT * masks.to(torch::kBool).logical_not(), -1).clamp(ActionSampler::ACTION_MIN_PROB, 1);
+		auto refLogProbs = torch::log(probs).gather(-1, actions.unsqueeze(-1)).flatten();
+		float maxErr = (refLogProbs - logProbs).abs().max().item<float>();
+		bool anyMasked = (masks.gather(-1, actions.unsqueeze(-1)) == 0).any().item<bool>();
+
+		std::cout << "Max log prob error vs. unfused: " << maxErr << (anyMasked ? " (ERROR: sampled a masked action)" : "") << std::endl;
+	}
+
+	return 0;
+}
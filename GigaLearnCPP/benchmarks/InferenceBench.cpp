@@ -0,0 +1,99 @@
+// Collection-inference latency benchmark for a policy-sized model
+// Compares eager Sequential inference against the torch-free MLPEngine, in float and int8
+// "forward us" is Model::Forward() with engineInference on, which splits the batch between torch's threads
+// Usage: GGL_InferenceBench [obsSize] [numActions] [iterations]
+
+#include <GigaLearnCPP/Util/Models.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+using namespace GGL;
+
+template <typename FN>
+static double TimePerCallUS(int iterations, FN&& fn) {
+	fn(); // Warmup
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		fn();
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+	return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+	int obsSize = argc > 1 ? std::stoi(argv[1]) : 150;
+	int numActions = argc > 2 ? std::stoi(argv[2]) : 90;
+	int iterations = argc > 3 ? std::stoi(argv[3]) : 100;
+
+	torch::manual_seed(0);
+
+	PartialModelConfig partialConfig = {};
+	partialConfig.layerSizes = { 256, 256, 256 };
+	ModelConfig config = partialConfig;
+	config.numInputs = obsSize;
+	config.numOutputs = numActions;
+
+	Model* model = new Model("policy", config, torch::kCPU);
+
+	MLPEngine* engine = model->MakeMLPEngine();
+
+	// Calibrated on inputs from the same distribution as the benchmark inputs
+	MLPEngine* int8Engine = model->MakeMLPEngine();
+	{
+		auto calibInputs = torch::randn({ 4096, obsSize });
+		int8Engine->QuantizeInt8(calibInputs.data_ptr<float>(), calibInputs.size(0));
+	}
+
+	RG_NO_GRAD;
+
+	std::cout << "Inference benchmark (" << obsSize << " -> [256, 256, 256] -> " << numActions << ", " << at::get_num_threads() << " threads)" << std::endl;
+	std::cout << "MLPEngine kernels: " << MLPEngine::GetKernelName() << " (single-threaded)" << std::endl;
+	std::cout
+		<< std::setw(8) << "batch"
+		<< std::setw(14) << "eager us" << std::setw(14) << "engine us" << std::setw(14) << "forward us" << std::setw(14) << "int8 us"
+		<< std::setw(14) << "engine diff" << std::setw(14) << "int8 agree" << std::endl;
+
+	for (int64_t batchSize : { 1, 64, 1024, 8192 }) {
+		auto input = torch::randn({ batchSize, obsSize });
+		int curIterations = std::max<int>(iterations * 64 / std::max<int64_t>(batchSize, 64), 3);
+
+		double eagerTime = TimePerCallUS(curIterations, [&]() { model->seq->forward(input); });
+
+		const float* inputPtr = input.data_ptr<float>();
+		double engineTime = TimePerCallUS(curIterations, [&]() { engine->Forward(inputPtr, batchSize); });
+		double int8Time = TimePerCallUS(curIterations, [&]() { int8Engine->Forward(inputPtr, batchSize); });
+
+		model->config.engineInference = true;
+		double forwardTime = TimePerCallUS(curIterations, [&]() { model->Forward(input, false); });
+		model->config.engineInference = false;
+
+		auto eagerOutput = model->seq->forward(input);
+
+		auto engineOutput = torch::from_blob(
+			(void*)engine->Forward(inputPtr, batchSize), { batchSize, engine->GetOutputStride() }
+		).slice(1, 0, numActions);
+		float engineDiff = (eagerOutput - engineOutput).abs().max().item<float>();
+
+		// Fraction of rows where the int8 engine picks the same most probable action
+		auto int8Output = torch::from_blob(
+			(void*)int8Engine->Forward(inputPtr, batchSize), { batchSize, int8Engine->GetOutputStride() }
+		).slice(1, 0, numActions);
+		float int8Agreement = (eagerOutput.argmax(-1) == int8Output.argmax(-1)).to(torch::kFloat32).mean().item<float>();
+
+		std::cout
+			<< std::setw(8) << batchSize
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(14) << eagerTime << std::setw(14) << engineTime << std::setw(14) << forwardTime << std::setw(14) << int8Time
+			<< std::scientific << std::setprecision(1)
+			<< std::setw(14) << engineDiff
+			<< std::fixed << std::setprecision(2)
+			<< std::setw(13) << (int8Agreement * 100) << "%"
+			<< std::defaultfloat << std::endl;
+	}
+
+	delete engine;
+	delete int8Engine;
+	delete model;
+	return 0;
+}
@@ -0,0 +1,231 @@
+// Learner-side microbenchmarks on synthetic experience, without RocketSim
+// Times each part of an iteration on CPU: collection inference (InferActions), value prediction (InferCritic),
+//	GAE::Compute, ExperienceBuffer batch sampling and PPOLearner::Learn
+// Everything is generated from the seed, so runs with the same settings see the same data
+// Usage: GGL_LearnerBench [key=value]...
+//	samples=50000 obsSize=150 numActions=90 policy=256,256,256 critic=256,256,256 sharedHead=256 (empty for none)
+//	batchSize=50000 miniBatchSize=0 epochs=2 inferBatchSize=256 episodeLength=300 iterations=3 seed=0 threads=<torch default>
+
+#include <GigaLearnCPP/PPO/PPOLearner.h>
+#include <GigaLearnCPP/PPO/ExperienceBuffer.h>
+#include <GigaLearnCPP/PPO/GAE.h>
+#include <RLGymCPP/TerminalConditions/TerminalCondition.h>
+#include <ATen/Parallel.h>
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace GGL;
+
+struct BenchConfig {
+	int64_t samples = 50'000;
+	int obsSize = 150;
+	int numActions = 90;
+	std::vector<int> policy = { 256, 256, 256 };
+	std::vector<int> critic = { 256, 256, 256 };
+	std::vector<int> sharedHead = { 256 };
+	int64_t batchSize = 50'000;
+	int64_t miniBatchSize = 0;
+	int epochs = 2;
+	int64_t inferBatchSize = 256; // Rows per InferActions() call, like one collection step with this many players
+	int episodeLength = 300; // Every 4th episode is truncated instead of ending normally
+	int iterations = 3;
+	int seed = 0;
+	int threads = 0;
+
+	static std::vector<int> ParseLayerSizes(const std::string& str) {
+		std::vector<int> result = {};
+		std::stringstream stream(str);
+		std::string size;
+		while (std::getline(stream, size, ','))
+			if (!size.empty())
+				result.push_back(std::stoi(size));
+		return result;
+	}
+
+	void Set(const std::string& key, const std::string& val) {
+		if (key == "samples") samples = std::stoll(val);
+		else if (key == "obsSize") obsSize = std::stoi(val);
+		else if (key == "numActions") numActions = std::stoi(val);
+		else if (key == "policy") policy = ParseLayerSizes(val);
+		else if (key == "critic") critic = ParseLayerSizes(val);
+		else if (key == "sharedHead") sharedHead = ParseLayerSizes(val);
+		else if (key == "batchSize") batchSize = std::stoll(val);
+		else if (key == "miniBatchSize") miniBatchSize = std::stoll(val);
+		else if (key == "epochs") epochs = std::stoi(val);
+		else if (key == "inferBatchSize") inferBatchSize = std::stoll(val);
+		else if (key == "episodeLength") episodeLength = std::stoi(val);
+		else if (key == "iterations") iterations = std::stoi(val);
+		else if (key == "seed") seed = std::stoi(val);
+		else if (key == "threads") threads = std::stoi(val);
+		else RG_ERR_CLOSE("Unknown setting \"" << key << "\"");
+	}
+};
+
+static double GetPeakMemoryMB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+	return usage.ru_maxrss / 1024.0; // Kilobytes
+#endif
+#endif
+}
+
+template <typename FN>
+static double TimePerCallMS(int iterations, FN&& fn) {
+	fn(); // Warmup
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		fn();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+	return elapsed.count() / iterations;
+}
+
+static void PrintRow(const char* name, double msPerCall, double samplesPerCall) {
+	std::cout
+		<< std::setw(24) << name
+		<< std::fixed << std::setprecision(2) << std::setw(14) << msPerCall
+		<< std::setprecision(0) << std::setw(16) << (samplesPerCall / (msPerCall / 1000))
+		<< std::setprecision(1) << std::setw(14) << GetPeakMemoryMB()
+		<< std::defaultfloat << std::endl;
+}
+
+int main(int argc, char** argv) {
+	BenchConfig config = {};
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		size_t eqPos = arg.find('=');
+		if (eqPos == std::string::npos)
+			RG_ERR_CLOSE("Arguments should be key=value, got \"" << arg << "\"");
+		config.Set(arg.substr(0, eqPos), arg.substr(eqPos + 1));
+	}
+
+	// InferActions() is timed over every inference batch but the first (the warmup), so there has to be more than one
+	if (config.samples <= config.inferBatchSize)
+		RG_ERR_CLOSE("samples (" << config.samples << ") must be larger than inferBatchSize (" << config.inferBatchSize << ")");
+
+	if (config.threads > 0)
+		at::set_num_threads(config.threads);
+	torch::manual_seed(config.seed);
+
+	PPOLearnerConfig ppoConfig = {};
+	ppoConfig.policy.layerSizes = config.policy;
+	ppoConfig.critic.layerSizes = config.critic;
+	ppoConfig.sharedHead.layerSizes = config.sharedHead;
+	ppoConfig.batchSize = RS_MIN(config.batchSize, config.samples);
+	ppoConfig.miniBatchSize = config.miniBatchSize;
+	ppoConfig.epochs = config.epochs;
+	PPOLearner* ppo = new PPOLearner(config.obsSize, config.numActions, ppoConfig, torch::kCPU);
+
+	std::cout
+		<< "Learner benchmark (" << config.samples << " samples, " << config.obsSize << " obs, " << config.numActions << " actions, "
+		<< "batch " << ppoConfig.batchSize << ", " << config.epochs << " epochs, " << at::get_num_threads() << " threads, seed " << config.seed << ")"
+		<< std::endl;
+	std::cout << "Peak memory before benchmarks: " << std::fixed << std::setprecision(1) << GetPeakMemoryMB() << "MB" << std::defaultfloat << std::endl;
+	std::cout << std::setw(24) << "component" << std::setw(14) << "ms/call" << std::setw(16) << "samples/s" << std::setw(14) << "peak MB" << std::endl;
+
+	int64_t numSamples = config.samples;
+	ExperienceBuffer experience = ExperienceBuffer(config.seed, torch::kCPU);
+	{
+		RG_NO_GRAD;
+
+		// Obs and masks, always allowing at least the first action
+		torch::Tensor tStates = torch::randn({ numSamples, config.obsSize });
+		torch::Tensor tActionMasks = (torch::rand({ numSamples, config.numActions }) > 0.2f).to(torch::kUInt8);
+		tActionMasks.select(1, 0).fill_(1);
+
+		// Actions and log probs come from the policy itself, so the first learn iteration sees realistic ratios
+		torch::Tensor tActions = torch::empty({ numSamples }, torch::kInt64);
+		torch::Tensor tLogProbs = torch::empty({ numSamples });
+		{
+			int64_t numCalls = (numSamples + config.inferBatchSize - 1) / config.inferBatchSize;
+			int64_t callIdx = 0;
+			double inferTime = TimePerCallMS(numCalls - 1, [&]() {
+				int64_t start = callIdx * config.inferBatchSize;
+				int64_t end = RS_MIN(start + config.inferBatchSize, numSamples);
+				torch::Tensor tCurActions, tCurLogProbs;
+				ppo->InferActions(tStates.slice(0, start, end), tActionMasks.slice(0, start, end), &tCurActions, &tCurLogProbs);
+				tActions.slice(0, start, end).copy_(tCurActions);
+				tLogProbs.slice(0, start, end).copy_(tCurLogProbs);
+				callIdx++;
+			});
+			PrintRow("InferActions", inferTime, config.inferBatchSize);
+		}
+
+		// Episodes of a fixed length, with truncations needing their own next-state value predictions
+		torch::Tensor tRewards = torch::randn({ numSamples }) * 0.1f;
+		torch::Tensor tTerminals = torch::zeros({ numSamples }, torch::kInt8);
+		int64_t numTruncs = 0;
+		{
+			int8_t* terminals = tTerminals.data_ptr<int8_t>();
+			for (int64_t i = config.episodeLength - 1, episode = 0; i < numSamples; i += config.episodeLength, episode++) {
+				bool truncated = (episode % 4) == 3;
+				terminals[i] = truncated ? RLGC::TerminalType::TRUNCATED : RLGC::TerminalType::NORMAL;
+				if (truncated)
+					numTruncs++;
+			}
+		}
+		torch::Tensor tNextTruncStates = torch::randn({ numTruncs, config.obsSize });
+
+		torch::Tensor tValPreds, tTruncValPreds;
+		double criticTime = TimePerCallMS(config.iterations, [&]() {
+			tValPreds = ppo->InferCritic(tStates);
+			if (numTruncs > 0)
+				tTruncValPreds = ppo->InferCritic(tNextTruncStates);
+		});
+		PrintRow("InferCritic", criticTime, numSamples);
+
+		torch::Tensor tAdvantages, tTargetVals, tReturns;
+		float rewClipPortion;
+		double gaeTime = TimePerCallMS(config.iterations, [&]() {
+			GAE::Compute(
+				tRewards, tTerminals, tValPreds, tTruncValPreds,
+				tAdvantages, tTargetVals, tReturns, rewClipPortion,
+				ppoConfig.gaeGamma, ppoConfig.gaeLambda, 1, ppoConfig.rewardClipRange
+			);
+		});
+		PrintRow("GAE::Compute", gaeTime, numSamples);
+
+		// Same layout as the learner's experience
+		experience.data.actions = tActions.to(torch::kInt32);
+		experience.data.logProbs = tLogProbs;
+		experience.data.actionMasks = tActionMasks;
+		experience.data.states = tStates;
+		experience.data.advantages = tAdvantages;
+		experience.data.targetValues = tTargetVals;
+	}
+
+	double batchesTime = TimePerCallMS(config.iterations, [&]() {
+		experience.GetAllBatchesShuffled(ppoConfig.batchSize, ppoConfig.overbatching);
+	});
+	PrintRow("GetAllBatchesShuffled", batchesTime, numSamples);
+
+	// Learn() updates the models, so every call after the first is on slightly different weights, like real training
+	bool isFirstIteration = true;
+	Report report = {};
+	double learnTime = TimePerCallMS(config.iterations, [&]() {
+		ppo->Learn(experience, report, isFirstIteration);
+		isFirstIteration = false;
+	});
+	PrintRow("PPOLearner::Learn", learnTime, numSamples);
+
+	delete ppo;
+	return 0;
+}
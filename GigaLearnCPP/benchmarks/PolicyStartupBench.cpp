@@ -0,0 +1,181 @@
+// Bot cold-start benchmark: time and memory from process start to the first inferred action
+// Built twice: GGL_RuntimeStartupBench loads an exported policy with PolicyRuntime (no libtorch),
+//	and GGL_InferUnitStartupBench (GGL_BENCH_INFERUNIT) loads the same policy's checkpoint with InferUnit
+// Run each in a fresh process, since the time spent loading shared libraries (e.g. libtorch) happens before main()
+// Usage:
+//	GGL_RuntimeStartupBench <policy file>
+//	GGL_InferUnitStartupBench <policy file> <checkpoint folder>
+//		(the policy file is only read for the model topology, which has to match the checkpoint)
+
+#include <GigaLearnCPP/Util/Timer.h>
+#include <GigaLearnCPP/Util/MappedFile.h>
+#include <GigaLearnCPP/Util/PolicyFile.h>
+
+#ifdef GGL_BENCH_INFERUNIT
+#include <GigaLearnCPP/Util/InferUnit.h>
+#else
+#include <GigaLearnCPP/Util/PolicyRuntime.h>
+#endif
+
+#include <iostream>
+#include <iomanip>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+using namespace GGL;
+using namespace RLGC;
+
+// Milliseconds since the OS created this process (includes loading shared libraries and static init)
+static double GetProcessAgeMS() {
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime, nowTime;
+	GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime);
+	GetSystemTimePreciseAsFileTime(&nowTime);
+	auto fnToTicks = [](FILETIME time) { return ((uint64_t)time.dwHighDateTime << 32) | time.dwLowDateTime; };
+	return (fnToTicks(nowTime) - fnToTicks(creationTime)) / 1e4; // 100ns ticks
+#else
+	// Field 22 of /proc/self/stat is the start time in clock ticks since boot
+	std::ifstream statFile("/proc/self/stat");
+	std::string statStr;
+	std::getline(statFile, statStr);
+	std::istringstream fields(statStr.substr(statStr.rfind(')') + 2)); // Skip the pid and process name
+	std::string field;
+	for (int i = 3; i <= 22; i++)
+		fields >> field;
+	double startSeconds = std::stod(field) / sysconf(_SC_CLK_TCK);
+
+	double uptimeSeconds;
+	std::ifstream("/proc/uptime") >> uptimeSeconds;
+	return (uptimeSeconds - startSeconds) * 1000;
+#endif
+}
+
+static double GetPeakMemoryMB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / (1024.0 * 1024.0); // Bytes
+#else
+	return usage.ru_maxrss / 1024.0; // Kilobytes
+#endif
+#endif
+}
+
+#ifdef GGL_BENCH_INFERUNIT
+// Obs and actions don't matter for timing, we only need the right sizes
+class ZeroObs : public ObsBuilder {
+public:
+	int obsSize;
+	ZeroObs(int obsSize) : obsSize(obsSize) {}
+	virtual FList BuildObs(const Player& player, const GameState& state) override {
+		return FList(obsSize, 0);
+	}
+};
+
+class EmptyActionParser : public ActionParser {
+public:
+	int numActions;
+	EmptyActionParser(int numActions) : numActions(numActions) {}
+	virtual Action ParseAction(int actionIdx, const Player& player, const GameState& state) override {
+		return Action();
+	}
+	virtual int GetActionAmount() override {
+		return numActions;
+	}
+};
+
+// Reads the model configs from the policy file's layer table
+static void ReadTopology(
+	std::filesystem::path policyPath,
+	int& outObsSize, int& outNumActions, PartialModelConfig& outSharedHead, PartialModelConfig& outPolicy) {
+
+	MappedFile file = MappedFile(policyPath);
+	auto header = file.Get<PolicyFile::Header>(0);
+	RG_ASSERT(header && header->version == PolicyFile::VERSION);
+	auto layers = file.Get<PolicyFile::LayerDesc>(header->layersOffset, header->numLayers);
+	RG_ASSERT(layers);
+
+	outObsSize = header->obsSize;
+	outNumActions = header->numActions;
+	outSharedHead.addOutputLayer = false;
+	for (int i = 0; i < header->numLayers; i++) {
+		bool isSharedHead = layers[i].stack == PolicyFile::STACK_SHARED_HEAD;
+		PartialModelConfig& config = isSharedHead ? outSharedHead : outPolicy;
+		config.activationType = (ModelActivationType)header->activationType;
+
+		// The policy's output layer is added by PPOLearner::MakeModels()
+		bool isPolicyOutput = !isSharedHead && (i == header->numLayers - 1);
+		if (!isPolicyOutput) {
+			config.addLayerNorm = layers[i].flags & PolicyFile::LAYER_HAS_NORM;
+			config.layerSizes.push_back(layers[i].numOutputs);
+		}
+	}
+}
+#endif
+
+int main(int argc, char** argv) {
+	double preMainMS = GetProcessAgeMS();
+
+#ifdef GGL_BENCH_INFERUNIT
+	if (argc < 3) {
+		std::cout << "Usage: " << argv[0] << " <policy file> <checkpoint folder>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	int obsSize, numActions;
+	PartialModelConfig sharedHeadConfig = {}, policyConfig = {};
+	ReadTopology(argv[1], obsSize, numActions, sharedHeadConfig, policyConfig);
+
+	Timer loadTimer = {};
+	InferUnit* inferUnit = new InferUnit(
+		new ZeroObs(obsSize), obsSize, new EmptyActionParser(numActions),
+		sharedHeadConfig, policyConfig, argv[2], false
+	);
+	double loadMS = loadTimer.Elapsed() * 1000;
+
+	Timer firstActionTimer = {};
+	GameState state = {};
+	state.players.resize(1);
+	inferUnit->InferAction(state.players[0], state, true);
+	double firstActionMS = firstActionTimer.Elapsed() * 1000;
+
+	const char* name = "InferUnit";
+#else
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " <policy file>" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Timer loadTimer = {};
+	PolicyRuntime* policy = new PolicyRuntime(argv[1]);
+	double loadMS = loadTimer.Elapsed() * 1000;
+
+	Timer firstActionTimer = {};
+	policy->InferAction(FList(policy->obsSize, 0), NULL, true);
+	double firstActionMS = firstActionTimer.Elapsed() * 1000;
+
+	const char* name = "PolicyRuntime";
+#endif
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << name << " cold start:" << std::endl;
+	std::cout << "\tBefore main(): " << preMainMS << "ms (OS clock resolution)" << std::endl;
+	std::cout << "\tLoad: " << loadMS << "ms" << std::endl;
+	std::cout << "\tFirst action: " << firstActionMS << "ms" << std::endl;
+	std::cout << "\tTotal: " << GetProcessAgeMS() << "ms" << std::endl;
+	std::cout << "\tPeak memory: " << GetPeakMemoryMB() << "MB" << std::endl;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,245 @@
+// Render stream benchmark and loopback check
+// Measures the encoded size and encode time of render frames (JSON, full binary, delta binary),
+// then streams frames through RenderSender to a local UDP socket and checks that every one decodes back exactly
+// Usage: GGL_RenderStreamBench [numCars] [numFrames]
+
+#include <GigaLearnCPP/Util/RenderSender.h>
+#include <GigaLearnCPP/Util/RenderFrame.h>
+#include <nlohmann/json.hpp>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+using namespace GGL;
+using namespace RLGC;
+
+// A moving scene, without needing RocketSim's arena meshes
+struct FakeScene {
+	GameState state;
+	std::mt19937 rng = std::mt19937(0);
+
+	FakeScene(int numCars) {
+		for (int i = 0; i < numCars; i++) {
+			Player player = {};
+			player.index = i;
+			player.carId = i + 1;
+			player.team = (Team)(i % 2);
+			player.pos = Vec(i * 300.f, 0, 17);
+			player.rotMat = RotMat::GetIdentity();
+			player.boost = 33;
+			player.isOnGround = true;
+			player.ballTouchedStep = false;
+			state.players.push_back(player);
+		}
+	}
+
+	void Step() {
+		std::uniform_real_distribution<float> dist(-1, 1);
+		state.ball.pos += Vec(dist(rng), dist(rng), dist(rng)) * 10;
+		state.ball.vel = Vec(dist(rng), dist(rng), dist(rng)) * 1000;
+
+		for (auto& player : state.players) {
+			// Cars on the ground mostly keep their height and orientation, which is what deltas save on
+			player.pos += Vec(dist(rng), dist(rng), 0) * 20;
+			player.vel = Vec(dist(rng), dist(rng), 0) * 1400;
+			if (dist(rng) > 0.9f)
+				player.boost = RS_CLAMP(player.boost + dist(rng) * 10, 0, 100);
+		}
+
+		if (dist(rng) > 0.8f) {
+			int padIdx = std::uniform_int_distribution<int>(0, state.boostPads.size() - 1)(rng);
+			state.boostPads[padIdx] = !state.boostPads[padIdx];
+		}
+	}
+};
+
+static bool VecEqual(const Vec& a, const Vec& b) {
+	return memcmp(&a.x, &b.x, sizeof(float)) == 0 && memcmp(&a.y, &b.y, sizeof(float)) == 0 && memcmp(&a.z, &b.z, sizeof(float)) == 0;
+}
+
+static bool FramesEqual(const RenderFrame::Frame& a, const RenderFrame::Frame& b) {
+	if (a.gameMode != b.gameMode || a.cars.size() != b.cars.size() || a.boostPads != b.boostPads)
+		return false;
+	if (!VecEqual(a.ballPos, b.ballPos) || !VecEqual(a.ballVel, b.ballVel) || !VecEqual(a.ballAngVel, b.ballAngVel))
+		return false;
+
+	for (int i = 0; i < a.cars.size(); i++) {
+		auto &carA = a.cars[i], &carB = b.cars[i];
+		if (carA.carId != carB.carId || carA.team != carB.team || carA.boost != carB.boost)
+			return false;
+		if (carA.isDemoed != carB.isDemoed || carA.isOnGround != carB.isOnGround || carA.hasFlip != carB.hasFlip || carA.ballTouched != carB.ballTouched)
+			return false;
+		if (!VecEqual(carA.pos, carB.pos) || !VecEqual(carA.forward, carB.forward) || !VecEqual(carA.right, carB.right))
+			return false;
+		if (!VecEqual(carA.up, carB.up) || !VecEqual(carA.vel, carB.vel) || !VecEqual(carA.angVel, carB.angVel))
+			return false;
+	}
+	return true;
+}
+
+static void CloseSocket(SocketHandle sock) {
+#ifdef _WIN32
+	closesocket(sock);
+#else
+	close(sock);
+#endif
+}
+
+// Streams frames through a RenderSender to a local socket, returns the number of frames that failed to arrive or decode
+static int RunLoopback(RenderFormat format, int numCars, int numFrames, int& outNumDeltas, size_t& outTotalBytes) {
+	SocketHandle recvSock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0; // Any free port
+	bind(recvSock, (sockaddr*)&addr, sizeof(addr));
+	socklen_t addrLen = sizeof(addr);
+	getsockname(recvSock, (sockaddr*)&addr, &addrLen);
+
+#ifdef _WIN32
+	DWORD timeoutMS = 1000;
+	setsockopt(recvSock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMS, sizeof(timeoutMS));
+#else
+	timeval timeout = { 1, 0 };
+	setsockopt(recvSock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+	// A zero delta time means Send() never sleeps, and waiting for each frame to arrive means none are skipped
+	RenderSender sender = RenderSender(1, format, "127.0.0.1", ntohs(addr.sin_port), 100'000);
+	FakeScene scene = FakeScene(numCars);
+	scene.state.deltaTime = 0;
+
+	std::vector<uint32_t> keyframe = {};
+	std::vector<char> buffer(1 << 16);
+	int numFailed = 0;
+	outNumDeltas = 0;
+	outTotalBytes = 0;
+	for (int i = 0; i < numFrames; i++) {
+		scene.Step();
+		sender.Send(scene.state);
+		RenderFrame::Frame expected = RenderFrame::Frame::FromState(scene.state);
+
+		int size = recv(recvSock, buffer.data(), (int)buffer.size(), 0);
+		if (size <= 0) {
+			numFailed++;
+			continue;
+		}
+		outTotalBytes += size;
+
+		if (format == RenderFormat::BINARY) {
+			RenderFrame::Frame decoded;
+			uint32_t frameIdx;
+			if (!RenderFrame::Decode(buffer.data(), size, keyframe, decoded, frameIdx) || frameIdx != i || !FramesEqual(decoded, expected)) {
+				numFailed++;
+				continue;
+			}
+
+			uint32_t versionAndFlags;
+			memcpy(&versionAndFlags, buffer.data() + sizeof(uint32_t), sizeof(uint32_t));
+			if ((versionAndFlags >> 16) & RenderFrame::FLAG_DELTA)
+				outNumDeltas++;
+		} else {
+			auto j = nlohmann::json::parse(std::string(buffer.data(), size), nullptr, false);
+			if (j.is_discarded() || j["cars"].size() != numCars || j["boost_pad_states"] != expected.boostPads || j["ball_phys"]["pos"][0] != expected.ballPos.x)
+				numFailed++;
+		}
+	}
+
+	CloseSocket(recvSock);
+	return numFailed;
+}
+
+template <typename FN>
+static double TimePerFrameUS(int iterations, FN&& fn) {
+	fn(); // Warmup
+	auto startTime = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+		fn();
+	std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - startTime;
+	return elapsed.count() / iterations;
+}
+
+int main(int argc, char** argv) {
+	int numCars = argc > 1 ? std::stoi(argv[1]) : 6;
+	int numFrames = argc > 2 ? std::stoi(argv[2]) : 1000;
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+
+	std::cout << "Render stream benchmark (" << numCars << " cars, " << numFrames << " frames)" << std::endl;
+
+	// Encoding
+	{
+		FakeScene scene = FakeScene(numCars);
+		scene.Step();
+		RenderFrame::Frame frame = RenderFrame::Frame::FromState(scene.state);
+		auto keyframe = RenderFrame::Encode(frame, 0);
+		scene.Step();
+		RenderFrame::Frame nextFrame = RenderFrame::Frame::FromState(scene.state);
+		auto fullFrame = RenderFrame::Encode(nextFrame, 1);
+
+		size_t jsonBytes = 0, deltaBytes = 0;
+		double jsonTime = TimePerFrameUS(numFrames, [&]() {
+			// Roughly what RenderSender writes for RocketSimVis
+			nlohmann::json j = {};
+			j["ball_phys"]["pos"] = { nextFrame.ballPos.x, nextFrame.ballPos.y, nextFrame.ballPos.z };
+			std::vector<nlohmann::json> cars = {};
+			for (auto& car : nextFrame.cars) {
+				nlohmann::json carJ = {};
+				for (auto* vec : { &car.pos, &car.forward, &car.right, &car.up, &car.vel, &car.angVel })
+					carJ["phys"].push_back({ vec->x, vec->y, vec->z });
+				carJ["boost_amount"] = car.boost / 100;
+				cars.push_back(carJ);
+			}
+			j["cars"] = cars;
+			j["boost_pad_states"] = nextFrame.boostPads;
+			jsonBytes = j.dump().size();
+		});
+		double fullTime = TimePerFrameUS(numFrames, [&]() { fullFrame = RenderFrame::Encode(nextFrame, 1); });
+		double deltaTime = TimePerFrameUS(numFrames, [&]() { deltaBytes = RenderFrame::EncodeDelta(fullFrame, keyframe).size() * sizeof(uint32_t); });
+
+		std::cout << std::setw(14) << "format" << std::setw(12) << "bytes" << std::setw(16) << "us/frame" << std::endl;
+		std::cout << std::fixed << std::setprecision(2);
+		std::cout << std::setw(14) << "json" << std::setw(12) << jsonBytes << std::setw(16) << jsonTime << std::endl;
+		std::cout << std::setw(14) << "binary full" << std::setw(12) << fullFrame.size() * sizeof(uint32_t) << std::setw(16) << fullTime << std::endl;
+		std::cout << std::setw(14) << "binary delta" << std::setw(12) << deltaBytes << std::setw(16) << (fullTime + deltaTime) << std::endl;
+	}
+
+	// Loopback
+	bool passed = true;
+	for (RenderFormat format : { RenderFormat::BINARY, RenderFormat::ROCKETSIMVIS_JSON }) {
+		int numDeltas;
+		size_t totalBytes;
+		int numFailed = RunLoopback(format, numCars, numFrames, numDeltas, totalBytes);
+		passed &= (numFailed == 0);
+
+		std::cout
+			<< "Loopback (" << (format == RenderFormat::BINARY ? "binary" : "json") << "): "
+			<< (numFrames - numFailed) << "/" << numFrames << " frames decoded, "
+			<< std::setprecision(1) << (totalBytes / (double)numFrames) << " bytes/frame avg";
+		if (format == RenderFormat::BINARY)
+			std::cout << ", " << numDeltas << " deltas";
+		std::cout << std::endl;
+	}
+
+	std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+	return passed ? 0 : 1;
+}
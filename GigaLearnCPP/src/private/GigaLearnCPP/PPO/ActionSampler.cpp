@@ -0,0 +1,83 @@
+#include "ActionSampler.h"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+	// SplitMix64 finalizer, gives us an independent random number for every (seed, counter) pair
+	inline uint64_t HashCounter(uint64_t seed, uint64_t counter) {
+		uint64_t x = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+	// Uniform float in the open interval (0, 1)
+	inline float CounterToUniform(uint64_t seed, uint64_t counter) {
+		return ((HashCounter(seed, counter) >> 40) + 0.5f) * (1.f / (1 << 24));
+	}
+
+	inline float SampleGumbel(uint64_t seed, uint64_t counter) {
+		return -logf(-logf(CounterToUniform(seed, counter)));
+	}
+}
+
+void GGL::ActionSampler::Sample(
+	const float* logits, int64_t logitsStride, const uint8_t* actionMasks, int64_t numActions,
+	int64_t rowStart, int64_t rowEnd,
+	float temperature, bool deterministic, uint64_t seed,
+	int64_t* outActions, float* outLogProbs) {
+
+	constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+	const float invTemp = 1 / temperature;
+	const float minLogProb = logf(ACTION_MIN_PROB);
+
+	for (int64_t row = rowStart; row < rowEnd; row++) {
+		const float* rowLogits = logits + row * logitsStride;
+		const uint8_t* rowMask = actionMasks + row * numActions;
+		uint64_t counterBase = (uint64_t)row * numActions;
+
+		// Running max and sum for the log-sum-exp, rescaled whenever the max changes
+		float runningMax = NEG_INF, runningSum = 0;
+
+		// Best Gumbel-perturbed (or, if deterministic, plain) logit
+		float bestScore = NEG_INF, bestLogit = 0;
+		int64_t bestAction = -1;
+
+		for (int pass = 0; pass < 2; pass++) {
+			// The second pass only happens if every action was masked
+			// The unfused path effectively ignores the mask in that case, so we do too
+			bool ignoreMask = (pass == 1);
+
+			for (int64_t i = 0; i < numActions; i++) {
+				if (!ignoreMask && !rowMask[i])
+					continue;
+
+				float logit = rowLogits[i] * invTemp;
+
+				if (logit > runningMax) {
+					runningSum = runningSum * expf(runningMax - logit) + 1;
+					runningMax = logit;
+				} else {
+					runningSum += expf(logit - runningMax);
+				}
+
+				float score = deterministic ? logit : (logit + SampleGumbel(seed, counterBase + i));
+				if (score > bestScore) {
+					bestScore = score;
+					bestLogit = logit;
+					bestAction = i;
+				}
+			}
+
+			if (bestAction != -1)
+				break;
+		}
+
+		outActions[row] = bestAction;
+		if (outLogProbs) {
+			float logProb = bestLogit - (runningMax + logf(runningSum));
+			outLogProbs[row] = logProb < minLogProb ? minLogProb : (logProb > 0 ? 0 : logProb);
+		}
+	}
+}
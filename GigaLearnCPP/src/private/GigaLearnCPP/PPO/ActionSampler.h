@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+namespace GGL {
+	// Fused masked-softmax action sampling for CPU inference
+	// Replaces the softmax -> clamp -> multinomial -> log -> gather chain with one pass over each row of logits
+	namespace ActionSampler {
+
+		// Must match the minimum action probability used by PPOLearner
+		constexpr float ACTION_MIN_PROB = 1e-11f;
+
+		// Samples an action for each row in [rowStart, rowEnd) from softmax(logits / temperature), only over the actions allowed by actionMasks
+		// Sampling uses the Gumbel-max trick with a counter-based RNG keyed on (seed, row, action),
+		//	so the result doesn't depend on how rows are split between threads
+		// If deterministic, the most probable allowed action is chosen instead
+		// Each row of logits is logitsStride floats apart, while actionMasks and the outputs are packed
+		// outLogProbs (optional) receives the log probability of each chosen action, clamped the same way as PPOLearner's probabilities
+		// Rows with no allowed actions fall back to allowing every action
+		void Sample(
+			const float* logits, int64_t logitsStride, const uint8_t* actionMasks, int64_t numActions,
+			int64_t rowStart, int64_t rowEnd,
+			float temperature, bool deterministic, uint64_t seed,
+			int64_t* outActions, float* outLogProbs
+		);
+	}
+}
@@ -1,5 +1,7 @@
 #include "ExperienceBuffer.h"
 
+#include <RLGymCPP/Profiler.h>
+
 using namespace torch;
 
 GGL::ExperienceBuffer::ExperienceBuffer(int seed, torch::Device device) :
@@ -26,6 +28,7 @@ GGL::ExperienceTensors GGL::ExperienceBuffer::_GetSamples(const int64_t* indices
 }
 
 std::vector<GGL::ExperienceTensors> GGL::ExperienceBuffer::GetAllBatchesShuffled(int64_t batchSize, bool overbatching) {
+	RG_PROFILE_SCOPE("ExperienceBuffer::GetAllBatchesShuffled");
 
 	RG_NO_GRAD;
 
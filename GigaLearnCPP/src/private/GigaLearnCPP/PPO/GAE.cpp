@@ -1,21 +1,30 @@
 #include "GAE.h"
 
+#include <RLGymCPP/ThreadPool.h>
+#include <RLGymCPP/Profiler.h>
+
+namespace {
+	// A run of samples that ends with a terminal (or with the end of the experience)
+	// The GAE recurrence is reset at every terminal, so segments can be computed independently
+	struct GAESegment {
+		int start, end; // End is exclusive
+		float truncValPred; // Next value prediction if this segment ends in a truncation
+	};
+
+	// Don't bother splitting up work smaller than this
+	constexpr int GAE_MIN_SAMPLES_PER_JOB = 1 << 14;
+}
+
 void GGL::GAE::Compute(
 	torch::Tensor rews, torch::Tensor terminals, torch::Tensor valPreds, torch::Tensor truncValPreds,
 	torch::Tensor& outAdvantages, torch::Tensor& outTargetValues, torch::Tensor& outReturns, float& outRewClipPortion,
 	float gamma, float lambda, float returnStd, float clipRange
 ) {
+	RG_PROFILE_SCOPE("GAE::Compute");
 
 	bool hasTruncValPreds = truncValPreds.defined();
 
-	float prevLambda = 0;
 	int numReturns = rews.size(0);
-	outAdvantages = torch::zeros(numReturns);
-	outReturns = torch::zeros(numReturns);
-	float prevRet = 0;
-	int truncCount = 0;
-
-	float totalRew = 0, totalClippedRew = 0;
 
 	// Make sure all tensors are contiguous first
 	rews = rews.contiguous();
@@ -28,6 +37,7 @@ void GGL::GAE::Compute(
 	auto _terminals = terminals.const_data_ptr<int8_t>();
 	auto _rews = rews.const_data_ptr<float>();
 	auto _valPreds = valPreds.const_data_ptr<float>();
+	int numValPreds = valPreds.size(0);
 
 	const float* _truncValPreds;
 	int numTruncs;
@@ -39,64 +49,125 @@ void GGL::GAE::Compute(
 		numTruncs = 0;
 	}
 
-	auto _outReturns = std::vector<float>(numReturns, 0);
-	auto _outAdvantages = std::vector<float>(numReturns, 0);
+	// Split the experience into segments at every terminal
+	// Truncated next states are recorded in the same order as the experience, so they are paired up in forward order
+	std::vector<GAESegment> segments = {};
+	{
+		int truncCount = 0;
+		int segmentStart = 0;
+		for (int step = 0; step < numReturns; step++) {
+			uint8_t terminal = _terminals[step];
+			if (!terminal && step != numReturns - 1)
+				continue;
+
+			float truncValPred = 0;
+			if (terminal == RLGC::TerminalType::TRUNCATED) {
+				if (!hasTruncValPreds)
+					RG_ERR_CLOSE("GAE encountered a truncated terminal, but has no truncated val pred");
+
+				if (truncCount >= numTruncs)
+					RG_ERR_CLOSE("GAE encountered too many truncated terminals, not enough val preds (max: " << numTruncs << ")");
+
+				truncValPred = _truncValPreds[truncCount];
+				truncCount++;
+			}
+
+			segments.push_back({ segmentStart, step + 1, truncValPred });
+			segmentStart = step + 1;
+		}
 
-	for (int step = numReturns - 1; step >= 0; step--) {
-		uint8_t terminal = _terminals[step];
-		float done = terminal == RLGC::TerminalType::NORMAL;
-		float trunc = terminal == RLGC::TerminalType::TRUNCATED;
+		if (hasTruncValPreds)
+			if (truncCount != numTruncs)
+				RG_ERR_CLOSE("GAE didn't receive expected truncation count (only " << truncCount << "/" << numTruncs << ")");
+	}
 
-		float curReward;
-		if (returnStd != 0) {
-			curReward = _rews[step] / returnStd;
+	outReturns = torch::empty(numReturns);
+	outAdvantages = torch::empty(numReturns);
+	float* _outReturns = outReturns.data_ptr<float>();
+	float* _outAdvantages = outAdvantages.data_ptr<float>();
+
+	// Split the segments into jobs of roughly equal sample counts
+	int numJobs = RS_CLAMP(numReturns / GAE_MIN_SAMPLES_PER_JOB, 1, RLGC::g_ThreadPool.GetNumThreads() * 4);
+	numJobs = RS_MIN(numJobs, (int)segments.size());
+	std::vector<int> jobSegmentStarts = {};
+	for (int i = 0, job = 0; i < segments.size() && job < numJobs; i++) {
+		int64_t jobSampleStart = (int64_t)numReturns * job / numJobs;
+		if (segments[i].end > jobSampleStart) {
+			jobSegmentStarts.push_back(i);
+			job++;
+		}
+	}
+	numJobs = jobSegmentStarts.size();
+	jobSegmentStarts.push_back(segments.size());
 
-			totalRew += abs(curReward);
+	std::vector<float> jobTotalRews(numJobs, 0), jobTotalClippedRews(numJobs, 0);
 
-			// We only clip if returns are standardized
-			if (clipRange > 0)
-				curReward = RS_CLAMP(curReward, -clipRange, clipRange);
+	auto fnComputeJob = [&](int jobIdx) {
+		RG_PROFILE_SCOPE("GAE::ComputeJob");
 
-			totalClippedRew += abs(curReward);
-		} else {
-			curReward = _rews[step];
-			totalRew += abs(curReward);
-		}
+		float totalRew = 0, totalClippedRew = 0;
 
-		float nextValPred;
-		if (terminal == RLGC::TerminalType::TRUNCATED) {
-			// We've encountered a truncation
-			// Pull the next truncated value
+		for (int segmentIdx = jobSegmentStarts[jobIdx]; segmentIdx < jobSegmentStarts[jobIdx + 1]; segmentIdx++) {
+			const GAESegment& segment = segments[segmentIdx];
 
-			if (!hasTruncValPreds)
-				RG_ERR_CLOSE("GAE encountered a truncated terminal, but has no truncated val pred");
+			float prevLambda = 0;
+			float prevRet = 0;
+			for (int step = segment.end - 1; step >= segment.start; step--) {
+				uint8_t terminal = _terminals[step];
+				float done = terminal == RLGC::TerminalType::NORMAL;
+				float trunc = terminal == RLGC::TerminalType::TRUNCATED;
 
-			if (truncCount >= numTruncs)
-				RG_ERR_CLOSE("GAE encountered too many truncated terminals, not enough val preds (max: " << numTruncs << ")")
+				float curReward;
+				if (returnStd != 0) {
+					curReward = _rews[step] / returnStd;
 
-			nextValPred = _truncValPreds[truncCount];
-			truncCount++;
-		} else {
-			nextValPred = _valPreds[step + 1];
+					totalRew += abs(curReward);
+
+					// We only clip if returns are standardized
+					if (clipRange > 0)
+						curReward = RS_CLAMP(curReward, -clipRange, clipRange);
+
+					totalClippedRew += abs(curReward);
+				} else {
+					curReward = _rews[step];
+					totalRew += abs(curReward);
+				}
+
+				float nextValPred;
+				if (terminal == RLGC::TerminalType::TRUNCATED) {
+					nextValPred = segment.truncValPred;
+				} else {
+					nextValPred = (step + 1 < numValPreds) ? _valPreds[step + 1] : 0;
+				}
+
+				float predReturn = curReward + gamma * nextValPred * (1 - done);
+				float delta = predReturn - _valPreds[step];
+				float curReturn = _rews[step] + prevRet * gamma * (1 - done) * (1 - trunc);
+				_outReturns[step] = curReturn;
+
+				prevLambda = delta + gamma * lambda * (1 - done) * (1 - trunc) * prevLambda;
+				_outAdvantages[step] = prevLambda;
+
+				prevRet = curReturn;
+			}
 		}
 
-		float predReturn = curReward + gamma * nextValPred * (1 - done);
-		float delta = predReturn - _valPreds[step];
-		float curReturn = _rews[step] + prevRet * gamma * (1 - done) * (1 - trunc);
-		_outReturns[step] = curReturn;
-		
-		prevLambda = delta + gamma * lambda * (1 - done) * (1 - trunc) * prevLambda;
-		_outAdvantages[step] = prevLambda;
+		jobTotalRews[jobIdx] = totalRew;
+		jobTotalClippedRews[jobIdx] = totalClippedRew;
+	};
 
-		prevRet = curReturn;
+	if (numJobs > 1) {
+		RLGC::g_ThreadPool.StartBatchedJobs(fnComputeJob, numJobs, false);
+	} else if (numJobs == 1) {
+		fnComputeJob(0);
+	}
+
+	float totalRew = 0, totalClippedRew = 0;
+	for (int i = 0; i < numJobs; i++) {
+		totalRew += jobTotalRews[i];
+		totalClippedRew += jobTotalClippedRews[i];
 	}
-	
-	if (hasTruncValPreds)
-		if (truncCount != truncValPreds.size(0))
-			RG_ERR_CLOSE("GAE didn't receive expected truncation count (only " << truncCount << "/" << truncValPreds.size(0) << ")");
 
-	outReturns = torch::tensor(_outReturns);
-	outAdvantages = torch::tensor(_outAdvantages);
 	outTargetValues = valPreds.slice(0, 0, numReturns) + outAdvantages;
 	outRewClipPortion = (totalRew - totalClippedRew) / RS_MAX(totalRew, 1e-7f);
-}
\ No newline at end of file
+}
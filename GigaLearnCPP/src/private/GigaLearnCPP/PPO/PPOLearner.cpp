@@ -4,6 +4,10 @@
 #include <torch/nn/utils/clip_grad.h>
 #include <torch/csrc/api/include/torch/serialize.h>
 #include <public/GigaLearnCPP/Util/AvgTracker.h>
+#include <ATen/CPUGeneratorImpl.h>
+#include <ATen/Parallel.h>
+#include "ActionSampler.h"
+#include <RLGymCPP/Profiler.h>
 
 using namespace torch;
 
@@ -71,32 +75,41 @@ void GGL::PPOLearner::MakeModels(
 		outModels.Add(new Model("critic", fullCriticConfig, device));
 }
 
-torch::Tensor GGL::PPOLearner::InferPolicyProbsFromModels(
+torch::Tensor GGL::PPOLearner::InferSharedHead(ModelSet& models, torch::Tensor obs, bool halfPrec) {
+	if (models["shared_head"]) {
+		return models["shared_head"]->Forward(obs, halfPrec);
+	} else {
+		return obs;
+	}
+}
+
+torch::Tensor GGL::PPOLearner::InferPolicyProbsFromHeadOutput(
 	ModelSet& models,
-	torch::Tensor obs, torch::Tensor actionMasks,
+	torch::Tensor headOutput, torch::Tensor actionMasks,
 	float temperature, bool halfPrec) {
 
 	actionMasks = actionMasks.to(torch::kBool);
 
-	constexpr float ACTION_MIN_PROB = 1e-11f;
+	constexpr float ACTION_MIN_PROB = ActionSampler::ACTION_MIN_PROB;
 	constexpr float ACTION_DISABLED_LOGIT = -1e10f;
 
-	if (models["shared_head"])
-		obs = models["shared_head"]->Forward(obs, halfPrec);
-
-	auto logits = models["policy"]->Forward(obs, halfPrec) / temperature;
+	auto logits = models["policy"]->Forward(headOutput, halfPrec) / temperature;
 
 	auto result = torch::softmax(logits + ACTION_DISABLED_LOGIT * actionMasks.logical_not(), -1);
 	return result.view({ -1, models["policy"]->config.numOutputs }).clamp(ACTION_MIN_PROB, 1);
 }
 
-void GGL::PPOLearner::InferActionsFromModels(
+torch::Tensor GGL::PPOLearner::InferPolicyProbsFromModels(
 	ModelSet& models,
-	torch::Tensor obs, torch::Tensor actionMasks, 
-	bool deterministic, float temperature, bool halfPrec,
-	torch::Tensor* outActions, torch::Tensor* outLogProbs) {
+	torch::Tensor obs, torch::Tensor actionMasks,
+	float temperature, bool halfPrec) {
 
-	auto probs = InferPolicyProbsFromModels(models, obs, actionMasks, temperature, halfPrec);
+	return InferPolicyProbsFromHeadOutput(models, InferSharedHead(models, obs, halfPrec), actionMasks, temperature, halfPrec);
+}
+
+void GGL::PPOLearner::InferActionsFromProbs(
+	torch::Tensor probs, bool deterministic,
+	torch::Tensor* outActions, torch::Tensor* outLogProbs) {
 
 	if (deterministic) {
 		auto action = probs.argmax(1);
@@ -113,16 +126,115 @@ void GGL::PPOLearner::InferActionsFromModels(
 	}
 }
 
-void GGL::PPOLearner::InferActions(torch::Tensor obs, torch::Tensor actionMasks, torch::Tensor* outActions, torch::Tensor* outLogProbs, ModelSet* models) {
-	InferActionsFromModels(models ? *models : this->models, obs, actionMasks, config.deterministic, config.policyTemperature, config.useHalfPrecision, outActions, outLogProbs);
+void GGL::PPOLearner::InferActionsFromHeadOutput(
+	ModelSet& models,
+	torch::Tensor headOutput, torch::Tensor actionMasks,
+	bool deterministic, float temperature, bool halfPrec,
+	torch::Tensor* outActions, torch::Tensor* outLogProbs) {
+
+	if (!headOutput.is_cpu() || torch::GradMode::is_enabled()) {
+		auto probs = InferPolicyProbsFromHeadOutput(models, headOutput, actionMasks, temperature, halfPrec);
+		InferActionsFromProbs(probs, deterministic, outActions, outLogProbs);
+		return;
+	}
+
+	// On the CPU, sample straight from the logits with the fused sampler
+	int64_t numActions = models["policy"]->config.numOutputs;
+	auto logits = models["policy"]->Forward(headOutput, halfPrec).to(torch::kFloat32).view({ -1, numActions }).contiguous();
+	actionMasks = actionMasks.to(torch::kUInt8).contiguous();
+	int64_t numRows = logits.size(0);
+
+	bool wantLogProbs = outLogProbs && !deterministic;
+	auto actions = torch::empty({ numRows }, torch::kInt64);
+	auto logProbs = wantLogProbs ? torch::empty({ numRows }, torch::kFloat32) : torch::Tensor();
+
+	// Take the seed from torch's generator so manual seeding still makes sampling reproducible
+	uint64_t seed = 0;
+	if (!deterministic) {
+		auto gen = at::detail::getDefaultCPUGenerator();
+		std::lock_guard<std::mutex> lock(gen.mutex());
+		seed = gen.get<at::CPUGeneratorImpl>()->random64();
+	}
+
+	const float* logitsPtr = logits.data_ptr<float>();
+	const uint8_t* masksPtr = actionMasks.data_ptr<uint8_t>();
+	int64_t* actionsPtr = actions.data_ptr<int64_t>();
+	float* logProbsPtr = wantLogProbs ? logProbs.data_ptr<float>() : NULL;
+
+	constexpr int64_t MIN_ROWS_PER_JOB = 256;
+	at::parallel_for(0, numRows, MIN_ROWS_PER_JOB,
+		[&](int64_t start, int64_t end) {
+			ActionSampler::Sample(
+				logitsPtr, numActions, masksPtr, numActions, start, end,
+				temperature, deterministic, seed,
+				actionsPtr, logProbsPtr
+			);
+		}
+	);
+
+	if (outActions)
+		*outActions = actions;
+	if (wantLogProbs)
+		*outLogProbs = logProbs;
 }
 
-torch::Tensor GGL::PPOLearner::InferCritic(torch::Tensor obs) {
+void GGL::PPOLearner::InferActionsFromModels(
+	ModelSet& models,
+	torch::Tensor obs, torch::Tensor actionMasks, 
+	bool deterministic, float temperature, bool halfPrec,
+	torch::Tensor* outActions, torch::Tensor* outLogProbs) {
 
-	if (models["shared_head"])
-		obs = models["shared_head"]->Forward(obs, config.useHalfPrecision);
+	InferActionsFromHeadOutput(models, InferSharedHead(models, obs, halfPrec), actionMasks, deterministic, temperature, halfPrec, outActions, outLogProbs);
+}
+
+float GGL::PPOLearner::CalibrateInt8(ModelSet& models, torch::Tensor sampleObs, torch::Tensor sampleActionMasks) {
+	RG_NO_GRAD;
+
+	Model* sharedHead = models["shared_head"];
+	Model* policy = models["policy"];
+	RG_ASSERT(policy->device.is_cpu());
+
+	sampleObs = sampleObs.to(torch::kFloat32);
+	auto headOutput = sharedHead ? sharedHead->seq->forward(sampleObs) : sampleObs;
+
+	// Each model is calibrated on its full-precision inputs
+	if (sharedHead && sharedHead->config.int8Inference)
+		sharedHead->SetInt8Calibration(sampleObs);
+	if (policy->config.int8Inference)
+		policy->SetInt8Calibration(headOutput);
+
+	constexpr float ACTION_DISABLED_LOGIT = -1e10f;
+	auto disabledActions = sampleActionMasks.to(torch::kBool).logical_not();
+	auto fullPrecLogits = policy->seq->forward(headOutput).masked_fill(disabledActions, ACTION_DISABLED_LOGIT);
+	auto int8Logits = policy->Forward(InferSharedHead(models, sampleObs, false), false).masked_fill(disabledActions, ACTION_DISABLED_LOGIT);
+	return (fullPrecLogits.argmax(-1) == int8Logits.argmax(-1)).to(torch::kFloat32).mean().item<float>();
+}
 
-	return models["critic"]->Forward(obs, config.useHalfPrecision).flatten();
+void GGL::PPOLearner::InferActions(
+	torch::Tensor obs, torch::Tensor actionMasks, 
+	torch::Tensor* outActions, torch::Tensor* outLogProbs, 
+	ModelSet* models, torch::Tensor* outValues) {
+	RG_PROFILE_SCOPE("PPOLearner::InferActions");
+
+	if (outValues) {
+		if (models)
+			RG_ERR_CLOSE("PPOLearner::InferActions(): Cannot infer values with a different model set");
+
+		auto headOutput = InferSharedHead(this->models, obs, config.useHalfPrecision);
+		InferActionsFromHeadOutput(this->models, headOutput, actionMasks, config.deterministic, config.policyTemperature, config.useHalfPrecision, outActions, outLogProbs);
+		*outValues = InferCriticFromHeadOutput(headOutput, config.useHalfPrecision);
+	} else {
+		InferActionsFromModels(models ? *models : this->models, obs, actionMasks, config.deterministic, config.policyTemperature, config.useHalfPrecision, outActions, outLogProbs);
+	}
+}
+
+torch::Tensor GGL::PPOLearner::InferCritic(torch::Tensor obs) {
+	RG_PROFILE_SCOPE("PPOLearner::InferCritic");
+	return InferCriticFromHeadOutput(InferSharedHead(models, obs, config.useHalfPrecision), config.useHalfPrecision);
+}
+
+torch::Tensor GGL::PPOLearner::InferCriticFromHeadOutput(torch::Tensor headOutput, bool halfPrec) {
+	return models["critic"]->Forward(headOutput, halfPrec).flatten();
 }
 
 torch::Tensor ComputeEntropy(torch::Tensor probs, torch::Tensor actionMasks, bool maskEntropy) {
@@ -141,7 +253,46 @@ torch::Tensor ComputeEntropy(torch::Tensor probs, torch::Tensor actionMasks, boo
 	return entropy.mean();
 }
 
+void GGL::PPOLearner::InferActionsGrouped(
+	torch::Tensor obs, torch::Tensor actionMasks,
+	const std::vector<ModelSet*>& groupModels, const std::vector<int>& groupSizes, torch::Tensor groupOrder,
+	torch::Tensor* outActions, torch::Tensor* outFirstLogProbs, torch::Tensor* outFirstValues) {
+
+	RG_ASSERT(groupModels.size() == groupSizes.size());
+
+	if ((outFirstLogProbs || outFirstValues) && groupModels[0] != NULL)
+		RG_ERR_CLOSE("PPOLearner::InferActionsGrouped(): Can only output log probs/values if the first group is the current policy");
+
+	// Gather all rows into group order and send them to the device all at once
+	auto groupedObs = obs.index_select(0, groupOrder).to(device, true);
+	auto groupedActionMasks = actionMasks.index_select(0, groupOrder).to(device, true);
+
+	std::vector<torch::Tensor> groupActions = {};
+	int64_t start = 0;
+	for (int i = 0; i < groupModels.size(); i++) {
+		int64_t end = start + groupSizes[i];
+		if (end == start && i > 0)
+			continue;
+
+		torch::Tensor curActions;
+		InferActions(
+			groupedObs.slice(0, start, end), groupedActionMasks.slice(0, start, end),
+			&curActions, (i == 0) ? outFirstLogProbs : NULL, 
+			groupModels[i], (i == 0) ? outFirstValues : NULL
+		);
+		groupActions.push_back(curActions);
+		start = end;
+	}
+	RG_ASSERT(start == groupOrder.size(0));
+
+	// Scatter back into the original row order
+	auto groupedActions = torch::cat(groupActions).cpu();
+	*outActions = torch::empty_like(groupedActions).index_copy_(0, groupOrder, groupedActions);
+}
+
 void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool isFirstIteration) {
+	RG_PROFILE_SCOPE("PPOLearner::Learn");
+
 	auto mseLoss = torch::nn::MSELoss();
 
 	MutAvgTracker
@@ -162,12 +313,22 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 	bool trainCritic = config.criticLR != 0;
 	bool trainSharedHead = models["shared_head"] && (trainPolicy || trainCritic);
 
-	for (int epoch = 0; epoch < config.epochs; epoch++) {
+	bool useTargetKL = config.targetKL > 0 && trainPolicy;
+	bool stoppedEarly = false;
+	float epochsRan = 0;
+
+	for (int epoch = 0; epoch < config.epochs && !stoppedEarly; epoch++) {
+		RG_PROFILE_SCOPE("PPOLearner::Epoch");
 
 		// Get randomly-ordered timesteps for PPO
 		auto batches = experience.GetAllBatchesShuffled(config.batchSize, config.overbatching);
 
-		for (auto& batch : batches) {
+		for (int batchIdx = 0; batchIdx < batches.size(); batchIdx++) {
+			auto& batch = batches[batchIdx];
+
+			// Sum of the minibatch KL divergences, weighted by minibatch size, kept on the device
+			torch::Tensor batchKL;
+
 			auto batchActs = batch.actions;
 			auto batchOldProbs = batch.logProbs;
 			auto batchObs = batch.states;
@@ -176,6 +337,7 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 			auto batchAdvantages = batch.advantages;
 
 			auto fnRunMinibatch = [&](int start, int stop) {
+				RG_PROFILE_SCOPE("PPOLearner::Minibatch");
 
 				float batchSizeRatio = (stop - start) / (float)config.batchSize;
 
@@ -188,13 +350,19 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 				auto oldProbs = batchOldProbs.slice(0, start, stop).to(device, true, true);
 				auto targetValues = batchTargetValues.slice(0, start, stop).to(device, true, true);
 
+				// Run the shared head once, its output is used by both the policy and the critic
+				// Both losses are then backpropagated through this single activation
+				torch::Tensor headOutput;
+				if (trainPolicy || trainCritic)
+					headOutput = InferSharedHead(models, obs, false);
+
 				torch::Tensor probs, logProbs, entropy, ratio, clipped, policyLoss, ppoLoss;
 				if (trainPolicy) {
 
 					// Get policy log probs and entropy
 					float curEntropy;
 					{
-						probs = InferPolicyProbsFromModels(models, obs, actionMasks, config.policyTemperature, false);
+						probs = InferPolicyProbsFromHeadOutput(models, headOutput, actionMasks, config.policyTemperature, false);
 						logProbs = probs.log().gather(-1, acts.unsqueeze(-1));
 						entropy = ComputeEntropy(probs, actionMasks, config.maskEntropy);
 						curEntropy = entropy.detach().cpu().item<float>();
@@ -237,7 +405,7 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 
 				torch::Tensor criticLoss;
 				if (trainCritic) {
-					auto vals = InferCritic(obs);
+					auto vals = InferCriticFromHeadOutput(headOutput, false);
 
 					// Compute value loss
 					vals = vals.view_as(targetValues);
@@ -252,13 +420,17 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 
 						auto logRatio = logProbs - oldProbs;
 						auto klTensor = (exp(logRatio) - 1) - logRatio;
-						avgDivergence += klTensor.mean().detach().cpu().item<float>();
+						auto klMean = klTensor.mean();
+						if (useTargetKL)
+							batchKL = batchKL.defined() ? (batchKL + klMean * batchSizeRatio) : (klMean * batchSizeRatio);
+						avgDivergence += klMean.detach().cpu().item<float>();
 
 						auto clipFraction = mean((abs(ratio - 1) > config.clipRange).to(kFloat));
 						avgClip += clipFraction.cpu().item<float>();
 					}
 				}
 
+				RG_PROFILE_SCOPE("PPOLearner::Backward");
 				if (trainPolicy && trainCritic) {
 					auto combinedLoss = ppoLoss + criticLoss;
 					combinedLoss.backward();
@@ -282,16 +454,30 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 				}
 			}
 
+			if (useTargetKL && batchKL.item<float>() > config.targetKL) {
+				// The policy has already moved far enough, throw away this batch and stop
+				models.ZeroGrads();
+				epochsRan += batchIdx / (float)batches.size();
+				stoppedEarly = true;
+				break;
+			}
+
 			if (trainPolicy)
-				nn::utils::clip_grad_norm_(models["policy"]->parameters(), 0.5f);
+				models["policy"]->ClipGradNorm(0.5f);
 			if (trainCritic)
-				nn::utils::clip_grad_norm_(models["critic"]->parameters(), 0.5f);
+				models["critic"]->ClipGradNorm(0.5f);
 
 			if (trainSharedHead)
-				nn::utils::clip_grad_norm_(models["shared_head"]->parameters(), 0.5f);
+				models["shared_head"]->ClipGradNorm(0.5f);
 
-			models.StepOptims();
+			{
+				RG_PROFILE_SCOPE("PPOLearner::StepOptims");
+				models.StepOptims();
+			}
 		}
+
+		if (!stoppedEarly)
+			epochsRan++;
 	}
 
 	// Compute magnitude of updates made to the policy and value estimator
@@ -304,6 +490,7 @@ void GGL::PPOLearner::Learn(ExperienceBuffer& experience, Report& report, bool i
 	// Assemble and return report
 	report["Policy Entropy"] = avgEntropy.Get();
 	report["Mean KL Divergence"] = avgDivergence.Get();
+	report["PPO Epochs"] = epochsRan;
 	if (!isFirstIteration) {
 		// These metrics give bad data on the first iteration, which will mess up graph scaling
 		// So we'll just skip them for the first iteration
@@ -329,14 +516,29 @@ void GGL::PPOLearner::TransferLearn(
 	const TransferLearnConfig& tlConfig
 ) {
 
-	torch::Tensor oldProbs;
+	int64_t batchSize = newObs.size(0);
+	int64_t miniBatchSize = (tlConfig.miniBatchSize > 0) ? RS_MIN(tlConfig.miniBatchSize, batchSize) : batchSize;
+	int numMinibatches = (batchSize + miniBatchSize - 1) / miniBatchSize;
+
+	// Old probs don't change, so they are computed once per minibatch and kept on the device
+	std::vector<torch::Tensor> oldProbs = {};
 	{ // No grad for old model inference
 		RG_NO_GRAD;
-		oldProbs = InferPolicyProbsFromModels(oldModels, oldObs, oldActionMasks, config.policyTemperature, config.useHalfPrecision);
-		report["Old Policy Entropy"] = ComputeEntropy(oldProbs, oldActionMasks, config.maskEntropy).detach().cpu().item<float>();
-
-		if (actionMaps.defined())
-			oldProbs = oldProbs.gather(1, actionMaps);
+		torch::Tensor oldEntropySum = torch::zeros({}, device);
+		for (int mb = 0; mb < numMinibatches; mb++) {
+			int64_t start = mb * miniBatchSize, stop = RS_MIN(start + miniBatchSize, batchSize);
+			auto mbOldActionMasks = oldActionMasks.slice(0, start, stop).to(device, true);
+			auto mbOldProbs = InferPolicyProbsFromModels(
+				oldModels, oldObs.slice(0, start, stop).to(device, true), mbOldActionMasks, 
+				config.policyTemperature, config.useHalfPrecision
+			);
+			oldEntropySum += ComputeEntropy(mbOldProbs, mbOldActionMasks, config.maskEntropy) * (stop - start);
+
+			if (actionMaps.defined())
+				mbOldProbs = mbOldProbs.gather(1, actionMaps.slice(0, start, stop).to(device, true));
+			oldProbs.push_back(mbOldProbs);
+		}
+		report["Old Policy Entropy"] = (oldEntropySum / batchSize).cpu().item<float>();
 	}
 
 	for (auto& model : GetPolicyModels())
@@ -345,30 +547,50 @@ void GGL::PPOLearner::TransferLearn(
 	auto policyBefore = models["policy"]->CopyParams();
 	
 	for (int i = 0; i < tlConfig.epochs; i++) {
-		torch::Tensor newProbs = InferPolicyProbsFromModels(models, newObs, newActionMasks, config.policyTemperature, false);
-
-		// Non-summative KL div	loss
-		torch::Tensor transferLearnLoss;
-		if (tlConfig.useKLDiv) {
-			transferLearnLoss = (oldProbs * torch::log(oldProbs / newProbs)).abs();
-		} else {
-			transferLearnLoss = (oldProbs - newProbs).abs();
+		torch::Tensor totalLoss, totalMatching, totalEntropy;
+
+		// Gradients are accumulated over the minibatches, so there is still one update per epoch
+		for (int mb = 0; mb < numMinibatches; mb++) {
+			int64_t start = mb * miniBatchSize, stop = RS_MIN(start + miniBatchSize, batchSize);
+			float batchSizeRatio = (stop - start) / (float)batchSize;
+
+			auto mbNewActionMasks = newActionMasks.slice(0, start, stop).to(device, true);
+			torch::Tensor newProbs = InferPolicyProbsFromModels(
+				models, newObs.slice(0, start, stop).to(device, true), mbNewActionMasks, 
+				config.policyTemperature, false
+			);
+			auto& mbOldProbs = oldProbs[mb];
+
+			// Non-summative KL div	loss
+			torch::Tensor transferLearnLoss;
+			if (tlConfig.useKLDiv) {
+				transferLearnLoss = (mbOldProbs * torch::log(mbOldProbs / newProbs)).abs();
+			} else {
+				transferLearnLoss = (mbOldProbs - newProbs).abs();
+			}
+			transferLearnLoss = transferLearnLoss.pow(tlConfig.lossExponent);
+			transferLearnLoss = transferLearnLoss.mean();
+			transferLearnLoss *= tlConfig.lossScale * batchSizeRatio;
+
+			if (i == 0) {
+				RG_NO_GRAD;
+				auto matching = (newProbs.detach().argmax(-1) == mbOldProbs.argmax(-1)).to(torch::kFloat).sum();
+				auto entropy = ComputeEntropy(newProbs.detach(), mbNewActionMasks, config.maskEntropy) * (stop - start);
+				auto loss = transferLearnLoss.detach();
+				totalMatching = totalMatching.defined() ? (totalMatching + matching) : matching;
+				totalEntropy = totalEntropy.defined() ? (totalEntropy + entropy) : entropy;
+				totalLoss = totalLoss.defined() ? (totalLoss + loss) : loss;
+			}
+
+			transferLearnLoss.backward();
 		}
-		transferLearnLoss = transferLearnLoss.pow(tlConfig.lossExponent);
-		transferLearnLoss = transferLearnLoss.mean();
-		transferLearnLoss *= tlConfig.lossScale;
 
 		if (i == 0) {
-			RG_NO_GRAD;
-			torch::Tensor matchingActionsMask = (newProbs.detach().argmax(-1) == oldProbs.detach().argmax(-1));
-			report["Transfer Learn Accuracy"] = matchingActionsMask.to(torch::kFloat).mean().cpu().item<float>();
-			report["Transfer Learn Loss"] = transferLearnLoss.detach().cpu().item<float>();
-
-			report["Policy Entropy"] = ComputeEntropy(newProbs, newActionMasks, config.maskEntropy).detach().cpu().item<float>();
+			report["Transfer Learn Accuracy"] = (totalMatching / batchSize).cpu().item<float>();
+			report["Transfer Learn Loss"] = totalLoss.cpu().item<float>();
+			report["Policy Entropy"] = (totalEntropy / batchSize).cpu().item<float>();
 		}
 
-		transferLearnLoss.backward();
-
 		models.StepOptims();
 	}
 
@@ -389,6 +611,12 @@ void GGL::PPOLearner::LoadFrom(std::filesystem::path folderPath)  {
 	SetLearningRates(config.policyLR, config.criticLR);
 }
 
+void GGL::PPOLearner::LoadFrom(const CheckpointFileReader& reader) {
+	models.Load(reader, true, true);
+
+	SetLearningRates(config.policyLR, config.criticLR);
+}
+
 void GGL::PPOLearner::SetLearningRates(float policyLR, float criticLR) {
 	config.policyLR = policyLR;
 	config.criticLR = criticLR;
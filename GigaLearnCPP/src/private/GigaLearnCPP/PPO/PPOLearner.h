@@ -38,16 +38,47 @@ namespace GGL {
 		);
 		
 		// If models is null, this->models will be used
-		void InferActions(torch::Tensor obs, torch::Tensor actionMasks, torch::Tensor* outActions, torch::Tensor* outLogProbs, ModelSet* models = NULL);
+		// If outValues is non-null, the critic is also run on the obs (cannot be used with other models)
+		void InferActions(
+			torch::Tensor obs, torch::Tensor actionMasks, 
+			torch::Tensor* outActions, torch::Tensor* outLogProbs, 
+			ModelSet* models = NULL, torch::Tensor* outValues = NULL
+		);
 		torch::Tensor InferCritic(torch::Tensor obs);
 
 		// Perhaps they should be somewhere else? Should probably make an inference interface...
+
+		// Returns obs unchanged if there is no shared head
+		static torch::Tensor InferSharedHead(ModelSet& models, torch::Tensor obs, bool halfPrec);
+
+		// Same as InferPolicyProbsFromModels(), but takes the output of InferSharedHead() instead of the obs
+		// This lets the policy and critic share a single shared head forward
+		static torch::Tensor InferPolicyProbsFromHeadOutput(
+			ModelSet& models,
+			torch::Tensor headOutput, torch::Tensor actionMasks,
+			float temperature,
+			bool halfPrec
+		);
+		torch::Tensor InferCriticFromHeadOutput(torch::Tensor headOutput, bool halfPrec);
+
 		static torch::Tensor InferPolicyProbsFromModels(
 			ModelSet& models, 
 			torch::Tensor obs, torch::Tensor actionMasks, 
 			float temperature,
 			bool halfPrec
 		);
+		static void InferActionsFromProbs(
+			torch::Tensor probs, bool deterministic,
+			torch::Tensor* outActions, torch::Tensor* outLogProbs
+		);
+		// Samples actions from the output of InferSharedHead()
+		// CPU inference without autograd uses the fused sampler in ActionSampler.h, everything else goes through the probs
+		static void InferActionsFromHeadOutput(
+			ModelSet& models,
+			torch::Tensor headOutput, torch::Tensor actionMasks,
+			bool deterministic, float temperature, bool halfPrec,
+			torch::Tensor* outActions, torch::Tensor* outLogProbs
+		);
 		static void InferActionsFromModels(
 			ModelSet& models, 
 			torch::Tensor obs, torch::Tensor actionMasks, 
@@ -55,6 +86,21 @@ namespace GGL {
 			torch::Tensor* outActions, torch::Tensor* outLogProbs
 		);
 
+		// Calibrates every model with int8 inference on (see PartialModelConfig::int8Inference) from sample obs
+		// Returns the fraction of the sample obs where the int8 models pick the same most probable action as the full-precision models
+		// NOTE: Models must be on the CPU
+		static float CalibrateInt8(ModelSet& models, torch::Tensor sampleObs, torch::Tensor sampleActionMasks);
+
+		// Infers actions for rows that are owned by different policies, running each policy only on its own rows
+		// groupOrder contains the row indices of every group, back-to-back in group order (sizes given by groupSizes)
+		// A NULL entry in groupModels means our current policy
+		// Log probs and values are only output for the first group (in groupOrder order), which must then be our current policy
+		void InferActionsGrouped(
+			torch::Tensor obs, torch::Tensor actionMasks,
+			const std::vector<ModelSet*>& groupModels, const std::vector<int>& groupSizes, torch::Tensor groupOrder,
+			torch::Tensor* outActions, torch::Tensor* outFirstLogProbs, torch::Tensor* outFirstValues = NULL
+		);
+
 		void Learn(ExperienceBuffer& experience, Report& report, bool isFirstIteration);
 
 		void TransferLearn(
@@ -68,6 +114,7 @@ namespace GGL {
 
 		void SaveTo(std::filesystem::path folderPath);
 		void LoadFrom(std::filesystem::path folderPath);
+		void LoadFrom(const CheckpointFileReader& reader);
 		void SetLearningRates(float policyLR, float criticLR);
 
 		ModelSet GetPolicyModels();
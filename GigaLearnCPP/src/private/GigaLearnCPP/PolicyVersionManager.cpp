@@ -2,6 +2,7 @@
 #include <nlohmann/json.hpp>
 
 #include <GigaLearnCPP/Util/Utils.h>
+#include <GigaLearnCPP/Util/Timer.h>
 
 #include <RLGymCPP/StateSetters/FuzzedKickoffState.h>
 #include <RLGymCPP/TerminalConditions/GoalScoreCondition.h>
@@ -10,10 +11,72 @@
 
 using namespace nlohmann;
 
+constexpr const char* COMPACT_FILE_NAME = "COMPACT.lt";
+
+// FNV-1a
+uint64_t HashTensorBytes(torch::Tensor tensor, uint64_t hash = 14695981039346656037ULL) {
+	auto bytes = (const uint8_t*)tensor.const_data_ptr();
+	size_t numBytes = tensor.nbytes();
+	for (size_t i = 0; i < numBytes; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::shared_ptr<GGL::CompactTensor> GGL::CompactTensor::Make(torch::Tensor param, PolicyVersionStorageType storageType) {
+	param = param.detach().to(torch::kCPU, torch::kFloat).contiguous();
+
+	torch::Tensor data, scale;
+	if (storageType == PolicyVersionStorageType::INT8 && param.dim() >= 2) {
+		// Symmetric quantization with one scale per output row
+		auto rows = param.flatten(1);
+		scale = rows.abs().amax(1).clamp_min(1e-12f) / 127;
+		data = (rows / scale.unsqueeze(1)).round_().clamp_(-127, 127).to(torch::kInt8).view(param.sizes());
+	} else if (storageType == PolicyVersionStorageType::HALF) {
+		data = param.to(torch::kHalf);
+	} else {
+		data = param.clone();
+	}
+
+	return Make(data, scale);
+}
+
+std::shared_ptr<GGL::CompactTensor> GGL::CompactTensor::Make(torch::Tensor data, torch::Tensor scale) {
+	auto result = std::make_shared<CompactTensor>();
+	result->data = data.contiguous();
+	result->hash = HashTensorBytes(result->data);
+	if (scale.defined()) {
+		result->scale = scale.contiguous();
+		result->hash = HashTensorBytes(result->scale, result->hash);
+	}
+	return result;
+}
+
+torch::Tensor GGL::CompactTensor::Decompress() const {
+	if (scale.defined()) {
+		return (data.flatten(1).to(torch::kFloat) * scale.unsqueeze(1)).view(data.sizes());
+	} else {
+		return data.to(torch::kFloat);
+	}
+}
+
+bool GGL::CompactTensor::Equals(const CompactTensor& other) const {
+	if (hash != other.hash || scale.defined() != other.scale.defined())
+		return false;
+
+	if (data.dtype() != other.data.dtype() || !data.equal(other.data))
+		return false;
+
+	return !scale.defined() || scale.equal(other.scale);
+}
+
 GGL::PolicyVersionManager::PolicyVersionManager(
 	std::filesystem::path saveFolder, int maxVersions, uint64_t tsPerVersion, 
+	PolicyVersionStorageType storageType, int maxLoadedVersions,
 	const SkillTrackerConfig& skillTrackerConfig, const RLGC::EnvSetConfig& envSetConfig, RenderSender* renderSender) : 
 	saveFolder(saveFolder), maxVersions(maxVersions), tsPerVersion(tsPerVersion), 
+	storageType(storageType), maxLoadedVersions(RS_MAX(maxLoadedVersions, 1)),
 	renderSender(renderSender) {
 
 	skill.config = skillTrackerConfig;
@@ -24,6 +87,12 @@ GGL::PolicyVersionManager::PolicyVersionManager(
 	if (skill.config.enabled) {
 		RLGC::EnvSetConfig skillEnvSetConfig = envSetConfig;
 		skillEnvSetConfig.numArenas = skill.config.numArenas;
+		if (skill.config.numThreads > 0) {
+			skill.threadPool = new RLGC::ThreadPool(skill.config.numThreads);
+			skillEnvSetConfig.threadPool = skill.threadPool;
+		} else {
+			skill.threadPool = NULL;
+		}
 		skill.envSet = new RLGC::EnvSet(skillEnvSetConfig);
 		for (int i = 0; i < skill.envSet->arenas.size(); i++) {
 			skill.envSet->rewards[i].clear();
@@ -32,87 +101,275 @@ GGL::PolicyVersionManager::PolicyVersionManager(
 		}
 	} else {
 		skill.envSet = NULL;
+		skill.threadPool = NULL;
 	}
 }
 
-GGL::PolicyVersion& GGL::PolicyVersionManager::AddVersion(ModelSet modelsToClone, uint64_t timesteps) {
+GGL::PolicyVersion& GGL::PolicyVersionManager::AddVersion(ModelSet models, uint64_t timesteps) {
 	RG_NO_GRAD;
 
-	auto models = modelsToClone.CloneAll();
-
-	auto newVersion = PolicyVersion{
-		timesteps,
-		models
-	};
+	if (modelsTemplate.map.empty()) {
+		modelsTemplate = models;
+		for (Model*& model : modelsTemplate)
+			model = model->MakeEmptyClone();
+	}
 
+	auto newVersion = PolicyVersion{};
+	newVersion.timesteps = timesteps;
 	newVersion.ratings = skill.curRatings;
 
+	for (Model* model : models) {
+		auto& compactParams = newVersion.params[model->modelName];
+		for (auto& param : model->parameters())
+			compactParams.push_back(Deduplicate(CompactTensor::Make(param, storageType)));
+	}
+
 	versions.push_back(newVersion);
 
 	SortVersions();
 
 	// Remove old versions
 	while (versions.size() > maxVersions) {
-		auto& toRemove = versions[0];
-		toRemove.models.Free();
+		UnloadVersion(versions[0]);
 		versions.erase(versions.begin());
 	}
 
-	return versions.back();
+	// Forget tensors that are no longer used by any version
+	for (auto itr = dedupTensors.begin(); itr != dedupTensors.end();) {
+		if (itr->second.expired()) {
+			itr = dedupTensors.erase(itr);
+		} else {
+			itr++;
+		}
+	}
+
+	for (auto& version : versions)
+		if (version.timesteps == timesteps)
+			return version;
+
+	RG_ERR_CLOSE("PolicyVersionManager::AddVersion(): New version was removed immediately (maxVersions=" << maxVersions << ")");
 }
 
-void GGL::PolicyVersionManager::SaveVersions() {
+std::shared_ptr<GGL::CompactTensor> GGL::PolicyVersionManager::Deduplicate(std::shared_ptr<CompactTensor> tensor) {
+	auto range = dedupTensors.equal_range(tensor->hash);
+	for (auto itr = range.first; itr != range.second; itr++) {
+		auto existing = itr->second.lock();
+		if (existing && existing->Equals(*tensor))
+			return existing;
+	}
+
+	dedupTensors.insert({ tensor->hash, tensor });
+	return tensor;
+}
+
+void GGL::PolicyVersionManager::DecompressInto(const PolicyVersion& version, ModelSet& models) {
 	RG_NO_GRAD;
 
-	// Remove old saved versions
-	std::set<int64_t> allSavedTimesteps = Utils::FindNumberedDirs(saveFolder);
+	for (Model* model : models) {
+		auto itr = version.params.find(model->modelName);
+		if (itr == version.params.end())
+			RG_ERR_CLOSE("PolicyVersionManager::DecompressInto(): Version " << version.timesteps << " has no model \"" << model->modelName << "\"");
 
-	for (int64_t savedTimesteps : allSavedTimesteps) {
-		bool matchesVersion = false;
-		for (auto& version : versions)
-			matchesVersion |= (savedTimesteps == version.timesteps);
+		auto& compactParams = itr->second;
+		auto toParams = model->parameters();
+		RG_ASSERT(compactParams.size() == toParams.size());
+		for (int i = 0; i < toParams.size(); i++)
+			toParams[i].copy_(compactParams[i]->Decompress().view_as(toParams[i]), true);
 
-		if (matchesVersion) {
-			// We want to keep this
-			allSavedTimesteps.insert(savedTimesteps);
-		} else {
-			// Get rid of it
-			std::filesystem::remove_all(saveFolder / std::to_string(savedTimesteps));
+		model->_seqHalfOutdated = true;
+	}
+}
+
+GGL::ModelSet& GGL::PolicyVersionManager::GetModels(PolicyVersion& version) {
+	version.lastUseIdx = ++useCounter;
+	if (version.loaded)
+		return version.models;
+
+	Timer swapTimer = {};
+
+	int numLoaded = 0;
+	for (auto& other : versions)
+		numLoaded += other.loaded;
+
+	while (numLoaded >= maxLoadedVersions) {
+		PolicyVersion* leastRecent = NULL;
+		for (auto& other : versions)
+			if (other.loaded && (!leastRecent || other.lastUseIdx < leastRecent->lastUseIdx))
+				leastRecent = &other;
+
+		UnloadVersion(*leastRecent);
+		numLoaded--;
+	}
+
+	if (!freeModelSets.empty()) {
+		version.models = freeModelSets.back();
+		freeModelSets.pop_back();
+	} else {
+		version.models = modelsTemplate;
+		for (Model*& model : version.models)
+			model = model->MakeEmptyClone();
+	}
+
+	DecompressInto(version, version.models);
+	version.loaded = true;
+
+	numSwaps++;
+	totalSwapTime += swapTimer.Elapsed();
+	return version.models;
+}
+
+void GGL::PolicyVersionManager::UnloadVersion(PolicyVersion& version) {
+	if (!version.loaded)
+		return;
+
+	freeModelSets.push_back(version.models);
+	version.models = {};
+	version.loaded = false;
+}
+
+size_t GGL::PolicyVersionManager::GetCompactBytes() const {
+	// Shared tensors are only counted once
+	std::set<const CompactTensor*> countedTensors = {};
+	size_t totalBytes = 0;
+	for (auto& version : versions) {
+		for (auto& pair : version.params) {
+			for (auto& param : pair.second) {
+				if (countedTensors.insert(param.get()).second)
+					totalBytes += param->GetBytes();
+			}
 		}
 	}
+	return totalBytes;
+}
+
+GGL::MemoryUsage GGL::PolicyVersionManager::GetMemoryUsage() {
+	MemoryUsage totalUsage = {};
+	totalUsage.host = GetCompactBytes(); // Compact tensors are always on the CPU
+
+	auto fnAddModels = [&](ModelSet& models) {
+		totalUsage += models.GetMemoryUsage();
+		totalUsage += models.GetOptimMemoryUsage();
+	};
+
+	for (auto& version : versions)
+		if (version.loaded)
+			fnAddModels(version.models);
+	for (auto& models : freeModelSets)
+		fnAddModels(models);
+	fnAddModels(modelsTemplate);
+	fnAddModels(skill.round.newModels);
+	fnAddModels(skill.round.oldModels);
+
+	return totalUsage;
+}
+
+void GGL::PolicyVersionManager::AddStorageMetrics(Report& report) {
+	if (versions.empty())
+		return;
+
+	size_t totalBytes = GetCompactBytes();
+	int numLoaded = 0;
+	for (auto& version : versions)
+		numLoaded += version.loaded;
+
+	report["Policy Versions/Count"] = versions.size();
+	report["Policy Versions/Loaded"] = numLoaded;
+	report["Policy Versions/Memory Per Version (MB)"] = totalBytes / (double)versions.size() / (1024 * 1024);
+	if (numSwaps > 0) {
+		report["Policy Versions/Swap Time"] = totalSwapTime / numSwaps;
+		numSwaps = 0;
+		totalSwapTime = 0;
+	}
+}
+
+void GGL::PolicyVersionManager::SaveVersions() {
+	MakeSaveVersionsFn()();
+}
 
+std::function<void()> GGL::PolicyVersionManager::MakeSaveVersionsFn() {
+	// Compact tensors are never modified after they are made, so sharing them is enough of a snapshot
+	std::vector<PolicyVersion> savedVersions = {};
 	for (auto& version : versions) {
-		if (allSavedTimesteps.contains(version.timesteps))
-			continue;
-		auto versionSaveFolder = saveFolder / std::to_string(version.timesteps);
-		std::filesystem::create_directories(versionSaveFolder);
+		PolicyVersion savedVersion = {};
+		savedVersion.timesteps = version.timesteps;
+		savedVersion.ratings = version.ratings;
+		savedVersion.params = version.params;
+		savedVersions.push_back(savedVersion);
+	}
 
-		version.models.Save(versionSaveFolder, false);
+	return [saveFolder = saveFolder, savedVersions]() mutable {
+		RG_NO_GRAD;
 
-		{ // Save JSON
-			auto jsonPath = versionSaveFolder / "STATS.json";
+		// Remove old saved versions
+		std::set<int64_t> allSavedTimesteps = Utils::FindNumberedDirs(saveFolder);
 
-			std::ofstream fOut(jsonPath);
-			RG_ASSERT(fOut.good());
+		for (int64_t savedTimesteps : allSavedTimesteps) {
+			bool matchesVersion = false;
+			for (auto& version : savedVersions)
+				matchesVersion |= (savedTimesteps == version.timesteps);
 
-			json j = {};
-			j["skill_ratings"] = version.ratings.ToJSON();
-			std::string jStr = j.dump(4);
-			fOut << jStr;
+			if (matchesVersion) {
+				// We want to keep this
+				allSavedTimesteps.insert(savedTimesteps);
+			} else {
+				// Get rid of it
+				std::filesystem::remove_all(saveFolder / std::to_string(savedTimesteps));
+			}
 		}
-	}
+
+		for (auto& version : savedVersions) {
+			if (allSavedTimesteps.contains(version.timesteps))
+				continue;
+			auto versionSaveFolder = saveFolder / std::to_string(version.timesteps);
+			std::filesystem::create_directories(versionSaveFolder);
+
+			{ // Save compact params
+				torch::serialize::OutputArchive archive;
+				for (auto& pair : version.params) {
+					for (int i = 0; i < pair.second.size(); i++) {
+						std::string key = pair.first + "." + std::to_string(i);
+						archive.write(key, pair.second[i]->data);
+						if (pair.second[i]->scale.defined())
+							archive.write(key + ".scale", pair.second[i]->scale);
+					}
+				}
+				archive.save_to((versionSaveFolder / COMPACT_FILE_NAME).string());
+			}
+
+			{ // Save JSON
+				auto jsonPath = versionSaveFolder / "STATS.json";
+
+				std::ofstream fOut(jsonPath);
+				RG_ASSERT(fOut.good());
+
+				json j = {};
+				j["skill_ratings"] = version.ratings.ToJSON();
+				std::string jStr = j.dump(4);
+				fOut << jStr;
+			}
+		}
+	};
 }
 
-void GGL::PolicyVersionManager::LoadVersions(ModelSet modelsTemplate, uint64_t curTimesteps) {
+void GGL::PolicyVersionManager::LoadVersions(ModelSet policyModels, uint64_t curTimesteps) {
 
 	RG_NO_GRAD;
 
+	if (modelsTemplate.map.empty()) {
+		modelsTemplate = policyModels;
+		for (Model*& model : modelsTemplate)
+			model = model->MakeEmptyClone();
+	}
+
 	RG_LOG("PolicyVersionManager::LoadVersions():");
 
 	for (auto& version : versions)
-		version.models.Free();
+		UnloadVersion(version);
 	versions.clear();
 
+	// Legacy versions are saved as full models, which are loaded into these before being compacted
+	ModelSet legacyModels = {};
+
 	std::set<int64_t> allSavedTimesteps = Utils::FindNumberedDirs(saveFolder);
 
 	for (int64_t savedTimesteps : allSavedTimesteps) {
@@ -123,8 +380,35 @@ void GGL::PolicyVersionManager::LoadVersions(ModelSet modelsTemplate, uint64_t c
 				"If you deleted some checkpoints, make sure to delete that far back in the saved policy versions as well");
 		}
 		auto path = saveFolder / std::to_string(savedTimesteps);
-		PolicyVersion& version = AddVersion(modelsTemplate, savedTimesteps);
-		version.models.Load(path, false, false);
+		PolicyVersion* versionPtr;
+		if (std::filesystem::exists(path / COMPACT_FILE_NAME)) {
+			torch::serialize::InputArchive archive;
+			archive.load_from((path / COMPACT_FILE_NAME).string(), torch::kCPU);
+
+			auto newVersion = PolicyVersion{};
+			newVersion.timesteps = savedTimesteps;
+			for (Model* model : modelsTemplate) {
+				auto& compactParams = newVersion.params[model->modelName];
+				int numParams = model->parameters().size();
+				for (int i = 0; i < numParams; i++) {
+					std::string key = std::string(model->modelName) + "." + std::to_string(i);
+					torch::Tensor data, scale;
+					if (!archive.try_read(key, data))
+						RG_ERR_CLOSE("Saved policy version at " << path << " is missing parameter \"" << key << "\"");
+					archive.try_read(key + ".scale", scale);
+					compactParams.push_back(Deduplicate(CompactTensor::Make(data, scale)));
+				}
+			}
+
+			versions.push_back(newVersion);
+			versionPtr = &versions.back();
+		} else {
+			if (legacyModels.map.empty())
+				legacyModels = modelsTemplate.CloneAll();
+			legacyModels.Load(path, false, false);
+			versionPtr = &AddVersion(legacyModels, savedTimesteps);
+		}
+		PolicyVersion& version = *versionPtr;
 
 		{ // Load JSON
 			// TODO: Repetitive
@@ -138,7 +422,11 @@ void GGL::PolicyVersionManager::LoadVersions(ModelSet modelsTemplate, uint64_t c
 		}
 	}
 
+	legacyModels.Free();
+
 	SortVersions();
+	while (versions.size() > maxVersions)
+		versions.erase(versions.begin());
 
 	RG_LOG(" > Loaded " << versions.size() << " versions(s)");
 }
@@ -153,8 +441,62 @@ void GGL::PolicyVersionManager::SortVersions() {
 
 /////////////////////////////////////////////////////////////////////
 
-void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report) {
+void GGL::PolicyVersionManager::StartSkillMatches(PPOLearner* ppo) {
+	RG_NO_GRAD;
+
+	auto& round = skill.round;
+
+	PolicyVersion* oldVersion = NULL;
+	if (skill.doContinuation)
+		for (auto& version : versions)
+			if (version.timesteps == skill.prevOldVersionTimesteps)
+				oldVersion = &version;
+
+	if (oldVersion) {
+		round.newTeam = skill.prevNewTeam;
+		round.totalSimTime = skill.prevSimTime;
+	} else {
+		// Not continuing (or the version we were playing against was removed)
+		oldVersion = &versions[Math::RandInt(0, versions.size())];
+		round.newTeam = (Team)Math::RandInt(0, 2);
+		round.totalSimTime = 0;
+		skill.curGoals = 0;
+
+		for (int i = 0; i < skill.envSet->arenas.size(); i++)
+			skill.envSet->state.terminals[i] = 1;
+	}
+	skill.doContinuation = false;
+
+	// Snapshot both policies so training can continue while the round plays
+	auto policyModels = ppo->GetPolicyModels();
+	if (round.newModels.map.empty()) {
+		round.newModels = policyModels.CloneAll();
+		round.oldModels = modelsTemplate;
+		for (Model*& model : round.oldModels)
+			model = model->MakeEmptyClone();
+	} else {
+		for (Model* model : round.newModels) {
+			auto fromParams = policyModels[model->modelName]->parameters();
+			auto toParams = model->parameters();
+			for (int i = 0; i < toParams.size(); i++)
+				toParams[i].copy_(fromParams[i], true);
+			model->_seqHalfOutdated = true;
+		}
+	}
+	DecompressInto(*oldVersion, round.oldModels);
+
+	round.oldVersionTimesteps = oldVersion->timesteps;
+	round.newRatings = skill.curRatings;
+	round.oldRatings = oldVersion->ratings;
+	round.device = ppo->device;
+	round.temperature = ppo->config.policyTemperature;
+	round.halfPrec = ppo->config.useHalfPrecision;
+}
+
+void GGL::PolicyVersionManager::RunSkillMatches() {
 	RG_NO_GRAD;
+
+	auto& round = skill.round;
 	
 	auto fnUpdateRatings = [this](SkillRating& winner, SkillRating& loser, RLGC::GameState& state) {
 		float& winnerRating = winner.GetRating(state, skill.config.initialRating);
@@ -168,25 +510,8 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		loserRating += skill.config.ratingInc * (expected - 1);
 	};
 
-	
-	Team newTeam;
-	int oldVersionIndex;
-	float totalSimTime;
-	if (skill.doContinuation) {
-		RG_ASSERT(skill.prevOldVersionIndex < versions.size());
-		oldVersionIndex = skill.prevOldVersionIndex;
-		newTeam = skill.prevNewTeam;
-		totalSimTime = skill.prevSimTime;
-	} else {
-		oldVersionIndex = Math::RandInt(0, versions.size());
-		newTeam = (Team)Math::RandInt(0, 2);
-		totalSimTime = 0;
-
-		skill.envSet->Reset();
-	}
-	skill.doContinuation = false;
-
-	auto& oldVersion = versions[oldVersionIndex];
+	// Resets any arenas that aren't being continued
+	skill.envSet->Reset();
 
 	// Find which players are on which teams
 	std::vector<int>
@@ -196,7 +521,7 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		auto& state = skill.envSet->state.gameStates[i];
 		for (int j = 0; j < state.players.size(); j++) {
 			int playerIdx = skill.envSet->state.arenaPlayerStartIdx[i] + j;
-			bool isNew = (state.players[j].team == newTeam);
+			bool isNew = (state.players[j].team == round.newTeam);
 			(isNew ? newPlayers : oldPlayers).push_back(playerIdx);
 		}
 	}
@@ -205,16 +530,10 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		tNewPlayers = torch::tensor(newPlayers),
 		tOldPlayers = torch::tensor(oldPlayers);
 
-	int newGoals = 0, oldGoals = 0;
-
-	RG_LOG("Running skill matches (simTime=" << skill.config.simTime << ")...");
-
-	SkillRating prevCurRatings = skill.curRatings;
-
 	float stepTime = skill.envSet->config.tickSkip * RLGC::CommonValues::TICK_TIME;
 	for (float t = 0; 
-		t < skill.config.simTime && totalSimTime < skill.config.maxSimTime && skill.curGoals < skill.envSet->arenas.size();
-		t += stepTime, totalSimTime += stepTime) {
+		t < skill.config.simTime && round.totalSimTime < skill.config.maxSimTime && skill.curGoals < skill.envSet->arenas.size();
+		t += stepTime, round.totalSimTime += stepTime) {
 
 		skill.envSet->Reset();
 
@@ -233,12 +552,12 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		torch::Tensor _tLogProbs;
 
 		PPOLearner::InferActionsFromModels(
-			ppo->models, tNewStates.to(ppo->device, true), tNewActionMasks.to(ppo->device, true), 
-			skill.config.deterministic, ppo->config.policyTemperature, ppo->config.useHalfPrecision, 
+			round.newModels, tNewStates.to(round.device, true), tNewActionMasks.to(round.device, true), 
+			skill.config.deterministic, round.temperature, round.halfPrec, 
 			&tNewActions, &_tLogProbs);
 		PPOLearner::InferActionsFromModels(
-			oldVersion.models, tOldStates.to(ppo->device, true), tOldActionMasks.to(ppo->device, true), 
-			skill.config.deterministic, ppo->config.policyTemperature, ppo->config.useHalfPrecision,
+			round.oldModels, tOldStates.to(round.device, true), tOldActionMasks.to(round.device, true), 
+			skill.config.deterministic, round.temperature, round.halfPrec,
 			&tOldActions, &_tLogProbs);
 
 		auto newActions = TENSOR_TO_VEC<int>(tNewActions);
@@ -256,12 +575,10 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		for (int i = 0; i < skill.envSet->arenas.size(); i++) {
 			auto& gs = skill.envSet->state.gameStates[i];
 			if (gs.goalScored) {
-				std::string modeName = SkillRating::GetModeName(gs);
-
-				if (RS_TEAM_FROM_Y(gs.ball.pos.y) != newTeam) {
-					fnUpdateRatings(skill.curRatings, oldVersion.ratings, gs);
+				if (RS_TEAM_FROM_Y(gs.ball.pos.y) != round.newTeam) {
+					fnUpdateRatings(round.newRatings, round.oldRatings, gs);
 				} else {
-					fnUpdateRatings(oldVersion.ratings, skill.curRatings, gs);
+					fnUpdateRatings(round.oldRatings, round.newRatings, gs);
 				}
 
 				skill.curGoals++;
@@ -271,9 +588,15 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		if (renderSender)
 			renderSender->Send(skill.envSet->state.gameStates[0]);
 	}
+}
+
+void GGL::PolicyVersionManager::FinishSkillMatches(Report& report) {
+	auto& round = skill.round;
 
-	for (auto& pair : skill.curRatings.data) {
-		float prevRating = prevCurRatings.GetRating(pair.first, skill.config.initialRating);
+	RG_LOG("Finished skill matches against version " << round.oldVersionTimesteps << ":");
+
+	for (auto& pair : round.newRatings.data) {
+		float prevRating = skill.curRatings.GetRating(pair.first, skill.config.initialRating);
 		float delta = pair.second - prevRating;
 
 		std::stringstream ratingLine;
@@ -286,14 +609,18 @@ void GGL::PolicyVersionManager::RunSkillMatches(PPOLearner* ppo, Report& report)
 		report["Rating/" + pair.first] = pair.second;
 	}
 
-	if (skill.curGoals < skill.envSet->arenas.size() && totalSimTime < skill.config.maxSimTime) {
+	skill.curRatings = round.newRatings;
+	for (auto& version : versions)
+		if (version.timesteps == round.oldVersionTimesteps)
+			version.ratings = round.oldRatings;
+
+	if (skill.curGoals < skill.envSet->arenas.size() && round.totalSimTime < skill.config.maxSimTime) {
 		// Not enough goals were scored, we will force a continuation where the same models keep playing from the end position
-		// This COULD switch versions, but it wouldn't be a big deal as it would just be the immediate next version
 		RG_LOG(" > Forcing continuation (" << skill.curGoals <<  "/" << skill.envSet->arenas.size() << ")");
 		skill.doContinuation = true;
-		skill.prevOldVersionIndex = oldVersionIndex;
-		skill.prevNewTeam = newTeam;
-		skill.prevSimTime = totalSimTime;
+		skill.prevOldVersionTimesteps = round.oldVersionTimesteps;
+		skill.prevNewTeam = round.newTeam;
+		skill.prevSimTime = round.totalSimTime;
 	} else {
 		skill.curGoals = 0;
 	}
@@ -305,15 +632,58 @@ void GGL::PolicyVersionManager::OnIteration(struct PPOLearner* ppo, Report& repo
 		AddVersion(ppo->GetPolicyModels(), totalTimesteps);
 	}
 
+	AddStorageMetrics(report);
+
 	if (skill.config.enabled) {
+		Timer skillTimer = {};
+
+		bool background = skill.threadPool != NULL;
+		if (background && skill.round.thread.joinable() && !skill.round.running) {
+			// The previous round has finished in the background
+			skill.round.thread.join();
+			FinishSkillMatches(report);
+		}
+
 		skill.iterationsSinceRan++;
-		if (skill.iterationsSinceRan >= skill.config.updateInterval && !versions.empty()) {
+		if (skill.iterationsSinceRan >= skill.config.updateInterval && !versions.empty() && !skill.round.thread.joinable()) {
 			skill.iterationsSinceRan = 0;
-			RunSkillMatches(ppo, report);
+			StartSkillMatches(ppo);
+
+			if (background) {
+				skill.round.running = true;
+				skill.round.thread = std::thread(
+					[this]() {
+						RunSkillMatches();
+						skill.round.running = false;
+					}
+				);
+			} else {
+				RunSkillMatches();
+				FinishSkillMatches(report);
+			}
 		}
+
+		report["Skill Tracker Time"] = skillTimer.Elapsed();
 	}
 }
 
+GGL::PolicyVersionManager::~PolicyVersionManager() {
+	if (skill.round.thread.joinable())
+		skill.round.thread.join();
+
+	skill.round.newModels.Free();
+	skill.round.oldModels.Free();
+
+	delete skill.envSet;
+	delete skill.threadPool;
+
+	for (auto& version : versions)
+		UnloadVersion(version);
+	for (auto& models : freeModelSets)
+		models.Free();
+	modelsTemplate.Free();
+}
+
 void GGL::PolicyVersionManager::AddRunningStatsToJSON(nlohmann::json& json) {
 	if (skill.config.enabled)
 		json["skill_ratings"] = skill.curRatings.ToJSON();
@@ -2,10 +2,13 @@
 
 #include "Util/Models.h"
 #include <GigaLearnCPP/SkillTrackerConfig.h>
+#include <GigaLearnCPP/LearnerConfig.h>
 #include <GigaLearnCPP/Util/Report.h>
 #include <GigaLearnCPP/Util/RenderSender.h>
 
 #include <nlohmann/json.hpp>
+#include <thread>
+#include <atomic>
 
 namespace GGL {
 
@@ -51,10 +54,46 @@ namespace GGL {
 		}
 	};
 
+	// A model parameter in compact form
+	struct CompactTensor {
+		torch::Tensor data; // Float, half, or int8 (if scale is defined)
+		torch::Tensor scale; // Per-row scale for int8 data
+		uint64_t hash;
+
+		static std::shared_ptr<CompactTensor> Make(torch::Tensor param, PolicyVersionStorageType storageType);
+		static std::shared_ptr<CompactTensor> Make(torch::Tensor data, torch::Tensor scale);
+
+		torch::Tensor Decompress() const;
+		bool Equals(const CompactTensor& other) const;
+
+		size_t GetBytes() const {
+			size_t bytes = data.nbytes();
+			if (scale.defined())
+				bytes += scale.nbytes();
+			return bytes;
+		}
+	};
+
 	struct PolicyVersion {
 		uint64_t timesteps;
-		ModelSet models;
 		SkillRating ratings;
+
+		// Compact parameters of each model, in parameters() order
+		// Identical tensors are shared between versions
+		std::map<std::string, std::vector<std::shared_ptr<CompactTensor>>> params;
+
+		// Only valid while loaded, use PolicyVersionManager::GetModels()
+		ModelSet models;
+		bool loaded = false;
+		uint64_t lastUseIdx = 0;
+
+		size_t GetCompactBytes() const {
+			size_t total = 0;
+			for (auto& pair : params)
+				for (auto& param : pair.second)
+					total += param->GetBytes();
+			return total;
+		}
 	};
 
 	struct PolicyVersionManager {
@@ -63,46 +102,110 @@ namespace GGL {
 		int maxVersions;
 		uint64_t tsPerVersion;
 
+		PolicyVersionStorageType storageType;
+		int maxLoadedVersions;
+
+		// Empty clones of the policy models, used to materialize versions
+		ModelSet modelsTemplate = {};
+
+		// Model sets of unloaded versions, kept around so loading doesn't need to allocate new models
+		std::vector<ModelSet> freeModelSets = {};
+
+		// Compact tensors by hash, for deduplication
+		std::unordered_multimap<uint64_t, std::weak_ptr<CompactTensor>> dedupTensors = {};
+
+		uint64_t useCounter = 0;
+
+		// Since last report
+		int numSwaps = 0;
+		float totalSwapTime = 0;
+
 		//////////////////
 
 		struct {
 			SkillTrackerConfig config;
 
 			RLGC::EnvSet* envSet;
+			RLGC::ThreadPool* threadPool; // Only used when running in the background
 			int curGoals = 0;
 
 			bool doContinuation = false;
-			int prevOldVersionIndex;
+			uint64_t prevOldVersionTimesteps;
 			Team prevNewTeam;
 			float prevSimTime;
 
 			int iterationsSinceRan = 0;
 
 			SkillRating curRatings = {};
+
+			// State of the current round of matches, which is only touched by the round until it finishes
+			struct {
+				std::thread thread;
+				std::atomic<bool> running = false;
+
+				ModelSet newModels = {}, oldModels = {}; // Snapshots
+				uint64_t oldVersionTimesteps;
+				SkillRating newRatings, oldRatings;
+				Team newTeam;
+				float totalSimTime;
+
+				torch::Device device = torch::kCPU;
+				float temperature;
+				bool halfPrec;
+			} round;
 		} skill;
 
 		RenderSender* renderSender;
 
 		PolicyVersionManager(
 			std::filesystem::path saveFolder, int maxVersions, uint64_t tsPerVersion,
+			PolicyVersionStorageType storageType, int maxLoadedVersions,
 			const SkillTrackerConfig& skillTrackerConfig, const RLGC::EnvSetConfig& envSetConfig,
 			RenderSender* renderSender = NULL);
 
-		// NOTE: Passed models should not be already cloned
-		PolicyVersion& AddVersion(ModelSet modelsToClone, uint64_t timesteps);
+		// Stores a compact copy of the passed models
+		PolicyVersion& AddVersion(ModelSet models, uint64_t timesteps);
+
+		// Materializes the version's models if needed, unloading the least-recently used version if there are too many loaded
+		// Returned models stay valid until another version is loaded or versions are added
+		ModelSet& GetModels(PolicyVersion& version);
+		void UnloadVersion(PolicyVersion& version);
+
+		// Copies the version's parameters into existing models of the same arch
+		void DecompressInto(const PolicyVersion& version, ModelSet& models);
+
+		// Returns an existing identical tensor if there is one
+		std::shared_ptr<CompactTensor> Deduplicate(std::shared_ptr<CompactTensor> tensor);
 
 		void SaveVersions();
-		void LoadVersions(ModelSet modelsTemplate, uint64_t curTimesteps);
+
+		// Returns a function that saves a snapshot of the current versions, which can be run from another thread
+		std::function<void()> MakeSaveVersionsFn();
+		void LoadVersions(ModelSet policyModels, uint64_t curTimesteps);
 
 		void SortVersions();
 
-		void RunSkillMatches(struct PPOLearner* ppo, Report& report);
+		// Snapshots the current and an old policy, and sets up the next round of skill matches
+		void StartSkillMatches(struct PPOLearner* ppo);
+		// Plays the round, this can run in the background
+		void RunSkillMatches();
+		// Applies the results of the finished round
+		void FinishSkillMatches(Report& report);
+
+		// Compact parameters of all versions, with shared tensors counted once
+		size_t GetCompactBytes() const;
+
+		// Compact parameters plus every model set we hold (loaded versions, free sets, the template, and skill snapshots)
+		MemoryUsage GetMemoryUsage();
+
+		void AddStorageMetrics(Report& report);
 
 		void OnIteration(struct PPOLearner* ppo, Report& report, int64_t totalTimesteps, int64_t prevTotalTimesteps);
 
 		void AddRunningStatsToJSON(nlohmann::json& json);
 		void LoadRunningStatsFromJSON(const nlohmann::json& json);
 
-		// TODO: Add deconstructor
+		RG_NO_COPY(PolicyVersionManager);
+		~PolicyVersionManager();
 	};
 }
\ No newline at end of file
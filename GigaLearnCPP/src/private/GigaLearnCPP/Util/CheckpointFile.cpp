@@ -0,0 +1,207 @@
+#include "CheckpointFile.h"
+
+using namespace GGL::CheckpointFile;
+
+namespace {
+	constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+
+	uint64_t AlignUp(uint64_t offset) {
+		return (offset + ALIGN - 1) / ALIGN * ALIGN;
+	}
+
+	uint64_t RotL(uint64_t val, int bits) {
+		return (val << bits) | (val >> (64 - bits));
+	}
+
+	// Start of the entry table and of the checksummed data
+	const uint64_t DATA_START = AlignUp(sizeof(Header));
+}
+
+void GGL::CheckpointFile::Checksum::Add(const void* data, size_t size) {
+	RG_ASSERT(size % ALIGN == 0);
+
+	const uint8_t* bytes = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i += sizeof(uint64_t) * 4) {
+		for (int j = 0; j < 4; j++) {
+			uint64_t word;
+			memcpy(&word, bytes + i + j * sizeof(uint64_t), sizeof(uint64_t));
+			lanes[j] = RotL(lanes[j] + word * PRIME_2, 31) * PRIME_1;
+		}
+	}
+}
+
+uint64_t GGL::CheckpointFile::Checksum::Get() const {
+	uint64_t result = RotL(lanes[0], 1) + RotL(lanes[1], 7) + RotL(lanes[2], 12) + RotL(lanes[3], 18);
+	result ^= result >> 33;
+	result *= PRIME_2;
+	result ^= result >> 29;
+	return result;
+}
+
+//////////////////////////
+
+GGL::CheckpointFileWriter::Entry& GGL::CheckpointFileWriter::AddEntry(const std::string& name, int32_t dtype, uint64_t numBytes) {
+	if (name.empty() || name.size() > MAX_NAME_LEN)
+		RG_ERR_CLOSE("CheckpointFileWriter: Invalid entry name \"" << name << "\" (must be 1-" << MAX_NAME_LEN << " characters)");
+	for (auto& entry : _entries)
+		if (name == entry.desc.name)
+			RG_ERR_CLOSE("CheckpointFileWriter: Duplicate entry name \"" << name << "\"");
+
+	Entry entry = {};
+	memcpy(entry.desc.name, name.data(), name.size());
+	entry.desc.dtype = dtype;
+	entry.desc.numBytes = numBytes;
+	_entries.push_back(entry);
+	return _entries.back();
+}
+
+void GGL::CheckpointFileWriter::AddTensor(std::string name, torch::Tensor tensor) {
+	if (tensor.dim() > MAX_DIMS)
+		RG_ERR_CLOSE("CheckpointFileWriter: Tensor \"" << name << "\" has too many dimensions (" << tensor.dim() << ")");
+
+	tensor = tensor.detach().cpu().contiguous();
+	Entry& entry = AddEntry(name, (int32_t)tensor.scalar_type(), tensor.nbytes());
+	entry.desc.numDims = tensor.dim();
+	for (int i = 0; i < tensor.dim(); i++)
+		entry.desc.shape[i] = tensor.size(i);
+	entry.tensor = tensor;
+}
+
+void GGL::CheckpointFileWriter::AddBytes(std::string name, std::string bytes) {
+	Entry& entry = AddEntry(name, -1, bytes.size());
+	entry.bytes = std::move(bytes);
+}
+
+void GGL::CheckpointFileWriter::Write(std::filesystem::path path) const {
+	constexpr const char* ERROR_PREFIX = "CheckpointFileWriter::Write(): ";
+
+	// Lay out the entry table, then every blob after it
+	std::vector<EntryDesc> descs = {};
+	uint64_t offset = AlignUp(DATA_START + _entries.size() * sizeof(EntryDesc));
+	for (auto& entry : _entries) {
+		EntryDesc desc = entry.desc;
+		desc.offset = offset;
+		offset = AlignUp(offset + desc.numBytes);
+		descs.push_back(desc);
+	}
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.fileSize = offset;
+	header.numEntries = descs.size();
+	header.entriesOffset = DATA_START;
+
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+	std::ofstream fOut(tempPath, std::ios::binary);
+	if (!fOut.good())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Can't open file at " << tempPath);
+
+	// Blobs are checksummed as they are written, so they don't need to be copied into one big buffer first
+	Checksum checksum = {};
+	std::vector<uint8_t> paddedBlock = std::vector<uint8_t>(ALIGN);
+	auto fnWritePadded = [&](const void* data, uint64_t size) {
+		uint64_t wholeSize = size / ALIGN * ALIGN;
+		fOut.write((const char*)data, wholeSize);
+		checksum.Add(data, wholeSize);
+
+		uint64_t remainder = size - wholeSize;
+		if (remainder > 0) {
+			std::fill(paddedBlock.begin(), paddedBlock.end(), 0);
+			memcpy(paddedBlock.data(), (const uint8_t*)data + wholeSize, remainder);
+			fOut.write((const char*)paddedBlock.data(), ALIGN);
+			checksum.Add(paddedBlock.data(), ALIGN);
+		}
+	};
+
+	std::vector<uint8_t> headerBlock = std::vector<uint8_t>(DATA_START);
+	fOut.write((const char*)headerBlock.data(), headerBlock.size()); // Rewritten at the end, once the checksum is known
+	fnWritePadded(descs.data(), descs.size() * sizeof(EntryDesc));
+	for (auto& entry : _entries) {
+		if (entry.tensor.defined()) {
+			fnWritePadded(entry.tensor.data_ptr(), entry.desc.numBytes);
+		} else {
+			fnWritePadded(entry.bytes.data(), entry.desc.numBytes);
+		}
+	}
+
+	header.checksum = checksum.Get();
+	memcpy(headerBlock.data(), &header, sizeof(header));
+	fOut.seekp(0);
+	fOut.write((const char*)headerBlock.data(), headerBlock.size());
+
+	if (!fOut.good())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to write to " << tempPath);
+	fOut.close();
+
+	std::filesystem::rename(tempPath, path);
+}
+
+//////////////////////////
+
+GGL::CheckpointFileReader::CheckpointFileReader(std::filesystem::path path) : path(path), file(path) {
+	constexpr const char* ERROR_PREFIX = "CheckpointFileReader: ";
+
+	const Header* header = file.Get<Header>(0);
+	if (!header || memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is not a checkpoint file");
+	if (header->version != VERSION)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is version " << header->version << ", but only version " << VERSION << " is supported");
+	if (header->fileSize != file.size || file.size % ALIGN != 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is truncated or corrupt (expected " << header->fileSize << " bytes, got " << file.size << ")");
+
+	Checksum checksum = {};
+	checksum.Add(file.data + DATA_START, file.size - DATA_START);
+	if (checksum.Get() != header->checksum)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is corrupt (checksum mismatch)");
+
+	const EntryDesc* descs = file.Get<EntryDesc>(header->entriesOffset, header->numEntries);
+	if (!descs)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has an out-of-bounds entry table");
+
+	for (uint64_t i = 0; i < header->numEntries; i++) {
+		const EntryDesc& desc = descs[i];
+		if (memchr(desc.name, 0, sizeof(desc.name)) == NULL)
+			RG_ERR_CLOSE(ERROR_PREFIX << path << " has an entry with an invalid name");
+		if (desc.offset % ALIGN != 0 || !file.Get<uint8_t>(desc.offset, desc.numBytes))
+			RG_ERR_CLOSE(ERROR_PREFIX << path << " has an out-of-bounds entry \"" << desc.name << "\"");
+
+		if (desc.dtype != -1) {
+			if (desc.dtype < 0 || desc.dtype >= (int32_t)torch::ScalarType::NumOptions || desc.numDims < 0 || desc.numDims > MAX_DIMS)
+				RG_ERR_CLOSE(ERROR_PREFIX << path << " has an invalid tensor \"" << desc.name << "\"");
+
+			uint64_t numel = 1;
+			for (int j = 0; j < desc.numDims; j++)
+				numel *= desc.shape[j];
+			if (numel * c10::elementSize((torch::ScalarType)desc.dtype) != desc.numBytes)
+				RG_ERR_CLOSE(ERROR_PREFIX << path << " has a tensor \"" << desc.name << "\" whose shape doesn't match its size");
+		}
+
+		_entries[desc.name] = &desc;
+	}
+}
+
+torch::Tensor GGL::CheckpointFileReader::GetTensor(const std::string& name) const {
+	auto itr = _entries.find(name);
+	if (itr == _entries.end() || itr->second->dtype == -1)
+		return {};
+
+	const EntryDesc& desc = *itr->second;
+	return torch::from_blob(
+		(void*)(file.data + desc.offset),
+		torch::IntArrayRef(desc.shape, desc.numDims),
+		torch::TensorOptions().dtype((torch::ScalarType)desc.dtype)
+	);
+}
+
+bool GGL::CheckpointFileReader::GetBytes(const std::string& name, const void*& outData, size_t& outSize) const {
+	auto itr = _entries.find(name);
+	if (itr == _entries.end())
+		return false;
+
+	outData = file.data + itr->second->offset;
+	outSize = itr->second->numBytes;
+	return true;
+}
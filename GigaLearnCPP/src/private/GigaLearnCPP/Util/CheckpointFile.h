@@ -0,0 +1,103 @@
+#pragma once
+#include "../FrameworkTorch.h"
+#include <GigaLearnCPP/Util/MappedFile.h>
+
+// Single-file checkpoint format, with every model, optimizer state and the running stats in one file
+// Entries are named raw blobs that start on an ALIGN boundary, so tensors can be used straight from a memory mapping
+// All values are little-endian, everything after the header is covered by the checksum
+namespace GGL {
+	namespace CheckpointFile {
+		constexpr char MAGIC[4] = { 'G', 'G', 'L', 'C' };
+
+		// Increment whenever the layout changes
+		constexpr uint32_t VERSION = 1;
+
+		constexpr uint64_t ALIGN = 64;
+		constexpr int MAX_NAME_LEN = 95;
+		constexpr int MAX_DIMS = 8;
+
+		// Name of the file within a checkpoint folder
+		constexpr const char* FILE_NAME = "CHECKPOINT.gglc";
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint64_t fileSize; // To catch truncated files
+			uint64_t checksum; // Of everything after the (padded) header, see Checksum
+
+			uint64_t numEntries;
+			uint64_t entriesOffset; // EntryDesc[numEntries]
+		};
+
+		struct EntryDesc {
+			char name[MAX_NAME_LEN + 1]; // Null-terminated
+			int32_t dtype; // torch::ScalarType, or -1 for raw bytes
+			int32_t numDims;
+			int64_t shape[MAX_DIMS];
+			uint64_t offset, numBytes;
+		};
+
+		// Fast 64-bit checksum over 4 interleaved lanes of 8-byte words
+		// Data must be added in multiples of ALIGN, which every part of the file is padded to
+		struct Checksum {
+			uint64_t lanes[4] = { 1, 2, 3, 4 };
+
+			void Add(const void* data, size_t size);
+			uint64_t Get() const;
+		};
+	}
+
+	// Builds a checkpoint file from tensors and byte blobs
+	// Tensors are referenced, not copied, until Write()
+	class CheckpointFileWriter {
+	public:
+		void AddTensor(std::string name, torch::Tensor tensor);
+		void AddBytes(std::string name, std::string bytes);
+
+		// Writes to a temporary file first, then renames it into place
+		void Write(std::filesystem::path path) const;
+
+	private:
+		struct Entry {
+			CheckpointFile::EntryDesc desc;
+			torch::Tensor tensor; // CPU and contiguous, undefined for byte blobs
+			std::string bytes;
+		};
+		std::vector<Entry> _entries = {};
+
+		Entry& AddEntry(const std::string& name, int32_t dtype, uint64_t numBytes);
+	};
+
+	// Memory-maps a checkpoint file and verifies it
+	// Closes with an error if the file is missing, truncated, corrupt, or from an incompatible version
+	class CheckpointFileReader {
+	public:
+		std::filesystem::path path;
+		MappedFile file;
+
+		CheckpointFileReader(std::filesystem::path path);
+		RG_NO_COPY(CheckpointFileReader);
+
+		bool Has(const std::string& name) const {
+			return _entries.contains(name);
+		}
+
+		// Returns a CPU tensor that wraps the mapped data without copying it, or an undefined tensor if there is no such entry
+		// NOTE: The tensor is read-only, and only valid while this reader exists
+		torch::Tensor GetTensor(const std::string& name) const;
+
+		// Returns false if there is no such entry
+		bool GetBytes(const std::string& name, const void*& outData, size_t& outSize) const;
+
+		std::string GetString(const std::string& name) const {
+			const void* data;
+			size_t size;
+			if (!GetBytes(name, data, size))
+				return {};
+			return std::string((const char*)data, size);
+		}
+
+	private:
+		std::unordered_map<std::string, const CheckpointFile::EntryDesc*> _entries = {};
+	};
+}
@@ -0,0 +1,49 @@
+#include "CheckpointWriter.h"
+
+#include <GigaLearnCPP/Util/Utils.h>
+#include <GigaLearnCPP/Util/Timer.h>
+
+float GGL::CheckpointWriter::Start(std::filesystem::path folder, WriteFn writeFn, FinishFn finishFn, bool async) {
+	Timer waitTimer = {};
+	Wait();
+	float waitTime = waitTimer.Elapsed();
+
+	if (async) {
+		_thread = std::thread(Write, folder, writeFn, finishFn);
+	} else {
+		Write(folder, writeFn, finishFn);
+	}
+
+	return waitTime;
+}
+
+void GGL::CheckpointWriter::Wait() {
+	if (_thread.joinable())
+		_thread.join();
+}
+
+void GGL::CheckpointWriter::Write(std::filesystem::path folder, WriteFn writeFn, FinishFn finishFn) {
+	// Not a numbered folder, so an unfinished checkpoint is never loaded or counted as a checkpoint
+	std::filesystem::path tempFolder = folder;
+	tempFolder += ".tmp";
+
+	try {
+		std::filesystem::remove_all(tempFolder);
+		std::filesystem::create_directories(tempFolder);
+
+		writeFn(tempFolder);
+		Utils::SyncToDisk(tempFolder);
+
+		// Saving twice at the same timestep (e.g. saving on quit right after an auto-save) replaces the old checkpoint
+		std::filesystem::remove_all(folder);
+		std::filesystem::rename(tempFolder, folder);
+		Utils::SyncToDisk(folder.parent_path(), false);
+
+		if (finishFn)
+			finishFn();
+	} catch (std::exception& e) {
+		// Nothing can catch this on the writer thread, and training on without checkpoints would be worse than stopping
+		RG_LOG("CheckpointWriter: Failed to write checkpoint to " << folder << ", exception: " << e.what());
+		exit(EXIT_FAILURE);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <GigaLearnCPP/Framework.h>
+
+namespace GGL {
+
+	// Writes checkpoints on a background thread, so training only stalls while the state is copied into memory
+	// Each checkpoint is written to a temporary folder, flushed to disk, then renamed into place,
+	//	so a crash can never leave behind a checkpoint folder that looks complete but isn't
+	// Only one checkpoint is written at a time: starting another first waits for the previous one to finish
+	class CheckpointWriter {
+	public:
+		// Writes every file of the checkpoint into the passed folder, which already exists
+		typedef std::function<void(std::filesystem::path folder)> WriteFn;
+
+		// Runs after the checkpoint is in place (e.g. to remove old checkpoints)
+		typedef std::function<void()> FinishFn;
+
+		// Returns the time spent waiting for the previous checkpoint to finish
+		// If async is false, the checkpoint is written before returning
+		float Start(std::filesystem::path folder, WriteFn writeFn, FinishFn finishFn, bool async);
+
+		// Waits for the checkpoint in progress to finish, if there is one
+		void Wait();
+
+		bool IsWriting() const {
+			return _thread.joinable();
+		}
+
+		CheckpointWriter() = default;
+		RG_NO_COPY(CheckpointWriter);
+
+		~CheckpointWriter() {
+			Wait();
+		}
+
+	private:
+		std::thread _thread;
+		static void Write(std::filesystem::path folder, WriteFn writeFn, FinishFn finishFn);
+	};
+}
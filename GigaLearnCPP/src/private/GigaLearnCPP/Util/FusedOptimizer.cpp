@@ -0,0 +1,248 @@
+#include "FusedOptimizer.h"
+
+#include <ATen/Parallel.h>
+
+// Matches torch::nn::utils::clip_grad_norm_()
+constexpr float CLIP_GRAD_NORM_EPS = 1e-6f;
+
+// Elements per parallel task
+constexpr int64_t FUSED_OPTIM_GRAIN_SIZE = 1 << 15;
+
+GGL::FusedOptimizer::FusedOptimizer(ModelOptimType type, int64_t numParams, torch::Device device) : 
+	type(type), numParams(numParams), device(device) {
+
+	switch (type) {
+	case ModelOptimType::ADAM:
+	case ModelOptimType::ADAMW:
+	case ModelOptimType::RMSPROP:
+	case ModelOptimType::ADAGRAD:
+	case ModelOptimType::MAGSGD:
+		break;
+	default:
+		RG_ERR_CLOSE("FusedOptimizer: Unknown optimizer type: " << (int)type);
+	}
+}
+
+void GGL::FusedOptimizer::InitState() {
+	if (stateInitialized)
+		return;
+	stateInitialized = true;
+
+	auto options = torch::TensorOptions().dtype(torch::kFloat).device(device);
+	switch (type) {
+	case ModelOptimType::ADAM:
+	case ModelOptimType::ADAMW:
+		state1 = torch::zeros({ numParams }, options);
+		state2 = torch::zeros({ numParams }, options);
+		break;
+	case ModelOptimType::RMSPROP:
+	case ModelOptimType::ADAGRAD:
+		state1 = torch::zeros({ numParams }, options);
+		break;
+	}
+}
+
+void GGL::FusedOptimizer::Step(torch::Tensor params, torch::Tensor grads, float maxGradNorm) {
+	RG_NO_GRAD;
+	InitState();
+	stepCount++;
+
+	if (params.is_cpu() && params.is_contiguous() && grads.is_contiguous()) {
+		StepCPU(params.data_ptr<float>(), grads.const_data_ptr<float>(), params.numel(), maxGradNorm);
+	} else {
+		StepTensors(params, grads, maxGradNorm);
+	}
+}
+
+void GGL::FusedOptimizer::StepCPU(float* params, const float* grads, int64_t size, float maxGradNorm) {
+
+	// Scale applied to all gradients, from clipping or from MagSGD's normalization
+	float gradScale = 1;
+	if (maxGradNorm > 0 || type == ModelOptimType::MAGSGD) {
+		double sqSum = at::parallel_reduce(
+			0, size, FUSED_OPTIM_GRAIN_SIZE, 0.0,
+			[&](int64_t begin, int64_t end, double partial) {
+				float sum = 0;
+				for (int64_t i = begin; i < end; i++)
+					sum += grads[i] * grads[i];
+				return partial + sum;
+			},
+			std::plus<double>()
+		);
+		float norm = sqrt(sqSum);
+
+		if (maxGradNorm > 0) {
+			float clipCoef = maxGradNorm / (norm + CLIP_GRAD_NORM_EPS);
+			if (clipCoef < 1) {
+				gradScale = clipCoef;
+				norm *= clipCoef;
+			}
+		}
+
+		if (type == ModelOptimType::MAGSGD)
+			gradScale /= norm;
+	}
+
+	float lr = this->lr;
+	switch (type) {
+	case ModelOptimType::ADAM:
+	case ModelOptimType::ADAMW:
+	{
+		float beta1 = adamBeta1, oneMinusBeta1 = 1 - adamBeta1;
+		float beta2 = adamBeta2, oneMinusBeta2 = 1 - adamBeta2;
+		float eps = adamEps;
+		float biasCorrection2Sqrt = sqrt(1 - pow(adamBeta2, (double)stepCount));
+		float stepSize = lr / (1 - pow(adamBeta1, (double)stepCount));
+		float decayScale = (type == ModelOptimType::ADAMW) ? (1 - (double)lr * adamWWeightDecay) : 1;
+
+		float* expAvg = state1.data_ptr<float>();
+		float* expAvgSq = state2.data_ptr<float>();
+		at::parallel_for(0, size, FUSED_OPTIM_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; i++) {
+				float grad = grads[i] * gradScale;
+				expAvg[i] = expAvg[i] * beta1 + grad * oneMinusBeta1;
+				expAvgSq[i] = expAvgSq[i] * beta2 + grad * grad * oneMinusBeta2;
+				float denom = sqrtf(expAvgSq[i]) / biasCorrection2Sqrt + eps;
+				params[i] = params[i] * decayScale - stepSize * (expAvg[i] / denom);
+			}
+		});
+		break;
+	}
+	case ModelOptimType::RMSPROP:
+	{
+		float alpha = rmsPropAlpha, oneMinusAlpha = 1 - rmsPropAlpha, eps = rmsPropEps;
+		float* squareAvg = state1.data_ptr<float>();
+		at::parallel_for(0, size, FUSED_OPTIM_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; i++) {
+				float grad = grads[i] * gradScale;
+				squareAvg[i] = squareAvg[i] * alpha + grad * grad * oneMinusAlpha;
+				params[i] -= lr * (grad / (sqrtf(squareAvg[i]) + eps));
+			}
+		});
+		break;
+	}
+	case ModelOptimType::ADAGRAD:
+	{
+		float eps = adagradEps;
+		float* sum = state1.data_ptr<float>();
+		at::parallel_for(0, size, FUSED_OPTIM_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; i++) {
+				float grad = grads[i] * gradScale;
+				sum[i] += grad * grad;
+				params[i] -= lr * (grad / (sqrtf(sum[i]) + eps));
+			}
+		});
+		break;
+	}
+	case ModelOptimType::MAGSGD:
+	{
+		at::parallel_for(0, size, FUSED_OPTIM_GRAIN_SIZE, [&](int64_t begin, int64_t end) {
+			for (int64_t i = begin; i < end; i++)
+				params[i] -= lr * (grads[i] * gradScale);
+		});
+		break;
+	}
+	}
+}
+
+void GGL::FusedOptimizer::StepTensors(torch::Tensor params, torch::Tensor grads, float maxGradNorm) {
+
+	// Everything stays on the device, there are no host syncs
+	torch::Tensor gradScale;
+	if (maxGradNorm > 0 || type == ModelOptimType::MAGSGD) {
+		auto norm = grads.norm();
+		gradScale = torch::ones({}, grads.options());
+
+		if (maxGradNorm > 0) {
+			auto clipCoef = (maxGradNorm / (norm + CLIP_GRAD_NORM_EPS)).clamp_max(1);
+			gradScale = clipCoef;
+			norm = norm * clipCoef;
+		}
+
+		if (type == ModelOptimType::MAGSGD)
+			gradScale = gradScale / norm;
+	}
+	torch::Tensor grad = gradScale.defined() ? (grads * gradScale) : grads;
+
+	switch (type) {
+	case ModelOptimType::ADAM:
+	case ModelOptimType::ADAMW:
+	{
+		double biasCorrection1 = 1 - pow(adamBeta1, (double)stepCount);
+		double biasCorrection2Sqrt = sqrt(1 - pow(adamBeta2, (double)stepCount));
+
+		if (type == ModelOptimType::ADAMW)
+			params.mul_(1 - (double)lr * adamWWeightDecay);
+
+		state1.mul_(adamBeta1).add_(grad, 1 - adamBeta1);
+		state2.mul_(adamBeta2).addcmul_(grad, grad, 1 - adamBeta2);
+		auto denom = (state2.sqrt() / biasCorrection2Sqrt).add_(adamEps);
+		params.addcdiv_(state1, denom, -lr / biasCorrection1);
+		break;
+	}
+	case ModelOptimType::RMSPROP:
+		state1.mul_(rmsPropAlpha).addcmul_(grad, grad, 1 - rmsPropAlpha);
+		params.addcdiv_(grad, state1.sqrt().add_(rmsPropEps), -lr);
+		break;
+	case ModelOptimType::ADAGRAD:
+		state1.addcmul_(grad, grad, 1);
+		params.addcdiv_(grad, state1.sqrt().add_(adagradEps), -lr);
+		break;
+	case ModelOptimType::MAGSGD:
+		params.add_(grad, -lr);
+		break;
+	}
+}
+
+void GGL::FusedOptimizer::Save(torch::serialize::OutputArchive& archive) {
+	InitState();
+	SaveState(archive, stepCount, state1.defined() ? state1.cpu() : state1, state2.defined() ? state2.cpu() : state2);
+}
+
+void GGL::FusedOptimizer::CopyState(int64_t& outStepCount, torch::Tensor& outState1, torch::Tensor& outState2) {
+	RG_NO_GRAD;
+	InitState();
+
+	// cpu() doesn't copy tensors that are already on the CPU, and the state is updated in-place
+	auto fnCopy = [](torch::Tensor t) {
+		return t.defined() ? (t.is_cpu() ? t.clone() : t.cpu()) : t;
+	};
+
+	outStepCount = stepCount;
+	outState1 = fnCopy(state1);
+	outState2 = fnCopy(state2);
+}
+
+void GGL::FusedOptimizer::SaveState(torch::serialize::OutputArchive& archive, int64_t stepCount, torch::Tensor state1, torch::Tensor state2) {
+	archive.write("fused_step", torch::tensor(stepCount));
+	if (state1.defined())
+		archive.write("fused_state1", state1);
+	if (state2.defined())
+		archive.write("fused_state2", state2);
+}
+
+bool GGL::FusedOptimizer::Load(torch::serialize::InputArchive& archive) {
+	torch::Tensor savedStep, savedState1, savedState2;
+	if (!archive.try_read("fused_step", savedStep))
+		return false;
+	archive.try_read("fused_state1", savedState1);
+	archive.try_read("fused_state2", savedState2);
+	return LoadState(savedStep.item<int64_t>(), savedState1, savedState2);
+}
+
+bool GGL::FusedOptimizer::LoadState(int64_t savedStepCount, torch::Tensor savedState1, torch::Tensor savedState2) {
+	RG_NO_GRAD;
+	InitState();
+
+	if (state1.defined() && (!savedState1.defined() || savedState1.numel() != state1.numel()))
+		return false;
+	if (state2.defined() && (!savedState2.defined() || savedState2.numel() != state2.numel()))
+		return false;
+
+	stepCount = savedStepCount;
+	if (state1.defined())
+		state1.copy_(savedState1.reshape_as(state1));
+	if (state2.defined())
+		state2.copy_(savedState2.reshape_as(state2));
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "../FrameworkTorch.h"
+#include <GigaLearnCPP/Util/ModelConfig.h>
+
+#include <torch/serialize/input-archive.h>
+#include <torch/serialize/output-archive.h>
+
+namespace GGL {
+
+	// Optimizer that steps all of a model's parameters at once, from one flat parameter buffer and one flat gradient buffer
+	// On the CPU, each step is a norm reduction followed by a single parallel pass over the buffers
+	// On other devices, the same math is done with a handful of tensor ops over the whole buffer
+	// Hyperparameters and results match libtorch's optimizers with default options
+	struct FusedOptimizer {
+		ModelOptimType type;
+		float lr = 0;
+
+		// Matching libtorch's defaults
+		double adamBeta1 = 0.9, adamBeta2 = 0.999, adamEps = 1e-8;
+		double adamWWeightDecay = 1e-2;
+		double rmsPropAlpha = 0.99, rmsPropEps = 1e-8;
+		double adagradEps = 1e-10;
+
+		int64_t numParams;
+		torch::Device device;
+		int64_t stepCount = 0;
+
+		// Adam/AdamW: exp_avg, exp_avg_sq
+		// RMSprop: square_avg
+		// Adagrad: sum
+		// Only allocated once needed, so models that are never trained don't pay for them
+		torch::Tensor state1, state2;
+		bool stateInitialized = false;
+
+		FusedOptimizer(ModelOptimType type, int64_t numParams, torch::Device device);
+
+		// If maxGradNorm > 0, gradients are clipped to that norm first (same as torch::nn::utils::clip_grad_norm_)
+		// The gradients themselves are not modified
+		void Step(torch::Tensor params, torch::Tensor grads, float maxGradNorm);
+
+		void Save(torch::serialize::OutputArchive& archive);
+
+		// Copies the state into host memory, for SaveState() to write later (e.g. from another thread)
+		void CopyState(int64_t& outStepCount, torch::Tensor& outState1, torch::Tensor& outState2);
+		static void SaveState(torch::serialize::OutputArchive& archive, int64_t stepCount, torch::Tensor state1, torch::Tensor state2);
+
+		// Returns false if the archive has no fused optimizer state (e.g. it was saved by a regular optimizer)
+		bool Load(torch::serialize::InputArchive& archive);
+
+		// Returns false if the saved state doesn't match this optimizer's size
+		// Saved state tensors can be undefined if the optimizer type doesn't use them, and can be on any device
+		bool LoadState(int64_t savedStepCount, torch::Tensor savedState1, torch::Tensor savedState2);
+
+	private:
+		void InitState();
+		void StepCPU(float* params, const float* grads, int64_t size, float maxGradNorm);
+		void StepTensors(torch::Tensor params, torch::Tensor grads, float maxGradNorm);
+	};
+}
@@ -0,0 +1,39 @@
+#include "MLPKernels.h"
+
+namespace {
+	// Portable fallback, also used on non-x86 CPUs
+	struct VecScalar {
+		typedef float Reg;
+		static constexpr int WIDTH = 1;
+		static constexpr int TILE_ROWS = 4;
+		static constexpr int TILE_VECS = 8;
+		static constexpr int GEMV_VECS = 16;
+
+		static Reg Load(const float* ptr) { return *ptr; }
+		static void Store(float* ptr, Reg val) { *ptr = val; }
+		static Reg Set1(float val) { return val; }
+		static Reg FMA(Reg a, Reg b, Reg c) { return a * b + c; }
+		static Reg Mul(Reg a, Reg b) { return a * b; }
+
+		typedef int32_t IReg;
+		struct PairReg {
+			int32_t first, second;
+		};
+
+		static IReg IZero() { return 0; }
+		static PairReg LoadPairs(const int8_t* ptr) { return { ptr[0], ptr[1] }; }
+		static PairReg Set1Pair(const int16_t* ptr) { return { ptr[0], ptr[1] }; }
+		static IReg MAddPairs(IReg acc, PairReg a, PairReg b) { return acc + a.first * b.first + a.second * b.second; }
+		static Reg ToFloat(IReg val) { return (float)val; }
+	};
+
+	const GGL::MLPKernelSet KERNELS_SCALAR = {
+		"Scalar",
+		GGL::MLPKernels::Gemm<VecScalar>,
+		GGL::MLPKernels::GemmInt8<VecScalar>
+	};
+}
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsScalar() {
+	return &KERNELS_SCALAR;
+}
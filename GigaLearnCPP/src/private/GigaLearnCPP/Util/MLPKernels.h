@@ -0,0 +1,268 @@
+#pragma once
+#include <cstdint>
+
+// SIMD kernels for MLPEngine
+// The kernel templates are instantiated once per instruction set, each in its own translation unit compiled with the matching flags
+// (see MLPKernelsAVX2.cpp, MLPKernelsAVX512.cpp and MLPKernelsAVX512VNNI.cpp), and MLPEngine picks the best one supported by the CPU at runtime
+// NOTE: Vector types must be in an anonymous namespace, and the kernels must not call out-of-line library templates (e.g. std::min),
+//	otherwise the linker could merge an AVX-compiled instance into code that runs on CPUs without AVX
+
+// The tile loops have compile-time trip counts, and must be fully unrolled for the accumulators to stay in registers
+#if defined(__clang__)
+#define MLP_UNROLL _Pragma("unroll")
+#elif defined(__GNUC__)
+#define MLP_UNROLL _Pragma("GCC unroll 16")
+#else
+#define MLP_UNROLL
+#endif
+
+namespace GGL {
+
+	// Layer outputs are zero-padded to a multiple of this, so every kernel's vector width divides it
+	constexpr int MLP_OUTPUT_PAD = 16;
+
+	struct MLPKernelSet {
+		const char* name;
+
+		// out[r, o] = bias[o] + sum_i(in[r, i] * weightsT[i, o])
+		// weightsT is (numInputs, paddedOutputs), out has a row stride of paddedOutputs
+		void (*gemm)(
+			const float* in, int inStride, int numRows, int numInputs,
+			const float* weightsT, const float* bias, int paddedOutputs,
+			float* out
+		);
+
+		// Same as gemm(), but with int8 inputs and weights, accumulated as int32 then scaled back to floats
+		// out[r, o] = bias[o] + inScales[r] * weightScales[o] * sum_i(in[r, i] * weights[i, o])
+		// Inputs are processed in pairs: in rows have an even length (inStride values apart, 4-byte aligned),
+		//	and weights are (numPairs, paddedOutputs, 2), with each output's two weights for the pair next to each other
+		// The int8 input values are stored as int16, so that each pair can be broadcast with a single load
+		void (*gemmInt8)(
+			const int16_t* in, int inStride, const float* inScales, int numRows, int numPairs,
+			const int8_t* weights, const float* weightScales, const float* bias, int paddedOutputs,
+			float* out
+		);
+	};
+
+	// Returns NULL if the kernel set wasn't compiled in
+	const MLPKernelSet* GetMLPKernelsScalar();
+	const MLPKernelSet* GetMLPKernelsAVX2();
+	const MLPKernelSet* GetMLPKernelsAVX512();
+	const MLPKernelSet* GetMLPKernelsAVX512VNNI();
+
+	namespace MLPKernels {
+
+		// Computes a (ROWS x NV vectors) tile of the output, keeping all accumulators in registers
+		template <typename V, int ROWS, int NV>
+		inline void GemmTile(
+			const float* in, int inStride, int numInputs,
+			const float* weightsT, const float* bias, int paddedOutputs,
+			float* out) {
+
+			typename V::Reg acc[ROWS][NV];
+			MLP_UNROLL
+			for (int c = 0; c < NV; c++) {
+				auto biasVec = V::Load(bias + c * V::WIDTH);
+				MLP_UNROLL
+				for (int r = 0; r < ROWS; r++)
+					acc[r][c] = biasVec;
+			}
+
+			for (int i = 0; i < numInputs; i++) {
+				const float* weightRow = weightsT + (int64_t)i * paddedOutputs;
+
+				typename V::Reg weights[NV];
+				MLP_UNROLL
+				for (int c = 0; c < NV; c++)
+					weights[c] = V::Load(weightRow + c * V::WIDTH);
+
+				MLP_UNROLL
+				for (int r = 0; r < ROWS; r++) {
+					auto x = V::Set1(in[(int64_t)r * inStride + i]);
+					MLP_UNROLL
+					for (int c = 0; c < NV; c++)
+						acc[r][c] = V::FMA(x, weights[c], acc[r][c]);
+				}
+			}
+
+			MLP_UNROLL
+			for (int r = 0; r < ROWS; r++) {
+				MLP_UNROLL
+				for (int c = 0; c < NV; c++)
+					V::Store(out + (int64_t)r * paddedOutputs + c * V::WIDTH, acc[r][c]);
+			}
+		}
+
+		// Picks the GemmTile instance for a partial tile at the edge of the output
+		template <typename V, int ROWS, int NV>
+		inline void GemmTileVecs(
+			int numVecs,
+			const float* in, int inStride, int numInputs,
+			const float* weightsT, const float* bias, int paddedOutputs,
+			float* out) {
+
+			if (numVecs == NV) {
+				GemmTile<V, ROWS, NV>(in, inStride, numInputs, weightsT, bias, paddedOutputs, out);
+			} else if constexpr (NV > 1) {
+				GemmTileVecs<V, ROWS, NV - 1>(numVecs, in, inStride, numInputs, weightsT, bias, paddedOutputs, out);
+			}
+		}
+
+		template <typename V, int NV, int ROWS = V::TILE_ROWS>
+		inline void GemmTileRows(
+			int numRows, int numVecs,
+			const float* in, int inStride, int numInputs,
+			const float* weightsT, const float* bias, int paddedOutputs,
+			float* out) {
+
+			if (numRows == ROWS) {
+				GemmTileVecs<V, ROWS, NV>(numVecs, in, inStride, numInputs, weightsT, bias, paddedOutputs, out);
+			} else if constexpr (ROWS > 1) {
+				GemmTileRows<V, NV, ROWS - 1>(numRows, numVecs, in, inStride, numInputs, weightsT, bias, paddedOutputs, out);
+			}
+		}
+
+		// Int8 version of GemmTile()
+		template <typename V, int ROWS, int NV>
+		inline void GemmInt8Tile(
+			const int16_t* in, int inStride, const float* inScales, int numPairs,
+			const int8_t* weights, const float* weightScales, const float* bias, int paddedOutputs,
+			float* out) {
+
+			typename V::IReg acc[ROWS][NV];
+			MLP_UNROLL
+			for (int r = 0; r < ROWS; r++) {
+				MLP_UNROLL
+				for (int c = 0; c < NV; c++)
+					acc[r][c] = V::IZero();
+			}
+
+			for (int p = 0; p < numPairs; p++) {
+				const int8_t* weightRow = weights + (int64_t)p * paddedOutputs * 2;
+
+				typename V::PairReg pairWeights[NV];
+				MLP_UNROLL
+				for (int c = 0; c < NV; c++)
+					pairWeights[c] = V::LoadPairs(weightRow + c * V::WIDTH * 2);
+
+				MLP_UNROLL
+				for (int r = 0; r < ROWS; r++) {
+					auto x = V::Set1Pair(in + (int64_t)r * inStride + p * 2);
+					MLP_UNROLL
+					for (int c = 0; c < NV; c++)
+						acc[r][c] = V::MAddPairs(acc[r][c], x, pairWeights[c]);
+				}
+			}
+
+			MLP_UNROLL
+			for (int r = 0; r < ROWS; r++) {
+				auto inScale = V::Set1(inScales[r]);
+				MLP_UNROLL
+				for (int c = 0; c < NV; c++) {
+					auto scale = V::Mul(inScale, V::Load(weightScales + c * V::WIDTH));
+					auto result = V::FMA(V::ToFloat(acc[r][c]), scale, V::Load(bias + c * V::WIDTH));
+					V::Store(out + (int64_t)r * paddedOutputs + c * V::WIDTH, result);
+				}
+			}
+		}
+
+		template <typename V, int ROWS, int NV>
+		inline void GemmInt8TileVecs(
+			int numVecs,
+			const int16_t* in, int inStride, const float* inScales, int numPairs,
+			const int8_t* weights, const float* weightScales, const float* bias, int paddedOutputs,
+			float* out) {
+
+			if (numVecs == NV) {
+				GemmInt8Tile<V, ROWS, NV>(in, inStride, inScales, numPairs, weights, weightScales, bias, paddedOutputs, out);
+			} else if constexpr (NV > 1) {
+				GemmInt8TileVecs<V, ROWS, NV - 1>(numVecs, in, inStride, inScales, numPairs, weights, weightScales, bias, paddedOutputs, out);
+			}
+		}
+
+		template <typename V, int NV, int ROWS = V::TILE_ROWS>
+		inline void GemmInt8TileRows(
+			int numRows, int numVecs,
+			const int16_t* in, int inStride, const float* inScales, int numPairs,
+			const int8_t* weights, const float* weightScales, const float* bias, int paddedOutputs,
+			float* out) {
+
+			if (numRows == ROWS) {
+				GemmInt8TileVecs<V, ROWS, NV>(numVecs, in, inStride, inScales, numPairs, weights, weightScales, bias, paddedOutputs, out);
+			} else if constexpr (ROWS > 1) {
+				GemmInt8TileRows<V, NV, ROWS - 1>(numRows, numVecs, in, inStride, inScales, numPairs, weights, weightScales, bias, paddedOutputs, out);
+			}
+		}
+
+		template <typename V>
+		void GemmInt8(
+			const int16_t* in, int inStride, const float* inScales, int numRows, int numPairs,
+			const int8_t* weights, const float* weightScales, const float* bias, int paddedOutputs,
+			float* out) {
+
+			int totalVecs = paddedOutputs / V::WIDTH;
+
+			if (numRows == 1) {
+				for (int v = 0; v < totalVecs; v += V::GEMV_VECS) {
+					int numVecs = (totalVecs - v < V::GEMV_VECS) ? (totalVecs - v) : V::GEMV_VECS;
+					int offset = v * V::WIDTH;
+					GemmInt8TileVecs<V, 1, V::GEMV_VECS>(
+						numVecs, in, inStride, inScales, numPairs,
+						weights + offset * 2, weightScales + offset, bias + offset, paddedOutputs,
+						out + offset
+					);
+				}
+				return;
+			}
+
+			for (int v = 0; v < totalVecs; v += V::TILE_VECS) {
+				int numVecs = (totalVecs - v < V::TILE_VECS) ? (totalVecs - v) : V::TILE_VECS;
+				int offset = v * V::WIDTH;
+				for (int r = 0; r < numRows; r += V::TILE_ROWS) {
+					int tileRows = (numRows - r < V::TILE_ROWS) ? (numRows - r) : V::TILE_ROWS;
+					GemmInt8TileRows<V, V::TILE_VECS>(
+						tileRows, numVecs,
+						in + (int64_t)r * inStride, inStride, inScales + r, numPairs,
+						weights + offset * 2, weightScales + offset, bias + offset, paddedOutputs,
+						out + (int64_t)r * paddedOutputs + offset
+					);
+				}
+			}
+		}
+
+		template <typename V>
+		void Gemm(
+			const float* in, int inStride, int numRows, int numInputs,
+			const float* weightsT, const float* bias, int paddedOutputs,
+			float* out) {
+
+			int totalVecs = paddedOutputs / V::WIDTH;
+
+			if (numRows == 1) {
+				// Single row, so there's no weight reuse between rows
+				// Use wider tiles instead to keep more independent FMA chains in flight
+				for (int v = 0; v < totalVecs; v += V::GEMV_VECS) {
+					int numVecs = (totalVecs - v < V::GEMV_VECS) ? (totalVecs - v) : V::GEMV_VECS;
+					int offset = v * V::WIDTH;
+					GemmTileVecs<V, 1, V::GEMV_VECS>(numVecs, in, inStride, numInputs, weightsT + offset, bias + offset, paddedOutputs, out + offset);
+				}
+				return;
+			}
+
+			// Output tiles on the outside so each tile's weights stay in cache while we go through the rows
+			for (int v = 0; v < totalVecs; v += V::TILE_VECS) {
+				int numVecs = (totalVecs - v < V::TILE_VECS) ? (totalVecs - v) : V::TILE_VECS;
+				int offset = v * V::WIDTH;
+				for (int r = 0; r < numRows; r += V::TILE_ROWS) {
+					int tileRows = (numRows - r < V::TILE_ROWS) ? (numRows - r) : V::TILE_ROWS;
+					GemmTileRows<V, V::TILE_VECS>(
+						tileRows, numVecs,
+						in + (int64_t)r * inStride, inStride, numInputs,
+						weightsT + offset, bias + offset, paddedOutputs,
+						out + (int64_t)r * paddedOutputs + offset
+					);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include "MLPKernels.h"
+
+// This file is compiled with AVX2 and FMA enabled (see CMakeLists.txt)
+// Nothing here may run until MLPEngine has checked that the CPU supports them
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER)) // MSVC has no __FMA__, but /arch:AVX2 implies FMA
+#include <immintrin.h>
+#include <cstring>
+
+namespace {
+	struct VecAVX2 {
+		typedef __m256 Reg;
+		static constexpr int WIDTH = 8;
+
+		// 4x3 accumulators + 3 weights + 1 broadcast fits in the 16 YMM registers
+		static constexpr int TILE_ROWS = 4;
+		static constexpr int TILE_VECS = 3;
+		static constexpr int GEMV_VECS = 8;
+
+		static Reg Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+		static void Store(float* ptr, Reg val) { _mm256_storeu_ps(ptr, val); }
+		static Reg Set1(float val) { return _mm256_set1_ps(val); }
+		static Reg FMA(Reg a, Reg b, Reg c) { return _mm256_fmadd_ps(a, b, c); }
+		static Reg Mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+
+		// Int8 values are widened to int16 pairs, then multiplied and summed pairwise into int32 by madd
+		typedef __m256i IReg;
+		typedef __m256i PairReg;
+
+		static IReg IZero() { return _mm256_setzero_si256(); }
+		static PairReg LoadPairs(const int8_t* ptr) { return _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)ptr)); }
+		static PairReg Set1Pair(const int16_t* ptr) {
+			int32_t pair;
+			memcpy(&pair, ptr, sizeof(pair));
+			return _mm256_set1_epi32(pair);
+		}
+		static IReg MAddPairs(IReg acc, PairReg a, PairReg b) { return _mm256_add_epi32(acc, _mm256_madd_epi16(a, b)); }
+		static Reg ToFloat(IReg val) { return _mm256_cvtepi32_ps(val); }
+	};
+
+	const GGL::MLPKernelSet KERNELS_AVX2 = {
+		"AVX2",
+		GGL::MLPKernels::Gemm<VecAVX2>,
+		GGL::MLPKernels::GemmInt8<VecAVX2>
+	};
+}
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX2() {
+	return &KERNELS_AVX2;
+}
+
+#else
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX2() {
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,26 @@
+#include "MLPKernels.h"
+
+// This file is compiled with AVX-512F and AVX-512BW enabled (see CMakeLists.txt)
+// Nothing here may run until MLPEngine has checked that the CPU supports them
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include "MLPVecAVX512.h"
+
+namespace {
+	const GGL::MLPKernelSet KERNELS_AVX512 = {
+		"AVX-512",
+		GGL::MLPKernels::Gemm<VecAVX512>,
+		GGL::MLPKernels::GemmInt8<VecAVX512>
+	};
+}
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX512() {
+	return &KERNELS_AVX512;
+}
+
+#else
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX512() {
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include "MLPKernels.h"
+
+// This file is compiled with AVX-512F, AVX-512BW and AVX-512 VNNI enabled (see CMakeLists.txt)
+// Nothing here may run until MLPEngine has checked that the CPU supports them
+#if defined(__AVX512F__) && defined(__AVX512BW__) && (defined(__AVX512VNNI__) || defined(_MSC_VER)) // MSVC doesn't define __AVX512VNNI__
+#include "MLPVecAVX512.h"
+
+namespace {
+	struct VecAVX512VNNI : VecAVX512 {
+		// Same as madd then add, but as a single instruction
+		static IReg MAddPairs(IReg acc, PairReg a, PairReg b) { return _mm512_dpwssd_epi32(acc, a, b); }
+	};
+
+	const GGL::MLPKernelSet KERNELS_AVX512_VNNI = {
+		"AVX-512 VNNI",
+		GGL::MLPKernels::Gemm<VecAVX512VNNI>,
+		GGL::MLPKernels::GemmInt8<VecAVX512VNNI>
+	};
+}
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX512VNNI() {
+	return &KERNELS_AVX512_VNNI;
+}
+
+#else
+
+const GGL::MLPKernelSet* GGL::GetMLPKernelsAVX512VNNI() {
+	return NULL;
+}
+
+#endif
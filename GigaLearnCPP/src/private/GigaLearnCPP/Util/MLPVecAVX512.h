@@ -0,0 +1,39 @@
+#pragma once
+
+// AVX-512 vector traits for the MLPEngine kernels, shared by MLPKernelsAVX512.cpp and MLPKernelsAVX512VNNI.cpp
+// Only include this from translation units compiled with AVX-512 enabled
+#include "MLPKernels.h"
+#include <immintrin.h>
+#include <cstring>
+
+namespace {
+	struct VecAVX512 {
+		typedef __m512 Reg;
+		static constexpr int WIDTH = 16;
+
+		// 4x4 accumulators + 4 weights + 1 broadcast, out of 32 ZMM registers
+		static constexpr int TILE_ROWS = 4;
+		static constexpr int TILE_VECS = 4;
+		static constexpr int GEMV_VECS = 8;
+
+		static Reg Load(const float* ptr) { return _mm512_loadu_ps(ptr); }
+		static void Store(float* ptr, Reg val) { _mm512_storeu_ps(ptr, val); }
+		static Reg Set1(float val) { return _mm512_set1_ps(val); }
+		static Reg FMA(Reg a, Reg b, Reg c) { return _mm512_fmadd_ps(a, b, c); }
+		static Reg Mul(Reg a, Reg b) { return _mm512_mul_ps(a, b); }
+
+		// Int8 values are widened to int16 pairs, then multiplied and summed pairwise into int32 by madd
+		typedef __m512i IReg;
+		typedef __m512i PairReg;
+
+		static IReg IZero() { return _mm512_setzero_si512(); }
+		static PairReg LoadPairs(const int8_t* ptr) { return _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)ptr)); }
+		static PairReg Set1Pair(const int16_t* ptr) {
+			int32_t pair;
+			memcpy(&pair, ptr, sizeof(pair));
+			return _mm512_set1_epi32(pair);
+		}
+		static IReg MAddPairs(IReg acc, PairReg a, PairReg b) { return _mm512_add_epi32(acc, _mm512_madd_epi16(a, b)); }
+		static Reg ToFloat(IReg val) { return _mm512_cvtepi32_ps(val); }
+	};
+}
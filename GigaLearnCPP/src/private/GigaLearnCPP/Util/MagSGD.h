@@ -24,12 +24,15 @@ namespace GGL {
 			}
 
 			// Calculate total update magnitude
-			float gradMag = 0;
+			// This stays on the device, so there are no syncs
+			std::vector<torch::Tensor> gradSqSums = {};
 			for (auto& group : this->param_groups())
 				for (auto& param : group.params())
 					if (param.grad().defined())
-						gradMag += param.grad().detach().square().sum().cpu().item<float>();
-			gradMag = sqrtf(gradMag);
+						gradSqSums.push_back(param.grad().detach().square().sum());
+			if (gradSqSums.empty())
+				return SGD::step(closure);
+			torch::Tensor gradMag = torch::stack(gradSqSums).sum().sqrt();
 
 			// Normalize the gradients by dividing them by the update magnitude
 			for (auto& group : this->param_groups()) {
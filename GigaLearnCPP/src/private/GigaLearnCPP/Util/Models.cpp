@@ -3,6 +3,8 @@
 #include <torch/csrc/api/include/torch/serialize.h>
 #include <torch/csrc/api/include/torch/nn/utils/convert_parameters.h>
 #include <torch/nn/modules/normalization.h>
+#include <torch/nn/utils/clip_grad.h>
+#include <ATen/Parallel.h>
 
 GGL::Model::Model(
 	const char* modelName,
@@ -30,13 +32,50 @@ GGL::Model::Model(
 
 	register_module("seq", seq);
 	seq->to(device);
-	optim = MakeOptimizer(config.optimType, this->parameters(), 0);
+
+	if (config.fuseOptim) {
+		FlattenParams();
+		fusedOptim = new FusedOptimizer(config.optimType, flatParams.numel(), device);
+		optim = NULL;
+
+		// Fused optimizers only step models that actually received gradients, like regular optimizers do
+		for (auto& param : this->parameters())
+			param.register_hook([this](torch::Tensor grad) { _gradsReceived = true; });
+	} else {
+		optim = MakeOptimizer(config.optimType, this->parameters(), 0);
+	}
+}
+
+void GGL::Model::FlattenParams() {
+	RG_NO_GRAD;
+
+	auto params = this->parameters();
+	int64_t totalSize = 0;
+	for (auto& param : params)
+		totalSize += param.numel();
+
+	auto options = torch::TensorOptions().dtype(torch::kFloat).device(device);
+	flatParams = torch::empty({ totalSize }, options);
+	flatGrads = torch::zeros({ totalSize }, options);
+
+	int64_t offset = 0;
+	for (auto& param : params) {
+		int64_t size = param.numel();
+		auto paramView = flatParams.slice(0, offset, offset + size).view_as(param);
+		paramView.copy_(param);
+		param.set_data(paramView);
+		param.mutable_grad() = flatGrads.slice(0, offset, offset + size).view_as(param);
+		offset += size;
+	}
 }
 
 torch::Tensor GGL::Model::Forward(torch::Tensor input, bool halfPrec) {
 
-	if (torch::GradMode::is_enabled())
+	if (torch::GradMode::is_enabled()) {
 		halfPrec = false;
+	} else if ((config.engineInference || config.int8Inference) && input.is_cpu()) {
+		return ForwardEngine(input);
+	}
 
 	if (halfPrec) {
 
@@ -65,6 +104,136 @@ torch::Tensor GGL::Model::Forward(torch::Tensor input, bool halfPrec) {
 	}
 }
 
+bool GGL::Model::_ParamsChangedSince(const std::vector<std::pair<const void*, int64_t>>& paramStates) {
+	auto params = this->parameters();
+	if (params.size() != paramStates.size())
+		return true;
+
+	for (int i = 0; i < params.size(); i++)
+		if (params[i].data_ptr() != paramStates[i].first || params[i]._version() != paramStates[i].second)
+			return true;
+
+	return false;
+}
+
+void GGL::Model::_RecordParamStates(std::vector<std::pair<const void*, int64_t>>& outParamStates) {
+	outParamStates.clear();
+	for (auto& param : this->parameters())
+		outParamStates.push_back({ param.data_ptr(), param._version() });
+}
+
+GGL::MLPEngine* GGL::Model::MakeMLPEngine() {
+	RG_NO_GRAD;
+
+	auto toCPU = [](torch::Tensor tensor) {
+		return tensor.detach().to(torch::kCPU, torch::kFloat32).contiguous();
+	};
+
+	struct PendingLayer {
+		torch::Tensor weight, bias, normWeight, normBias;
+		bool activate;
+	};
+	std::vector<PendingLayer> pendingLayers = {};
+	for (auto& module : seq->children()) {
+		if (auto linear = module->as<torch::nn::Linear>()) {
+			pendingLayers.push_back({ toCPU(linear->weight), toCPU(linear->bias), {}, {}, false });
+		} else if (auto layerNorm = module->as<torch::nn::LayerNorm>()) {
+			pendingLayers.back().normWeight = toCPU(layerNorm->weight);
+			pendingLayers.back().normBias = toCPU(layerNorm->bias);
+		} else {
+			pendingLayers.back().activate = true;
+		}
+	}
+
+	MLPEngine* engine = new MLPEngine(config.activationType);
+	for (auto& layer : pendingLayers) {
+		bool hasNorm = layer.normWeight.defined();
+		engine->AddLayer(
+			layer.weight.size(1), layer.weight.size(0),
+			layer.weight.data_ptr<float>(), layer.bias.data_ptr<float>(),
+			hasNorm ? layer.normWeight.data_ptr<float>() : NULL, hasNorm ? layer.normBias.data_ptr<float>() : NULL,
+			layer.activate
+		);
+	}
+
+	return engine;
+}
+
+void GGL::Model::RebuildEngine() {
+	RG_NO_GRAD;
+
+	delete _engine;
+	_engine = MakeMLPEngine();
+
+	if (config.int8Inference) {
+		if (_int8CalibrationInputs.defined()) {
+			auto calibInputs = _int8CalibrationInputs.reshape({ -1, _engine->GetNumInputs() });
+			_engine->QuantizeInt8(calibInputs.data_ptr<float>(), calibInputs.size(0));
+		} else {
+			_engine->QuantizeInt8();
+		}
+	}
+
+	_RecordParamStates(_engineParamStates);
+	_engineOutdated = false;
+}
+
+void GGL::Model::SetInt8Calibration(torch::Tensor sampleInputs) {
+	std::lock_guard<std::mutex> lock(_engineMutex);
+	_int8CalibrationInputs = sampleInputs.detach().to(torch::kCPU, torch::kFloat32).contiguous().clone();
+	_engineOutdated = true;
+}
+
+torch::Tensor GGL::Model::ForwardEngine(torch::Tensor input) {
+	RG_NO_GRAD;
+
+	auto inputSizes = input.sizes().vec();
+	auto x = input.reshape({ -1, inputSizes.back() }).to(torch::kFloat32).contiguous();
+	int64_t numRows = x.size(0);
+
+	std::lock_guard<std::mutex> lock(_engineMutex);
+
+	if (!_engineOutdated && _ParamsChangedSince(_engineParamStates))
+		_engineOutdated = true;
+
+	if (_engineOutdated)
+		RebuildEngine();
+
+	int numOutputs = _engine->GetNumOutputs();
+	auto output = torch::empty({ numRows, (int64_t)numOutputs }, torch::kFloat32);
+
+	// The engine itself is single-threaded, so split big batches between torch's threads, each with its own buffers
+	constexpr int64_t MIN_ROWS_PER_JOB = 64;
+	int64_t numJobs = RS_MAX(RS_MIN((int64_t)at::get_num_threads(), numRows / MIN_ROWS_PER_JOB), (int64_t)1);
+	if (_engineBuffers.size() < (size_t)numJobs)
+		_engineBuffers.resize(numJobs);
+
+	const float* inputPtr = x.data_ptr<float>();
+	float* outputPtr = output.data_ptr<float>();
+	int64_t rowsPerJob = (numRows + numJobs - 1) / numJobs;
+	at::parallel_for(0, numJobs, 1,
+		[&](int64_t jobStart, int64_t jobEnd) {
+			for (int64_t job = jobStart; job < jobEnd; job++) {
+				int64_t rowStart = job * rowsPerJob;
+				int64_t rowEnd = RS_MIN(rowStart + rowsPerJob, numRows);
+				if (rowStart >= rowEnd)
+					continue;
+
+				const float* jobOutput = _engine->Forward(
+					inputPtr + rowStart * x.size(1), (int)(rowEnd - rowStart), 0, _engineBuffers[job]
+				);
+
+				int outStride = _engine->GetOutputStride();
+				for (int64_t r = rowStart; r < rowEnd; r++)
+					memcpy(outputPtr + r * numOutputs, jobOutput + (r - rowStart) * outStride, numOutputs * sizeof(float));
+			}
+		}
+	);
+
+	inputSizes.back() = numOutputs;
+	return output.view(inputSizes);
+}
+
 // Get sizes of all parameters in a sequence
 std::vector<uint64_t> GetSeqSizes(torch::nn::Sequential& seq) {
 	std::vector<uint64_t> result = {};
@@ -77,13 +246,106 @@ std::vector<uint64_t> GetSeqSizes(torch::nn::Sequential& seq) {
 }
 
 void GGL::Model::SetOptimLR(float newLR) {
-	SetOptimizerLR(optim, config.optimType, newLR);
+	if (fusedOptim) {
+		fusedOptim->lr = newLR;
+	} else {
+		SetOptimizerLR(optim, config.optimType, newLR);
+	}
 }
 
 void GGL::Model::StepOptim() {
-	optim->step();
-	optim->zero_grad();
+	if (fusedOptim) {
+		if (_gradsReceived)
+			fusedOptim->Step(flatParams, flatGrads, _pendingGradClip);
+		ZeroGrad();
+	} else {
+		optim->step();
+		optim->zero_grad();
+	}
 	_seqHalfOutdated = true;
+	_engineOutdated = true;
+}
+
+void GGL::Model::ZeroGrad() {
+	if (fusedOptim) {
+		if (_gradsReceived)
+			flatGrads.zero_();
+		_gradsReceived = false;
+		_pendingGradClip = 0;
+	} else {
+		optim->zero_grad();
+	}
+}
+
+void GGL::Model::ClipGradNorm(float maxNorm) {
+	if (fusedOptim) {
+		_pendingGradClip = maxNorm;
+	} else {
+		torch::nn::utils::clip_grad_norm_(this->parameters(), maxNorm);
+	}
+}
+
+GGL::MemoryUsage GGL::Model::GetMemoryUsage() {
+	MemoryUsage usage = {};
+	if (flatParams.defined()) {
+		// Parameters and gradients are views into these
+		usage += GetTensorUsage(flatParams);
+		usage += GetTensorUsage(flatGrads);
+	} else {
+		for (auto& param : this->parameters()) {
+			usage += GetTensorUsage(param);
+			usage += GetTensorUsage(param.grad());
+		}
+	}
+
+	for (auto& param : seqHalf->parameters())
+		usage += GetTensorUsage(param);
+
+	{
+		std::lock_guard<std::mutex> lock(_engineMutex);
+		if (_engine)
+			usage.host += _engine->GetMemoryBytes();
+		for (auto& buffers : _engineBuffers)
+			usage.host += buffers.GetMemoryBytes();
+		usage += GetTensorUsage(_int8CalibrationInputs);
+	}
+
+	return usage;
+}
+
+GGL::MemoryUsage GGL::Model::GetOptimMemoryUsage() {
+	if (fusedOptim) {
+		MemoryUsage usage = GetTensorUsage(fusedOptim->state1);
+		usage += GetTensorUsage(fusedOptim->state2);
+		return usage;
+	}
+
+	if (!optim)
+		return {};
+
+	// Per-parameter state is only created once a parameter is first stepped
+	MemoryUsage usage = {};
+	for (auto& pair : optim->state()) {
+		auto* state = pair.second.get();
+		if (auto adamState = dynamic_cast<torch::optim::AdamParamState*>(state)) {
+			usage += GetTensorUsage(adamState->exp_avg());
+			usage += GetTensorUsage(adamState->exp_avg_sq());
+			usage += GetTensorUsage(adamState->max_exp_avg_sq());
+		} else if (auto adamWState = dynamic_cast<torch::optim::AdamWParamState*>(state)) {
+			usage += GetTensorUsage(adamWState->exp_avg());
+			usage += GetTensorUsage(adamWState->exp_avg_sq());
+			usage += GetTensorUsage(adamWState->max_exp_avg_sq());
+		} else if (auto adagradState = dynamic_cast<torch::optim::AdagradParamState*>(state)) {
+			usage += GetTensorUsage(adagradState->sum());
+		} else if (auto rmsPropState = dynamic_cast<torch::optim::RMSpropParamState*>(state)) {
+			usage += GetTensorUsage(rmsPropState->square_avg());
+			usage += GetTensorUsage(rmsPropState->momentum_buffer());
+			usage += GetTensorUsage(rmsPropState->grad_avg());
+		} else if (auto sgdState = dynamic_cast<torch::optim::SGDParamState*>(state)) { // Also MagSGD
+			usage += GetTensorUsage(sgdState->momentum_buffer());
+		}
+	}
+	return usage;
 }
 
 void GGL::Model::Save(std::filesystem::path folder, bool saveOptim) {
@@ -93,12 +355,152 @@ void GGL::Model::Save(std::filesystem::path folder, bool saveOptim) {
 
 	if (saveOptim) {
 		torch::serialize::OutputArchive optimArchive;
-		optim->save(optimArchive);
+		if (fusedOptim) {
+			fusedOptim->Save(optimArchive);
+		} else {
+			optim->save(optimArchive);
+		}
 		optimArchive.save_to(GetOptimSavePath(folder).string());
 	}
 }
 
+GGL::ModelSnapshot GGL::Model::MakeSnapshot(bool saveOptim) {
+	RG_NO_GRAD;
+
+	ModelSnapshot snapshot = {};
+	snapshot.modelName = modelName;
+	snapshot.saveFileName = GetSavePath({}).string();
+	snapshot.optimSaveFileName = GetOptimSavePath({}).string();
+
+	// Cloning to a device is only guaranteed to copy when it is a different device
+	std::shared_ptr<torch::nn::Module> seqClone = device.is_cpu() ? seq->clone() : seq->clone(torch::Device(torch::kCPU));
+	snapshot.seq = torch::nn::Sequential(std::dynamic_pointer_cast<torch::nn::SequentialImpl>(seqClone));
+
+	if (saveOptim) {
+		snapshot.hasOptim = true;
+		if (fusedOptim) {
+			snapshot.fused = true;
+			fusedOptim->CopyState(snapshot.fusedStepCount, snapshot.fusedState1, snapshot.fusedState2);
+		} else {
+			torch::serialize::OutputArchive optimArchive;
+			optim->save(optimArchive);
+			std::ostringstream stream;
+			optimArchive.save_to(stream);
+			snapshot.optimData = stream.str();
+		}
+	}
+
+	return snapshot;
+}
+
+void GGL::ModelSnapshot::Write(std::filesystem::path folder) const {
+	std::filesystem::path path = folder / saveFileName;
+	auto streamOut = std::ofstream(path, std::ios::binary);
+	torch::save(seq, streamOut);
+	if (!streamOut.good())
+		RG_ERR_CLOSE("ModelSnapshot::Write(): Failed to write to " << path);
+
+	if (hasOptim) {
+		std::filesystem::path optimPath = folder / optimSaveFileName;
+		if (fused) {
+			torch::serialize::OutputArchive optimArchive;
+			FusedOptimizer::SaveState(optimArchive, fusedStepCount, fusedState1, fusedState2);
+			optimArchive.save_to(optimPath.string());
+		} else {
+			auto optimStreamOut = std::ofstream(optimPath, std::ios::binary);
+			optimStreamOut.write(optimData.data(), optimData.size());
+			if (!optimStreamOut.good())
+				RG_ERR_CLOSE("ModelSnapshot::Write(): Failed to write to " << optimPath);
+		}
+	}
+}
+
+void GGL::ModelSnapshot::AddTo(CheckpointFileWriter& writer) const {
+	std::string prefix = modelName + ".";
+
+	auto params = seq->parameters();
+	for (int i = 0; i < params.size(); i++)
+		writer.AddTensor(prefix + "param." + std::to_string(i), params[i]);
+
+	if (hasOptim) {
+		if (fused) {
+			writer.AddTensor(prefix + "optim.fused_step", torch::tensor(fusedStepCount));
+			if (fusedState1.defined())
+				writer.AddTensor(prefix + "optim.fused_state1", fusedState1);
+			if (fusedState2.defined())
+				writer.AddTensor(prefix + "optim.fused_state2", fusedState2);
+		} else {
+			writer.AddBytes(prefix + "optim.archive", optimData);
+		}
+	}
+}
+
+void GGL::Model::Load(const CheckpointFileReader& reader, bool allowNotExist, bool loadOptim) {
+	RG_NO_GRAD;
+
+	std::string prefix = std::string(modelName) + ".";
+	if (!reader.Has(prefix + "param.0")) {
+		if (allowNotExist) {
+			RG_LOG("Warning: Model \"" << modelName << "\" does not exist in " << reader.path << " and will be reset");
+			return;
+		} else {
+			RG_ERR_CLOSE("Model \"" << modelName << "\" does not exist in " << reader.path);
+		}
+	}
+
+	// Check every size before loading anything, so a mismatched checkpoint can't leave the model half-loaded
+	auto params = parameters();
+	std::vector<torch::Tensor> savedParams = {};
+	bool sizesMatch = !reader.Has(prefix + "param." + std::to_string(params.size()));
+	for (int i = 0; i < params.size() && sizesMatch; i++) {
+		torch::Tensor savedParam = reader.GetTensor(prefix + "param." + std::to_string(i));
+		sizesMatch = savedParam.defined() && savedParam.sizes() == params[i].sizes() && savedParam.scalar_type() == params[i].scalar_type();
+		savedParams.push_back(savedParam);
+	}
+
+	if (!sizesMatch)
+		RG_ERR_CLOSE("Saved model \"" << modelName << "\" in " << reader.path << " has different parameters than the current model, checkpoint may be of a different model arch");
+
+	// The saved params wrap the mapped file, so this is the only copy (and also moves them to the device)
+	// Copying keeps the existing parameter tensors, so a fused optimizer's flat buffers stay valid
+	for (int i = 0; i < params.size(); i++)
+		params[i].copy_(savedParams[i]);
+
+	_seqHalfOutdated = true;
+	_engineOutdated = true;
+
+	if (loadOptim) {
+		if (fusedOptim) {
+			torch::Tensor savedStep = reader.GetTensor(prefix + "optim.fused_step");
+			bool loaded = savedStep.defined() && fusedOptim->LoadState(
+				savedStep.item<int64_t>(),
+				reader.GetTensor(prefix + "optim.fused_state1"),
+				reader.GetTensor(prefix + "optim.fused_state2")
+			);
+			if (!loaded)
+				RG_LOG("WARNING: Saved optimizer for \"" << modelName << "\" in " << reader.path << " was not saved by a fused optimizer of the same size, optimizer will be reset");
+		} else {
+			const void* optimData;
+			size_t optimDataSize;
+			if (reader.GetBytes(prefix + "optim.archive", optimData, optimDataSize)) {
+				torch::serialize::InputArchive optimArchive;
+				optimArchive.load_from((const char*)optimData, optimDataSize, device);
+				optim->load(optimArchive);
+			} else {
+				RG_LOG("WARNING: No optimizer for \"" << modelName << "\" found in " << reader.path << ", optimizer will be reset");
+			}
+		}
+	}
+}
+
 void GGL::Model::Load(std::filesystem::path folder, bool allowNotExist, bool loadOptim) {
+	std::filesystem::path checkpointPath = folder / CheckpointFile::FILE_NAME;
+	if (std::filesystem::exists(checkpointPath)) {
+		CheckpointFileReader reader = CheckpointFileReader(checkpointPath);
+		Load(reader, allowNotExist, loadOptim);
+		return;
+	}
+
 	std::filesystem::path path = GetSavePath(folder);
 
 	if (!std::filesystem::exists(path)) {
@@ -147,6 +549,12 @@ void GGL::Model::Load(std::filesystem::path folder, bool allowNotExist, bool loa
 		RG_ERR_CLOSE(stream.str());
 	}
 
+	// Loading replaces the parameter tensors, so they need to be packed again
+	if (fusedOptim)
+		FlattenParams();
+	_seqHalfOutdated = true;
+	_engineOutdated = true;
+
 	/////////////////////////////
 
 	if (loadOptim) {
@@ -157,7 +565,12 @@ void GGL::Model::Load(std::filesystem::path folder, bool allowNotExist, bool loa
 			if (testStream.tellg() > 0) {
 				torch::serialize::InputArchive optimArchive;
 				optimArchive.load_from(optimPath.string(), device);
-				optim->load(optimArchive);
+				if (fusedOptim) {
+					if (!fusedOptim->Load(optimArchive))
+						RG_LOG("WARNING: Saved optimizer at " << optimPath << " was not saved by a fused optimizer of the same size, optimizer will be reset");
+				} else {
+					optim->load(optimArchive);
+				}
 			} else {
 				RG_LOG("WARNING: Saved optimizer at " << optimPath << " is empty, optimizer will be reset");
 			}
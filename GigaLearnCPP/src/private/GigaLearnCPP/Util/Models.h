@@ -12,9 +12,13 @@
 #include <torch/optim/sgd.h>
 
 #include "MagSGD.h"
+#include "FusedOptimizer.h"
+#include "CheckpointFile.h"
 
 #include <GigaLearnCPP/PPO/PPOLearnerConfig.h>
 #include <GigaLearnCPP/Util/ModelConfig.h>
+#include <GigaLearnCPP/Util/MLPEngine.h>
+#include <GigaLearnCPP/Util/MemoryAccounting.h>
 
 namespace GGL {
 
@@ -37,6 +41,14 @@ namespace GGL {
 		RG_ERR_CLOSE("Unknown activation function type: " << (int)type);
 	}
 
+	// Counted as host or device memory depending on where the tensor lives
+	inline MemoryUsage GetTensorUsage(const torch::Tensor& tensor) {
+		MemoryUsage usage = {};
+		if (tensor.defined())
+			(tensor.is_cpu() ? usage.host : usage.device) = tensor.nbytes();
+		return usage;
+	}
+
 	inline torch::optim::Optimizer* MakeOptimizer(ModelOptimType type, const std::vector<torch::Tensor>& parameters, float lr) {
 		switch (type) {
 		case ModelOptimType::ADAM:
@@ -81,6 +93,30 @@ namespace GGL {
 
 	//////////////////////////
 
+	// Host memory copy of a model and its optimizer state, made by Model::MakeSnapshot()
+	// The model can keep training while this is written, even from another thread
+	struct ModelSnapshot {
+		std::string modelName;
+		std::string saveFileName, optimSaveFileName;
+		torch::nn::Sequential seq; // CPU clone
+
+		bool hasOptim = false;
+
+		// Fused optimizer state, copied to the CPU
+		bool fused = false;
+		int64_t fusedStepCount = 0;
+		torch::Tensor fusedState1, fusedState2;
+
+		// libtorch optimizers only expose their state through serialization, so it is serialized when snapshotted
+		std::string optimData;
+
+		// Writes the same files as Model::Save()
+		void Write(std::filesystem::path folder) const;
+
+		// Adds the model and optimizer state to a single-file checkpoint, see Model::Load()
+		void AddTo(CheckpointFileWriter& writer) const;
+	};
+
 	class Model : public torch::nn::Module {
 	public:
 		const char* modelName;
@@ -89,9 +125,23 @@ namespace GGL {
 		bool _seqHalfOutdated = true;
 		ModelConfig config;
 
-		torch::optim::Optimizer* optim;
+		torch::optim::Optimizer* optim; // NULL if using a fused optimizer
+		FusedOptimizer* fusedOptim = NULL;
+
+		// With a fused optimizer, all parameters and their gradients are views into these
+		torch::Tensor flatParams, flatGrads;
+		std::atomic<bool> _gradsReceived = false;
+		float _pendingGradClip = 0;
 
-		Model() : config(PartialModelConfig{}), device({}), modelName(NULL) {} // Uninitialized init
+		// Float or int8 inference copy of seq, see ForwardEngine()
+		MLPEngine* _engine = NULL;
+		std::vector<MLPEngine::Buffers> _engineBuffers; // One set per thread
+		std::vector<std::pair<const void*, int64_t>> _engineParamStates;
+		torch::Tensor _int8CalibrationInputs; // Undefined if uncalibrated
+		bool _engineOutdated = true;
+		std::mutex _engineMutex;
+
+		Model() : config(PartialModelConfig{}), device({}), modelName(NULL), optim(NULL) {} // Uninitialized init
 
 		Model(
 			const char* modelName,
@@ -100,10 +150,33 @@ namespace GGL {
 		);
 
 		virtual torch::Tensor Forward(torch::Tensor input, bool halfPrec);
+
+		// Runs the model through an MLPEngine copy of its weights on the CPU, rebuilding it first if the parameters have changed
+		// The copy uses int8 weights if config.int8Inference is set (see PartialModelConfig::engineInference)
+		// Only valid without autograd
+		torch::Tensor ForwardEngine(torch::Tensor input);
+		void RebuildEngine();
+
+		// Sets sample inputs to calibrate the int8 input scales with, and requantizes
+		void SetInt8Calibration(torch::Tensor sampleInputs);
 		
 		void SetOptimLR(float newLR);
 
 		void StepOptim();
+		void ZeroGrad();
+
+		// With a fused optimizer, the clipping is done as part of the next step
+		void ClipGradNorm(float maxNorm);
+
+		// Copies the current weights into a new torch-free inference engine
+		MLPEngine* MakeMLPEngine();
+
+		// Returns true if any parameter has been replaced or modified since paramStates was recorded
+		bool _ParamsChangedSince(const std::vector<std::pair<const void*, int64_t>>& paramStates);
+		void _RecordParamStates(std::vector<std::pair<const void*, int64_t>>& outParamStates);
+
+		// Packs all parameters and gradients into flatParams and flatGrads
+		void FlattenParams();
 
 		std::filesystem::path GetSuffixedSavePath(std::filesystem::path folder, std::string suffix) const {
 			std::string filename = modelName + suffix ;
@@ -122,7 +195,10 @@ namespace GGL {
 		}
 
 		virtual void Save(std::filesystem::path folder, bool saveOptim = true);
+		ModelSnapshot MakeSnapshot(bool saveOptim = true);
+		// Loads from the folder's single-file checkpoint if it has one, otherwise from the .lt files
 		virtual void Load(std::filesystem::path folder, bool allowNotExist, bool loadOptim = true);
+		virtual void Load(const CheckpointFileReader& reader, bool allowNotExist, bool loadOptim = true);
 
 		virtual torch::Tensor CopyParams() const;
 
@@ -153,7 +229,17 @@ namespace GGL {
 			return total;
 		}
 
-		virtual ~Model() = default;
+		// Memory held by the parameters, their gradients, and the half/engine inference copies
+		MemoryUsage GetMemoryUsage();
+
+		// Memory held by the optimizer's state (e.g. Adam's moving averages)
+		MemoryUsage GetOptimMemoryUsage();
+
+		virtual ~Model() {
+			delete optim;
+			delete fusedOptim;
+			delete _engine;
+		}
 	};
 
 	class ModelSet {
@@ -180,14 +266,53 @@ namespace GGL {
 			}
 		}
 
+		// Discards accumulated gradients without stepping
+		void ZeroGrads() {
+			for (Model* model : *this)
+				model->ZeroGrad();
+		}
+
+		MemoryUsage GetMemoryUsage() {
+			MemoryUsage total = {};
+			for (Model* model : *this)
+				total += model->GetMemoryUsage();
+			return total;
+		}
+
+		MemoryUsage GetOptimMemoryUsage() {
+			MemoryUsage total = {};
+			for (Model* model : *this)
+				total += model->GetOptimMemoryUsage();
+			return total;
+		}
+
 		void Save(std::filesystem::path folder, bool saveOptims = true) {
 			for (Model* model : *this)
 				model->Save(folder, saveOptims);
 		}
 
+		std::vector<ModelSnapshot> MakeSnapshots(bool saveOptims = true) {
+			std::vector<ModelSnapshot> snapshots = {};
+			for (Model* model : *this)
+				snapshots.push_back(model->MakeSnapshot(saveOptims));
+			return snapshots;
+		}
+
 		void Load(std::filesystem::path folder, bool allowNotExist, bool loadOptims) {
+			// Single-file checkpoints are only mapped and verified once for all models
+			std::filesystem::path checkpointPath = folder / CheckpointFile::FILE_NAME;
+			if (std::filesystem::exists(checkpointPath)) {
+				CheckpointFileReader reader = CheckpointFileReader(checkpointPath);
+				Load(reader, allowNotExist, loadOptims);
+			} else {
+				for (Model* model : *this)
+					model->Load(folder, allowNotExist, loadOptims);
+			}
+		}
+
+		void Load(const CheckpointFileReader& reader, bool allowNotExist, bool loadOptims) {
 			for (Model* model : *this)
-				model->Load(folder, allowNotExist, loadOptims);
+				model->Load(reader, allowNotExist, loadOptims);
 		}
 
 		class ModelIterator : public std::iterator<std::forward_iterator_tag, typename Model*> {
@@ -0,0 +1,75 @@
+#include "ObsStandardizer.h"
+#include <atomic>
+
+GGL::ObsStandardizer::ObsStandardizer(BatchedWelfordStat* stat, float minSTD, float maxMeanRange) :
+	stat(stat), minSTD(minSTD), maxMeanRange(maxMeanRange) {
+
+	// Unique per standardizer so thread-local lookups can't match a deleted one at the same address
+	static std::atomic<uint64_t> nextID = 1;
+	id = nextID++;
+
+	UpdateCache();
+}
+
+GGL::ObsStandardizer::~ObsStandardizer() {
+	for (auto threadStat : threadStats)
+		delete threadStat;
+}
+
+GGL::BatchedWelfordStat* GGL::ObsStandardizer::GetThreadStat() {
+	thread_local uint64_t cachedID = 0;
+	thread_local BatchedWelfordStat* cachedStat = NULL;
+
+	if (cachedID != id) {
+		std::lock_guard<std::mutex> lock(threadStatsMutex);
+		cachedStat = new BatchedWelfordStat(stat->width);
+		threadStats.push_back(cachedStat);
+		cachedID = id;
+	}
+
+	return cachedStat;
+}
+
+void GGL::ObsStandardizer::ProcessObs(float* obs) {
+	GetThreadStat()->IncrementRow(obs);
+	StandardizeObs(obs);
+}
+
+void GGL::ObsStandardizer::StandardizeObs(float* obs) const {
+	int width = stat->width;
+	const float* __restrict meanData = mean.data();
+	const float* __restrict invSTDData = invSTD.data();
+	float* __restrict obsData = obs;
+
+	// Simple enough for the compiler to vectorize
+	for (int i = 0; i < width; i++)
+		obsData[i] = (obsData[i] - meanData[i]) * invSTDData[i];
+}
+
+void GGL::ObsStandardizer::MergeThreadStats() {
+	std::lock_guard<std::mutex> lock(threadStatsMutex);
+
+	bool changed = false;
+	for (auto threadStat : threadStats) {
+		if (threadStat->count > 0) {
+			stat->Merge(*threadStat);
+			threadStat->Reset();
+			changed = true;
+		}
+	}
+
+	if (changed)
+		UpdateCache();
+}
+
+void GGL::ObsStandardizer::UpdateCache() {
+	auto& statMean = stat->GetMean();
+	auto statSTD = stat->GetSTD();
+
+	mean.resize(stat->width);
+	invSTD.resize(stat->width);
+	for (int i = 0; i < stat->width; i++) {
+		mean[i] = RS_CLAMP(statMean[i], -maxMeanRange, maxMeanRange);
+		invSTD[i] = 1 / RS_MAX((float)statSTD[i], minSTD);
+	}
+}
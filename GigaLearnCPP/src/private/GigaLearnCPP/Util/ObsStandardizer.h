@@ -0,0 +1,39 @@
+#pragma once
+#include "WelfordStat.h"
+#include <mutex>
+
+namespace GGL {
+	// Standardizes obs from within the env worker threads, right after they are built
+	// Each thread accumulates its own stats, which are merged into the main stats between iterations
+	struct ObsStandardizer {
+		BatchedWelfordStat* stat;
+		float minSTD, maxMeanRange;
+
+		// Cached from the main stats whenever they change
+		std::vector<float> mean, invSTD;
+
+		ObsStandardizer(BatchedWelfordStat* stat, float minSTD, float maxMeanRange);
+		RG_NO_COPY(ObsStandardizer);
+		~ObsStandardizer();
+
+		// Adds the obs to this thread's stats, then standardizes it in-place
+		// Safe to call from any thread, as long as MergeThreadStats() isn't running
+		void ProcessObs(float* obs);
+
+		// Standardizes the obs in-place without updating any stats
+		void StandardizeObs(float* obs) const;
+
+		// Merges all thread-local stats into the main stats and updates the cached mean/STD
+		// Must not be called while other threads are processing obs
+		void MergeThreadStats();
+
+		void UpdateCache();
+
+	private:
+		uint64_t id;
+		std::mutex threadStatsMutex = {};
+		std::vector<BatchedWelfordStat*> threadStats = {};
+
+		BatchedWelfordStat* GetThreadStat();
+	};
+}
@@ -79,6 +79,23 @@ namespace GGL {
 			count++;
 		}
 
+		// Combines the stats of another set of samples into these (Chan et al.'s parallel algorithm)
+		void Merge(const BatchedWelfordStat& other) {
+			RG_ASSERT(other.width == width);
+			if (other.count == 0)
+				return;
+
+			int64_t totalCount = count + other.count;
+			double otherRatio = (double)other.count / totalCount;
+			double countProduct = (double)count * other.count / totalCount;
+			for (int i = 0; i < width; i++) {
+				double delta = other.runningMeans[i] - runningMeans[i];
+				runningMeans[i] += delta * otherRatio;
+				runningVariances[i] += other.runningVariances[i] + delta * delta * countProduct;
+			}
+			count = totalCount;
+		}
+
 		void Reset() {
 			*this = BatchedWelfordStat(width);
 		}
@@ -112,8 +129,8 @@ namespace GGL {
 		}
 
 		void ReadFromJSON(const nlohmann::json& json) {
-			runningMeans = Utils::MakeVecFromJSON<double>(json["mean"]);
-			runningVariances = Utils::MakeVecFromJSON<double>(json["var"]);
+			runningMeans = Utils::MakeVecFromJSON<double>(json["means"]);
+			runningVariances = Utils::MakeVecFromJSON<double>(json["vars"]);
 			count = json["count"];
 		}
 	};
@@ -16,7 +16,10 @@ using RLGC::IList;
 #define RG_IMPORTED
 #endif
 
-#ifdef WITHIN_GGL
+#if defined(GGL_STATIC)
+// Compiled straight into the user's binary (e.g. GGLPolicyRuntime), so nothing crosses a DLL boundary
+#define RG_IMEXPORT
+#elif defined(WITHIN_GGL)
 #define RG_IMEXPORT RG_EXPORTED
 #else
 #define RG_IMEXPORT RG_IMPORTED
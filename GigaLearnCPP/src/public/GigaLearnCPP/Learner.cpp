@@ -5,7 +5,10 @@
 
 #include <torch/cuda.h>
 #include <nlohmann/json.hpp>
+#ifdef RG_PYTHON_SUPPORT
 #include <pybind11/embed.h>
+#include <GigaLearnCPP/Util/MetricSender.h>
+#endif
 
 #ifdef RG_CUDA_SUPPORT
 #include <c10/cuda/CUDACachingAllocator.h>
@@ -13,17 +16,33 @@
 #include <private/GigaLearnCPP/PPO/ExperienceBuffer.h>
 #include <private/GigaLearnCPP/PPO/GAE.h>
 #include <private/GigaLearnCPP/PolicyVersionManager.h>
+#include <private/GigaLearnCPP/Util/CheckpointWriter.h>
 
 #include "Util/KeyPressDetector.h"
 #include <private/GigaLearnCPP/Util/WelfordStat.h>
+#include <private/GigaLearnCPP/Util/ObsStandardizer.h>
 #include "Util/AvgTracker.h"
+#include "Util/PolicyFile.h"
+#include <RLGymCPP/Profiler.h>
+#include <RLGymCPP/AllocTracker.h>
 
 using namespace RLGC;
 
+#ifdef RG_PYTHON_SUPPORT
+namespace {
+	// The main thread gives up the GIL after starting the interpreter, so the metrics thread can call into Python too
+	// Anything that uses Python has to acquire the GIL itself
+	PyThreadState* g_PyMainThreadState = NULL;
+}
+#endif
+
 GGL::Learner::Learner(EnvCreateFn envCreateFn, LearnerConfig config, StepCallbackFn stepCallback) :
 	envCreateFn(envCreateFn), config(config), stepCallback(stepCallback)
 {
+#ifdef RG_PYTHON_SUPPORT
 	pybind11::initialize_interpreter();
+	g_PyMainThreadState = PyEval_SaveThread();
+#endif
 
 #ifndef NDEBUG
 	RG_LOG("===========================");
@@ -87,9 +106,19 @@ GGL::Learner::Learner(EnvCreateFn envCreateFn, LearnerConfig config, StepCallbac
 		envSetConfig.tickSkip = config.tickSkip;
 		envSetConfig.actionDelay = config.actionDelay;
 		envSetConfig.saveRewards = config.addRewardsToMetrics;
+
+		// Arenas (and whatever the env create function makes) can't be measured directly, so count what the process grew by
+		uint64_t memBeforeEnvs = MemoryAccounting::GetProcessBytes();
 		envSet = new RLGC::EnvSet(envSetConfig);
+		int64_t envsBytes = (int64_t)MemoryAccounting::GetProcessBytes() - (int64_t)memBeforeEnvs;
+		memAccounting.Set(MemoryAccounting::ARENAS, RS_MAX(envsBytes - (int64_t)envSet->state.GetMemoryBytes(), 0));
+
 		obsSize = envSet->state.obs.size[1];
 		numActions = envSet->actionParsers[0]->GetActionAmount();
+
+		// Better to find out now than at the first save
+		if (config.exportPolicyOnSave && envSet->actionParsers[0]->GetActionTable().empty())
+			RG_ERR_CLOSE("config.exportPolicyOnSave is set, but the action parser doesn't provide an action table (see ActionParser::GetActionTable())");
 	}
 
 	{
@@ -114,7 +143,7 @@ GGL::Learner::Learner(EnvCreateFn envCreateFn, LearnerConfig config, StepCallbac
 	}
 
 	if (config.renderMode) {
-		renderSender = new RenderSender(config.renderTimeScale);
+		renderSender = new RenderSender(config.renderTimeScale, config.renderFormat, config.renderAddress, config.renderPort, config.renderSendRate);
 	} else {
 		renderSender = NULL;
 	}
@@ -127,12 +156,15 @@ GGL::Learner::Learner(EnvCreateFn envCreateFn, LearnerConfig config, StepCallbac
 			RG_ERR_CLOSE("Cannot save/load old policy versions with no checkpoint save folder");
 		versionMgr = new PolicyVersionManager(
 			config.checkpointFolder / "policy_versions", config.maxOldVersions, config.tsPerVersion,
+			config.versionStorageType, config.maxLoadedVersions,
 			config.skillTracker, envSet->config
 		);
 	} else {
 		versionMgr = NULL;
 	}
 
+	checkpointWriter = new CheckpointWriter();
+
 	if (!config.checkpointFolder.empty())
 		Load();
 
@@ -143,32 +175,68 @@ GGL::Learner::Learner(EnvCreateFn envCreateFn, LearnerConfig config, StepCallbac
 		versionMgr->LoadVersions(models, totalTimesteps);
 	}
 
-	if (config.sendMetrics && !config.renderMode) {
-		if (!runID.empty())
-			RG_LOG("\tRun ID: " << runID);
-		metricSender = new MetricSender(config.metricsProjectName, config.metricsGroupName, config.metricsRunName, runID);
+	if (obsStat) {
+		// Obs are standardized by the env threads as they are built
+		// In render mode, we use the loaded stats without updating them
+		bool updateStats = !config.renderMode;
+		obsStandardizer = new ObsStandardizer(obsStat, config.minObsSTD, config.maxObsMeanRange);
+		envSet->obsPostProcessFn = [this, updateStats](float* obs, int obsSize) {
+			if (updateStats) {
+				obsStandardizer->ProcessObs(obs);
+			} else {
+				obsStandardizer->StandardizeObs(obs);
+			}
+		};
+
+		// The initial obs were built before we could standardize them
+		for (int i = 0; i < envSet->state.numPlayers; i++)
+			envSet->obsPostProcessFn(&envSet->state.obs.At(i, 0), obsSize);
 	} else {
-		metricSender = NULL;
+		obsStandardizer = NULL;
+	}
+
+	metricsPipeline = new MetricsPipeline();
+	if (!config.renderMode) {
+		if (config.sendMetrics) {
+#ifdef RG_PYTHON_SUPPORT
+			if (!runID.empty())
+				RG_LOG("\tRun ID: " << runID);
+			MetricSender* metricSender = new MetricSender(config.metricsProjectName, config.metricsGroupName, config.metricsRunName, runID);
+			runID = metricSender->curRunID;
+			metricsPipeline->AddBackend(metricSender);
+#else
+			RG_LOG("\tWARNING: GigaLearnCPP was built without Python support (GGL_PYTHON_SUPPORT), so metrics will not be sent to wandb");
+#endif
+		}
+
+		if (!config.metricsCSVPath.empty())
+			metricsPipeline->AddBackend(new CSVMetricsBackend(config.metricsCSVPath));
+		if (!config.metricsSocketPath.empty())
+			metricsPipeline->AddBackend(new SocketMetricsBackend(config.metricsSocketPath));
 	}
 
 	RG_LOG(RG_DIVIDER);
 }
 
 void GGL::Learner::SaveStats(std::filesystem::path path) {
-	using namespace nlohmann;
-
 	constexpr const char* ERROR_PREFIX = "Learner::SaveStats(): ";
 
 	std::ofstream fOut(path);
 	if (!fOut.good())
 		RG_ERR_CLOSE(ERROR_PREFIX << "Can't open file at " << path);
 
+	fOut << GetStatsJSON();
+}
+
+std::string GGL::Learner::GetStatsJSON() {
+	using namespace nlohmann;
+
 	json j = {};
 	j["total_timesteps"] = totalTimesteps;
 	j["total_iterations"] = totalIterations;
 
-	if (config.sendMetrics)
-		j["run_id"] = metricSender->curRunID;
+	if (!runID.empty())
+		j["run_id"] = runID;
 
 	if (returnStat)
 		j["return_stat"] = returnStat->ToJSON();
@@ -178,21 +246,25 @@ void GGL::Learner::SaveStats(std::filesystem::path path) {
 	if (versionMgr)
 		versionMgr->AddRunningStatsToJSON(j);
 
-	std::string jStr = j.dump(4);
-	fOut << jStr;
+	return j.dump(4);
 }
 
 void GGL::Learner::LoadStats(std::filesystem::path path) {
 	// TODO: Repetitive code, merge repeated code into one function called from both SaveStats() and LoadStats()
 
-	using namespace nlohmann;
 	constexpr const char* ERROR_PREFIX = "Learner::LoadStats(): ";
 
 	std::ifstream fIn(path);
 	if (!fIn.good())
 		RG_ERR_CLOSE(ERROR_PREFIX << "Can't open file at " << path);
 
-	json j = json::parse(fIn);
+	LoadStatsFromJSON(std::string(std::istreambuf_iterator<char>(fIn), {}));
+}
+
+void GGL::Learner::LoadStatsFromJSON(const std::string& jsonStr) {
+	using namespace nlohmann;
+
+	json j = json::parse(jsonStr);
 	totalTimesteps = j["total_timesteps"];
 	totalIterations = j["total_iterations"];
 
@@ -210,40 +282,112 @@ void GGL::Learner::LoadStats(std::filesystem::path path) {
 
 // Different than RLGym-PPO to show that they are not compatible
 constexpr const char* STATS_FILE_NAME = "RUNNING_STATS.json";
+constexpr const char* POLICY_FILE_NAME = "POLICY.gglp";
+
+// Copies everything the policy export needs, so the returned function can write it later (e.g. from another thread)
+static std::function<void(std::filesystem::path)> MakeExportPolicyFn(GGL::Learner* learner) {
+	using namespace GGL;
+
+	Model* sharedHeadModel = learner->ppo->models["shared_head"];
+	std::shared_ptr<MLPEngine> sharedHead = {};
+	if (sharedHeadModel)
+		sharedHead.reset(sharedHeadModel->MakeMLPEngine());
+	std::shared_ptr<MLPEngine> policy = std::shared_ptr<MLPEngine>(learner->ppo->models["policy"]->MakeMLPEngine());
+
+	std::vector<float> obsMean = {}, obsInvSTD = {};
+	if (learner->obsStandardizer) {
+		obsMean = learner->obsStandardizer->mean;
+		obsInvSTD = learner->obsStandardizer->invSTD;
+	}
+
+	std::vector<Action> actions = learner->envSet->actionParsers[0]->GetActionTable();
+	if (actions.empty())
+		RG_ERR_CLOSE(
+			"Cannot export the policy, the action parser doesn't provide an action table.\n" <<
+			"Implement ActionParser::GetActionTable() if your actions never depend on the player or state."
+		);
+	if (actions.size() != learner->numActions)
+		RG_ERR_CLOSE("Cannot export the policy, the action parser's action table has " << actions.size() << " actions, expected " << learner->numActions);
+
+	return [=](std::filesystem::path path) {
+		PolicyFile::Write(path, sharedHead.get(), *policy, obsMean, obsInvSTD, actions);
+	};
+}
+
+void GGL::Learner::ExportPolicy(std::filesystem::path path) {
+	MakeExportPolicyFn(this)(path);
+}
 
 void GGL::Learner::Save() {
 	if (config.checkpointFolder.empty())
 		RG_ERR_CLOSE("Learner::Save(): Cannot save because config.checkpointSaveFolder is not set");
 
 	std::filesystem::path saveFolder = config.checkpointFolder / std::to_string(totalTimesteps);
-	std::filesystem::create_directories(saveFolder);
-
-	RG_LOG("Saving to folder " << saveFolder << "...");
-	SaveStats(saveFolder / STATS_FILE_NAME);
-	ppo->SaveTo(saveFolder);
-
-	// Remove old checkpoints
-	if (config.checkpointsToKeep != -1) {
-		std::set<int64_t> allSavedTimesteps = Utils::FindNumberedDirs(config.checkpointFolder);
-		while (allSavedTimesteps.size() > config.checkpointsToKeep) {
-			int64_t lowestCheckpointTS = INT64_MAX;
-			for (int64_t savedTimesteps : allSavedTimesteps)
-				lowestCheckpointTS = RS_MIN(lowestCheckpointTS, savedTimesteps);
-
-			std::filesystem::path removePath = config.checkpointFolder / std::to_string(lowestCheckpointTS);
-			try {
-				std::filesystem::remove_all(removePath);
-			} catch (std::exception& e) {
-				RG_ERR_CLOSE("Failed to remove old checkpoint from " << removePath << ", exception: " << e.what());
+	RG_LOG("Saving to folder " << saveFolder << (config.asyncSave ? " in the background..." : "..."));
+
+	// Copy everything into memory first, so training can continue while the checkpoint is written
+	std::string statsJSON = GetStatsJSON();
+	std::vector<ModelSnapshot> modelSnapshots = ppo->models.MakeSnapshots();
+	std::function<void(std::filesystem::path)> fnExportPolicy = NULL;
+	if (config.exportPolicyOnSave)
+		fnExportPolicy = MakeExportPolicyFn(this);
+	std::function<void()> fnSaveVersions = NULL;
+	if (versionMgr)
+		fnSaveVersions = versionMgr->MakeSaveVersionsFn();
+
+	auto fnWrite = [=, singleFile = config.singleFileCheckpoints](std::filesystem::path folder) {
+		if (singleFile) {
+			// The stats are stored under the same name as their legacy file
+			CheckpointFileWriter writer = {};
+			writer.AddBytes(STATS_FILE_NAME, statsJSON);
+			for (auto& snapshot : modelSnapshots)
+				snapshot.AddTo(writer);
+			writer.Write(folder / CheckpointFile::FILE_NAME);
+		} else {
+			{
+				std::ofstream fOut(folder / STATS_FILE_NAME);
+				fOut << statsJSON;
+				if (!fOut.good())
+					RG_ERR_CLOSE("Learner::Save(): Failed to write to " << (folder / STATS_FILE_NAME));
 			}
-			allSavedTimesteps.erase(lowestCheckpointTS);
+
+			for (auto& snapshot : modelSnapshots)
+				snapshot.Write(folder);
 		}
-	}
 
-	if (versionMgr)
-		versionMgr->SaveVersions();
+		if (fnExportPolicy)
+			fnExportPolicy(folder / POLICY_FILE_NAME);
+	};
+
+	auto fnFinish = [=, checkpointFolder = config.checkpointFolder, checkpointsToKeep = config.checkpointsToKeep] {
+		// Remove old checkpoints
+		if (checkpointsToKeep != -1) {
+			std::set<int64_t> allSavedTimesteps = Utils::FindNumberedDirs(checkpointFolder);
+			while (allSavedTimesteps.size() > checkpointsToKeep) {
+				int64_t lowestCheckpointTS = INT64_MAX;
+				for (int64_t savedTimesteps : allSavedTimesteps)
+					lowestCheckpointTS = RS_MIN(lowestCheckpointTS, savedTimesteps);
+
+				std::filesystem::path removePath = checkpointFolder / std::to_string(lowestCheckpointTS);
+				try {
+					std::filesystem::remove_all(removePath);
+				} catch (std::exception& e) {
+					RG_ERR_CLOSE("Failed to remove old checkpoint from " << removePath << ", exception: " << e.what());
+				}
+				allSavedTimesteps.erase(lowestCheckpointTS);
+			}
+		}
+
+		if (fnSaveVersions)
+			fnSaveVersions();
+	};
 
-	RG_LOG(" > Done.");
+	float waitTime = checkpointWriter->Start(saveFolder, fnWrite, fnFinish, config.asyncSave);
+	if (waitTime > 0.01f)
+		RG_LOG(" > Waited " << waitTime << "s for the previous checkpoint to finish writing");
+
+	if (!config.asyncSave)
+		RG_LOG(" > Done.");
 }
 
 void GGL::Learner::Load() {
@@ -260,8 +404,18 @@ void GGL::Learner::Load() {
 	if (highest != -1) {
 		std::filesystem::path loadFolder = config.checkpointFolder / std::to_string(highest);
 		RG_LOG(" > Loading checkpoint " << loadFolder << "...");
-		LoadStats(loadFolder / STATS_FILE_NAME);
-		ppo->LoadFrom(loadFolder);
+		std::filesystem::path checkpointPath = loadFolder / CheckpointFile::FILE_NAME;
+		if (std::filesystem::exists(checkpointPath)) {
+			CheckpointFileReader reader = CheckpointFileReader(checkpointPath);
+			std::string statsJSON = reader.GetString(STATS_FILE_NAME);
+			if (statsJSON.empty())
+				RG_ERR_CLOSE("Learner::Load(): Checkpoint " << checkpointPath << " has no running stats");
+			LoadStatsFromJSON(statsJSON);
+			ppo->LoadFrom(reader);
+		} else {
+			LoadStats(loadFolder / STATS_FILE_NAME);
+			ppo->LoadFrom(loadFolder);
+		}
 		RG_LOG(" > Done.");
 	} else {
 		RG_LOG(" > No checkpoints found, starting new model.")
@@ -331,11 +485,34 @@ void GGL::Learner::StartTransferLearn(const TransferLearnConfig& tlConfig) {
 		oldModels.Load(tlConfig.oldModelsPath, false, false);
 	}
 
+	// When collection overlaps with learning, collection uses this snapshot of the policy from the previous update
+	ModelSet collectionModels = {};
+	if (tlConfig.overlapCollection) {
+		RG_NO_GRAD;
+		collectionModels = ppo->GetPolicyModels().CloneAll();
+	}
+
+	// Learning from the previous iteration's batch, which may still be running
+	std::thread learnThread;
+	Report learnReport = {};
+
+	auto fnFinishLearn = [&](Report& report) {
+		if (learnThread.joinable())
+			learnThread.join();
+
+		for (auto& pair : learnReport.data)
+			report[pair.first] = pair.second;
+		learnReport = {};
+	};
+
 	try {
 		bool saveQueued;
 		std::thread keyPressThread;
 		StartQuitKeyThread(saveQueued, keyPressThread);
 
+		int numPlayers = envSet->state.numPlayers;
+		int maxSteps = tlConfig.batchSize + numPlayers;
+
 		while (true) {
 			Report report = {};
 
@@ -345,46 +522,71 @@ void GGL::Learner::StartTransferLearn(const TransferLearnConfig& tlConfig) {
 			std::vector<uint8_t> allNewActionMasks = {};
 			std::vector<uint8_t> allOldActionMasks = {};
 			std::vector<int> allActionMaps = {};
+			allNewObs.reserve((size_t)maxSteps * obsSize);
+			allOldObs.reserve((size_t)maxSteps * oldObsSize);
+			allNewActionMasks.reserve((size_t)maxSteps * numActions);
+			allOldActionMasks.reserve((size_t)maxSteps * oldNumActions);
+			if (tlConfig.mapActsFn)
+				allActionMaps.reserve((size_t)maxSteps * numActions);
+
 			int stepsCollected;
+			Timer collectionTimer = {};
 			{
 				RG_NO_GRAD;
-				for (stepsCollected = 0; stepsCollected < tlConfig.batchSize; stepsCollected += envSet->state.numPlayers) {
+				for (stepsCollected = 0; stepsCollected < tlConfig.batchSize; stepsCollected += numPlayers) {
 					
 					auto terminals = envSet->state.terminals; // Backup
 					envSet->Reset();
-					for (int i = 0; i < envSet->arenas.size(); i++) // Manually reset old obs builders
-						if (terminals[i])
-							oldObsBuilders[i]->Reset(envSet->state.gameStates[i]);
 
 					torch::Tensor tActions, tLogProbs;
 					torch::Tensor tStates = DIMLIST2_TO_TENSOR<float>(envSet->state.obs);
 					torch::Tensor tActionMasks = DIMLIST2_TO_TENSOR<uint8_t>(envSet->state.actionMasks);
 
-					envSet->StepFirstHalf(true);
-
 					allNewObs += envSet->state.obs.data;
 					allNewActionMasks += envSet->state.actionMasks.data;
 
-					// Run all old obs and old action parser on each player
-					// TODO: Could be multithreaded
-					for (int arenaIdx = 0; arenaIdx < envSet->arenas.size(); arenaIdx++) {
+					// Run all old obs builders and old action parsers on each player, before the arenas step
+					size_t oldObsStart = allOldObs.size();
+					size_t oldActionMasksStart = allOldActionMasks.size();
+					size_t actionMapsStart = allActionMaps.size();
+					allOldObs.resize(oldObsStart + (size_t)numPlayers * oldObsSize);
+					allOldActionMasks.resize(oldActionMasksStart + (size_t)numPlayers * oldNumActions);
+					if (tlConfig.mapActsFn)
+						allActionMaps.resize(actionMapsStart + (size_t)numPlayers * numActions);
+
+					auto fnBuildOldObs = [&](int arenaIdx) {
 						auto& gs = envSet->state.gameStates[arenaIdx];
-						for (auto& player : gs.players) {
-							allOldObs += oldObsBuilders[arenaIdx]->BuildObs(player, gs);
-							allOldActionMasks += oldActionParsers[arenaIdx]->GetActionMask(player, gs);
+						if (terminals[arenaIdx]) // Manually reset old obs builders
+							oldObsBuilders[arenaIdx]->Reset(gs);
+
+						int playerStartIdx = envSet->state.arenaPlayerStartIdx[arenaIdx];
+						for (int i = 0; i < gs.players.size(); i++) {
+							auto& player = gs.players[i];
+							size_t playerIdx = playerStartIdx + i;
+
+							FList oldObs = oldObsBuilders[arenaIdx]->BuildObs(player, gs);
+							if (oldObs.size() != oldObsSize)
+								RG_ERR_CLOSE("StartTransferLearn: Old obs builder produced obs of inconsistent size (" << oldObs.size() << "/" << oldObsSize << ")");
+							std::copy(oldObs.begin(), oldObs.end(), allOldObs.begin() + oldObsStart + playerIdx * oldObsSize);
+
+							auto oldActionMask = oldActionParsers[arenaIdx]->GetActionMask(player, gs);
+							std::copy(oldActionMask.begin(), oldActionMask.end(), allOldActionMasks.begin() + oldActionMasksStart + playerIdx * oldNumActions);
 
 							if (tlConfig.mapActsFn) {
 								auto curMap = tlConfig.mapActsFn(player, gs);
 								if (curMap.size() != numActions)
 									RG_ERR_CLOSE("StartTransferLearn: Your action map must have the same size as the new action parser's actions");
-								allActionMaps += curMap;
+								std::copy(curMap.begin(), curMap.end(), allActionMaps.begin() + actionMapsStart + playerIdx * numActions);
 							}
 						}
-					}
+					};
+					envSet->GetThreadPool().StartBatchedJobs(fnBuildOldObs, envSet->arenas.size(), false);
+
+					envSet->StepFirstHalf(true);
 
 					ppo->InferActions(
 						tStates.to(ppo->device, true), tActionMasks.to(ppo->device, true), 
-						&tActions, &tLogProbs
+						&tActions, &tLogProbs, tlConfig.overlapCollection ? &collectionModels : NULL
 					);
 
 					auto curActions = TENSOR_TO_VEC<int>(tActions);
@@ -396,6 +598,12 @@ void GGL::Learner::StartTransferLearn(const TransferLearnConfig& tlConfig) {
 						stepCallback(this, envSet->state.gameStates, report);
 				}
 			}
+			report["Collection Time"] = collectionTimer.Elapsed();
+
+			// The new obs were standardized by the env threads, so their stats need merging just like in Start()
+			// The env threads are idle now, and the learn thread never touches the obs stats
+			if (obsStandardizer)
+				obsStandardizer->MergeThreadStats();
 
 			uint64_t prevTimesteps = totalTimesteps;
 			totalTimesteps += stepsCollected;
@@ -404,39 +612,72 @@ void GGL::Learner::StartTransferLearn(const TransferLearnConfig& tlConfig) {
 			totalIterations++;
 			report["Total Iterations"] = totalIterations;
 
-			// Make tensors
-			torch::Tensor tNewObs = torch::tensor(allNewObs).reshape({ -1, obsSize }).to(ppo->device);
-			torch::Tensor tOldObs = torch::tensor(allOldObs).reshape({ -1, oldObsSize }).to(ppo->device);
-			torch::Tensor tNewActionMasks = torch::tensor(allNewActionMasks).reshape({ -1, numActions }).to(ppo->device);
-			torch::Tensor tOldActionMasks = torch::tensor(allOldActionMasks).reshape({ -1, oldNumActions }).to(ppo->device);
+			// Make tensors, these are sent to the device one minibatch at a time
+			torch::Tensor tNewObs = torch::tensor(allNewObs).reshape({ -1, obsSize });
+			torch::Tensor tOldObs = torch::tensor(allOldObs).reshape({ -1, oldObsSize });
+			torch::Tensor tNewActionMasks = torch::tensor(allNewActionMasks).reshape({ -1, numActions });
+			torch::Tensor tOldActionMasks = torch::tensor(allOldActionMasks).reshape({ -1, oldNumActions });
 
 			torch::Tensor tActionMaps = {};
 			if (!allActionMaps.empty())
-				tActionMaps = torch::tensor(allActionMaps).reshape({ -1, numActions }).to(ppo->device);
+				tActionMaps = torch::tensor(allActionMaps).reshape({ -1, numActions });
 
-			// Transfer learn
-			ppo->TransferLearn(oldModels, tNewObs, tOldObs, tNewActionMasks, tOldActionMasks, tActionMaps, report, tlConfig);
+			auto fnLearn = [=, &oldModels, &learnReport, &tlConfig, this]() {
+				Timer learnTimer = {};
+				ppo->TransferLearn(oldModels, tNewObs, tOldObs, tNewActionMasks, tOldActionMasks, tActionMaps, learnReport, tlConfig);
+				learnReport["Transfer Learn Time"] = learnTimer.Elapsed();
+			};
+
+			if (tlConfig.overlapCollection) {
+				// Wait for the previous batch's update, then start learning from this batch while the next one is collected
+				Timer waitTimer = {};
+				fnFinishLearn(report);
+				report["Transfer Learn Wait Time"] = waitTimer.Elapsed();
+
+				{
+					RG_NO_GRAD;
+					auto policyModels = ppo->GetPolicyModels();
+					for (Model* model : collectionModels) {
+						auto fromParams = policyModels[model->modelName]->parameters();
+						auto toParams = model->parameters();
+						for (int i = 0; i < toParams.size(); i++)
+							toParams[i].copy_(fromParams[i], true);
+						model->_seqHalfOutdated = true;
+					}
+				}
+			} else {
+				fnLearn();
+				fnFinishLearn(report);
+			}
 
 			if (versionMgr)
 				versionMgr->OnIteration(ppo, report, totalTimesteps, prevTimesteps);
 
 			if (saveQueued) {
-				if (!config.checkpointFolder.empty())
+				if (!config.checkpointFolder.empty()) {
 					Save();
+					checkpointWriter->Wait();
+				}
+				metricsPipeline->Flush();
 				exit(0);
 			}
 
 			if (!config.checkpointFolder.empty()) {
 				if (totalTimesteps / config.tsPerSave > prevTimesteps / config.tsPerSave) {
 					// Auto-save
+					Timer saveTimer = {};
 					Save();
+					report["Checkpoint Stall Time"] = saveTimer.Elapsed();
 				}
 			}
 
+			if (tlConfig.overlapCollection)
+				learnThread = std::thread(fnLearn);
+
 			report.Finish();
 
-			if (metricSender)
-				metricSender->Send(report);
+			if (metricsPipeline->HasBackends())
+				metricsPipeline->Send(report);
 
 			report.Display(
 				{
@@ -447,6 +688,11 @@ void GGL::Learner::StartTransferLearn(const TransferLearnConfig& tlConfig) {
 					"Old Policy Entropy",
 					"Policy Update Magnitude",
 					"",
+					"Collection Time",
+					"Transfer Learn Time",
+					"Transfer Learn Wait Time",
+					"Checkpoint Stall Time",
+					"",
 					"Collected Timesteps",
 					"Total Timesteps",
 					"Total Iterations"
@@ -480,7 +726,7 @@ void GGL::Learner::Start() {
 		int numPlayers = envSet->state.numPlayers;
 
 		struct Trajectory {
-			FList states, nextStates, rewards, logProbs;
+			FList states, nextStates, rewards, logProbs, valPreds;
 			std::vector<uint8_t> actionMasks;
 			std::vector<int8_t> terminals;
 			std::vector<int32_t> actions;
@@ -494,6 +740,7 @@ void GGL::Learner::Start() {
 				nextStates += other.nextStates;
 				rewards += other.rewards;
 				logProbs += other.logProbs;
+				valPreds += other.valPreds;
 				actionMasks += other.actionMasks;
 				terminals += other.terminals;
 				actions += other.actions;
@@ -502,21 +749,48 @@ void GGL::Learner::Start() {
 			size_t Length() const {
 				return actions.size();
 			}
+
+			size_t GetMemoryBytes() const {
+				return
+					MemoryAccounting::GetVectorBytes(states) + MemoryAccounting::GetVectorBytes(nextStates)
+					+ MemoryAccounting::GetVectorBytes(rewards) + MemoryAccounting::GetVectorBytes(logProbs)
+					+ MemoryAccounting::GetVectorBytes(valPreds) + MemoryAccounting::GetVectorBytes(actionMasks)
+					+ MemoryAccounting::GetVectorBytes(terminals) + MemoryAccounting::GetVectorBytes(actions);
+			}
 		};
 
 		auto trajectories = std::vector<Trajectory>(numPlayers, Trajectory{});
 		int maxEpisodeLength = (int)(config.ppo.maxEpisodeDuration * (120.f / config.tickSkip));
 
+		RLGC::Profiler::SetThreadName("Learner");
+		int runIterations = 0;
+
 		while (true) {
+			if (config.profile) {
+				if (runIterations == config.profileStartIteration) {
+					RG_LOG("Profiling " << config.profileIterations << " iteration(s)...");
+					RLGC::Profiler::Start();
+				} else if (runIterations == config.profileStartIteration + config.profileIterations) {
+					RLGC::Profiler::Stop();
+					RLGC::Profiler::WriteTrace(config.profileTracePath);
+					RG_LOG("Wrote profiler trace to " << config.profileTracePath);
+				}
+			}
+			runIterations++;
+
+			RG_PROFILE_SCOPE("Learner::Iteration");
 			Report report = {};
 
 			bool isFirstIteration = (totalTimesteps == 0);
 
 			// TODO: Old version switching messes up the gameplay potentially
-			GGL::PolicyVersion* oldVersion = NULL;
-			std::vector<bool> oldVersionPlayerMask;
-			std::vector<int> newPlayerIndices = {}, oldPlayerIndices = {};
-			torch::Tensor tNewPlayerIndices, tOldPlayerIndices;
+			std::vector<GGL::PolicyVersion*> oldVersions = {};
+			std::vector<int> newPlayerIndices = {};
+
+			// Inference groups, the first is always our current policy
+			std::vector<ModelSet*> inferGroupModels = {};
+			std::vector<int> inferGroupSizes = {};
+			torch::Tensor tInferGroupOrder;
 
 			for (int i = 0; i < numPlayers; i++)
 				newPlayerIndices.push_back(i);
@@ -531,33 +805,51 @@ void GGL::Learner::Start() {
 				if (shouldTrainAgainstOld) {
 					// Set up training against old versions
 
-					int oldVersionIdx = RocketSim::Math::RandInt(0, versionMgr->versions.size());
-					oldVersion = &versionMgr->versions[oldVersionIdx];
+					// Pick distinct old versions at random
+					std::vector<int> versionIndices = {};
+					for (int i = 0; i < versionMgr->versions.size(); i++)
+						versionIndices.push_back(i);
+					// All of them need to be loaded at once
+					int numOldVersions = RS_CLAMP(config.maxOldVersionsPerIteration, 1, RS_MIN((int)versionIndices.size(), versionMgr->maxLoadedVersions));
+					for (int i = 0; i < numOldVersions; i++) {
+						std::swap(versionIndices[i], versionIndices[RocketSim::Math::RandInt(i, versionIndices.size())]);
+						oldVersions.push_back(&versionMgr->versions[versionIndices[i]]);
+					}
 
 					Team oldVersionTeam = Team(RocketSim::Math::RandInt(0, 2)); 
 					
+					// Each arena's old team is controlled by one of the old versions
+					std::vector<std::vector<int>> oldPlayerIndices(numOldVersions);
 					newPlayerIndices.clear();
-					oldVersionPlayerMask.resize(numPlayers);
 					int i = 0;
-					for (auto& state : envSet->state.gameStates) {
-						for (auto& player : state.players) {
+					for (int arenaIdx = 0; arenaIdx < envSet->state.gameStates.size(); arenaIdx++) {
+						for (auto& player : envSet->state.gameStates[arenaIdx].players) {
 							if (player.team == oldVersionTeam) {
-								oldVersionPlayerMask[i] = true;
-								oldPlayerIndices.push_back(i);
+								oldPlayerIndices[arenaIdx % numOldVersions].push_back(i);
 							} else {
-								oldVersionPlayerMask[i] = false;
 								newPlayerIndices.push_back(i);
 							}
 							i++;
 						}
 					}
 
-					tNewPlayerIndices = torch::tensor(newPlayerIndices);
-					tOldPlayerIndices = torch::tensor(oldPlayerIndices);
+					std::vector<int64_t> inferGroupOrder = {};
+					inferGroupModels.push_back(NULL);
+					inferGroupSizes.push_back(newPlayerIndices.size());
+					inferGroupOrder.insert(inferGroupOrder.end(), newPlayerIndices.begin(), newPlayerIndices.end());
+					for (int j = 0; j < numOldVersions; j++) {
+						inferGroupModels.push_back(&versionMgr->GetModels(*oldVersions[j]));
+						inferGroupSizes.push_back(oldPlayerIndices[j].size());
+						inferGroupOrder.insert(inferGroupOrder.end(), oldPlayerIndices[j].begin(), oldPlayerIndices[j].end());
+					}
+					tInferGroupOrder = torch::tensor(inferGroupOrder);
 				}
 			}
 
-			int numRealPlayers = oldVersion ? newPlayerIndices.size() : envSet->state.numPlayers;
+			int numRealPlayers = oldVersions.empty() ? envSet->state.numPlayers : newPlayerIndices.size();
+
+			// Whether critic values are recorded during collection
+			bool inferValues = config.ppo.inferValuesDuringCollection && !render;
 
 			int stepsCollected = 0;
 			{ // Generate experience
@@ -568,9 +860,11 @@ void GGL::Learner::Start() {
 				Timer collectionTimer = {};
 				{ // Collect timesteps
 					RG_NO_GRAD;
+					RG_PROFILE_SCOPE("Learner::Collection");
 
 					float inferTime = 0;
 					float envStepTime = 0;
+					auto allocsStartSnapshot = AllocTracker::GetSnapshot();
 
 					for (int step = 0; combinedTraj.Length() < config.ppo.tsPerItr || render; step++, stepsCollected += numRealPlayers) {
 						Timer stepTimer = {};
@@ -581,29 +875,7 @@ void GGL::Learner::Start() {
 							if (isnan(f) || isinf(f))
 								RG_ERR_CLOSE("Obs builder produced a NaN/inf value");
 
-						if (!render && obsStat) {
-							// TODO: This samples from old versions too
-							int numSamples = RS_MAX(envSet->state.numPlayers, config.maxObsSamples);
-							for (int i = 0; i < numSamples; i++) {
-								int idx = Math::RandInt(0, envSet->state.numPlayers);
-								obsStat->IncrementRow(&envSet->state.obs.At(idx, 0));
-							}
-
-							std::vector<double> mean = obsStat->GetMean();
-							std::vector<double> std = obsStat->GetSTD();
-							for (double& f : mean)
-								f = RS_CLAMP(f, -config.maxObsMeanRange, config.maxObsMeanRange);
-							for (double& f : std)
-								f = RS_MAX(f, config.minObsSTD);
-							for (int i = 0; i < envSet->state.numPlayers; i++) {
-								for (int j = 0; j < obsSize; j++) {
-									float& obsVal = envSet->state.obs.At(i, j);
-									obsVal = (obsVal - mean[j]) / std[j];
-								}
-							}
-						}
-
-						torch::Tensor tActions, tLogProbs;
+						torch::Tensor tActions, tLogProbs, tStepValPreds;
 						torch::Tensor tStates = DIMLIST2_TO_TENSOR<float>(envSet->state.obs);
 						torch::Tensor tActionMasks = DIMLIST2_TO_TENSOR<uint8_t>(envSet->state.actionMasks);
 
@@ -618,25 +890,16 @@ void GGL::Learner::Start() {
 
 						Timer inferTimer = {};
 
-						if (oldVersion) {
-							torch::Tensor tdNewStates = tStates.index_select(0, tNewPlayerIndices).to(ppo->device, true);
-							torch::Tensor tdOldStates = tStates.index_select(0, tOldPlayerIndices).to(ppo->device, true);
-							torch::Tensor tdNewActionMasks = tActionMasks.index_select(0, tNewPlayerIndices).to(ppo->device, true);
-							torch::Tensor tdOldActionMasks = tActionMasks.index_select(0, tOldPlayerIndices).to(ppo->device, true);
-
-							torch::Tensor tNewActions;
-							torch::Tensor tOldActions;
-
-							ppo->InferActions(tdNewStates, tdNewActionMasks, &tNewActions, &tLogProbs);
-							ppo->InferActions(tdOldStates, tdOldActionMasks, &tOldActions, NULL, &oldVersion->models);
-
-							tActions = torch::zeros(numPlayers, tNewActions.dtype());
-							tActions.index_copy_(0, tNewPlayerIndices, tNewActions.cpu());
-							tActions.index_copy_(0, tOldPlayerIndices, tOldActions.cpu());
+						if (!oldVersions.empty()) {
+							ppo->InferActionsGrouped(
+								tStates, tActionMasks, 
+								inferGroupModels, inferGroupSizes, tInferGroupOrder,
+								&tActions, &tLogProbs, inferValues ? &tStepValPreds : NULL
+							);
 						} else {
 							torch::Tensor tdStates = tStates.to(ppo->device, true);
 							torch::Tensor tdActionMasks = tActionMasks.to(ppo->device, true);
-							ppo->InferActions(tdStates, tdActionMasks, &tActions, &tLogProbs);
+							ppo->InferActions(tdStates, tdActionMasks, &tActions, &tLogProbs, NULL, inferValues ? &tStepValPreds : NULL);
 							tActions = tActions.cpu();
 						}
 						inferTime += inferTimer.Elapsed();
@@ -645,6 +908,9 @@ void GGL::Learner::Start() {
 						FList newLogProbs;
 						if (tLogProbs.defined() && !render)
 							newLogProbs = TENSOR_TO_VEC<float>(tLogProbs);	
+						FList newValPreds;
+						if (inferValues)
+							newValPreds = TENSOR_TO_VEC<float>(tStepValPreds);
 
 						stepTimer.Reset();
 						envSet->Sync(); // Make sure the first half is done
@@ -683,6 +949,8 @@ void GGL::Learner::Start() {
 							trajectories[newPlayerIdx].actions.push_back(curActions[newPlayerIdx]);
 							trajectories[newPlayerIdx].rewards += envSet->state.rewards[newPlayerIdx];
 							trajectories[newPlayerIdx].logProbs += newLogProbs[i];
+							if (inferValues)
+								trajectories[newPlayerIdx].valPreds += newValPreds[i];
 							i++;
 						}
 
@@ -724,12 +992,34 @@ void GGL::Learner::Start() {
 
 					report["Inference Time"] = inferTime;
 					report["Env Step Time"] = envStepTime;
+
+					if (AllocTracker::ENABLED && stepsCollected > 0) {
+						// Includes the collection loop's own allocations (inference, trajectories) under "Other"
+						auto allocs = AllocTracker::GetSnapshot() - allocsStartSnapshot;
+						double numArenaSteps = (double)(stepsCollected / numRealPlayers) * envSet->arenas.size();
+						report["Allocs/Total Per Arena Step"] = allocs.GetTotal().allocs / numArenaSteps;
+						report["Allocs/Total Bytes Per Arena Step"] = allocs.GetTotal().bytes / numArenaSteps;
+						for (int i = 0; i < AllocTracker::PHASE_AMOUNT; i++)
+							report[std::string("Allocs/") + AllocTracker::PHASE_NAMES[i] + " Per Arena Step"] = allocs.phases[i].allocs / numArenaSteps;
+					}
+
+					// Trajectories are at their largest here, right before they're turned into tensors
+					memAccounting.Set(MemoryAccounting::ENV_STATE, envSet->state.GetMemoryBytes());
+					size_t trajBytes = combinedTraj.GetMemoryBytes();
+					for (auto& traj : trajectories)
+						trajBytes += traj.GetMemoryBytes();
+					memAccounting.Set(MemoryAccounting::TRAJECTORIES, trajBytes);
 				}
 				float collectionTime = collectionTimer.Elapsed();
 
+				// The env threads are idle now, so we can combine their obs stats
+				if (obsStandardizer)
+					obsStandardizer->MergeThreadStats();
+
 				Timer consumptionTimer = {};
 				{ // Process timesteps
 					RG_NO_GRAD;
+					RG_PROFILE_SCOPE("Learner::Consumption");
 
 					// Make and transpose tensors
 					torch::Tensor tStates = torch::tensor(combinedTraj.states).reshape({ -1, obsSize });
@@ -750,7 +1040,12 @@ void GGL::Learner::Start() {
 					torch::Tensor tValPreds;
 					torch::Tensor tTruncValPreds;
 
-					if (ppo->device.is_cpu()) {
+					if (inferValues) {
+						// Values were already predicted during collection, we only need the truncated next states
+						tValPreds = torch::tensor(combinedTraj.valPreds);
+						if (tNextTruncStates.defined())
+							tTruncValPreds = ppo->InferCritic(tNextTruncStates.to(ppo->device, true, true)).cpu();
+					} else if (ppo->device.is_cpu()) {
 						// Predict values all at once
 						tValPreds = ppo->InferCritic(tStates.to(ppo->device, true, true)).cpu();
 						if (tNextTruncStates.defined())
@@ -804,6 +1099,16 @@ void GGL::Learner::Start() {
 					report["GAE/Avg Advantage"] = tAdvantages.abs().mean().item<float>();
 					report["GAE/Avg Val Target"] = tTargetVals.abs().mean().item<float>();
 
+					// Recalibrate int8 inference on what we just collected, and check how often it still picks the same actions
+					Model* sharedHead = ppo->models["shared_head"];
+					if (ppo->device.is_cpu() && (ppo->models["policy"]->config.int8Inference || (sharedHead && sharedHead->config.int8Inference))) {
+						constexpr int64_t INT8_CALIBRATION_SAMPLES = 4096;
+						auto sampleIndices = torch::randperm(tStates.size(0)).slice(0, 0, INT8_CALIBRATION_SAMPLES);
+						report["Int8 Action Agreement"] = PPOLearner::CalibrateInt8(
+							ppo->models, tStates.index_select(0, sampleIndices), tActionMasks.index_select(0, sampleIndices)
+						);
+					}
+
 					// Set experience buffer
 					experience.data.actions = tActions;
 					experience.data.logProbs = tLogProbs;
@@ -824,6 +1129,25 @@ void GGL::Learner::Start() {
 				ppo->Learn(experience, report, isFirstIteration);
 				report["PPO Learn Time"] = learnTimer.Elapsed();
 
+				{
+					MemoryUsage experienceUsage = {};
+					for (auto& tensor : experience.data)
+						experienceUsage += GetTensorUsage(tensor);
+					memAccounting.Set(MemoryAccounting::EXPERIENCE, experienceUsage);
+
+					MemoryUsage modelsUsage = ppo->models.GetMemoryUsage();
+					modelsUsage += ppo->guidingPolicyModels.GetMemoryUsage();
+					memAccounting.Set(MemoryAccounting::MODELS, modelsUsage);
+					memAccounting.Set(MemoryAccounting::OPTIMIZER, ppo->models.GetOptimMemoryUsage());
+#ifdef RG_CUDA_SUPPORT
+					// What the caching allocator held onto while learning, since the cache is emptied before each learn
+					if (ppo->device.is_cuda()) {
+						auto cudaStats = c10::cuda::CUDACachingAllocator::getDeviceStats(ppo->device.has_index() ? ppo->device.index() : 0);
+						memAccounting.SetDeviceReserved(cudaStats.reserved_bytes[0].current); // Aggregate over all pools
+					}
+#endif
+				}
+
 				// Set metrics
 				float consumptionTime = consumptionTimer.Elapsed();
 				report["Collection Time"] = collectionTime;
@@ -838,26 +1162,38 @@ void GGL::Learner::Start() {
 				totalIterations++;
 				report["Total Iterations"] = totalIterations;
 
-				if (versionMgr)
+				if (versionMgr) {
 					versionMgr->OnIteration(ppo, report, totalTimesteps, prevTimesteps);
+					memAccounting.Set(MemoryAccounting::VERSIONS, versionMgr->GetMemoryUsage());
+				}
 
 				if (saveQueued) {
-					if (!config.checkpointFolder.empty())
+					if (!config.checkpointFolder.empty()) {
 						Save();
+						checkpointWriter->Wait();
+					}
+					metricsPipeline->Flush();
 					exit(0);
 				}
 
 				if (!config.checkpointFolder.empty()) {
 					if (totalTimesteps / config.tsPerSave > prevTimesteps / config.tsPerSave) {
 						// Auto-save
+						RG_PROFILE_SCOPE("Learner::Save");
+						Timer saveTimer = {};
 						Save();
+						report["Checkpoint Stall Time"] = saveTimer.Elapsed();
 					}
 				}
 
+				memAccounting.AddToReport(report);
+
 				report.Finish();
 
-				if (metricSender)
-					metricSender->Send(report);
+				if (metricsPipeline->HasBackends()) {
+					RG_PROFILE_SCOPE("Learner::SendMetrics");
+					metricsPipeline->Send(report);
+				}
 
 				report.Display(
 					{
@@ -879,7 +1215,8 @@ void GGL::Learner::Start() {
 						"-Env Step Time",
 						"Consumption Time",
 						"-GAE Time",
-						"-PPO Learn Time"
+						"-PPO Learn Time",
+						"Checkpoint Stall Time",
 						"",
 						"Collected Timesteps",
 						"Total Timesteps",
@@ -895,9 +1232,14 @@ void GGL::Learner::Start() {
 }
 
 GGL::Learner::~Learner() {
+	delete checkpointWriter;
+	delete obsStandardizer;
 	delete ppo;
 	delete versionMgr;
-	delete metricSender;
+	delete metricsPipeline;
 	delete renderSender;
+#ifdef RG_PYTHON_SUPPORT
+	PyEval_RestoreThread(g_PyMainThreadState);
 	pybind11::finalize_interpreter();
+#endif
 }
\ No newline at end of file
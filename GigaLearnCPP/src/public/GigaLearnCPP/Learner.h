@@ -1,8 +1,9 @@
 #pragma once
 
 #include <RLGymCPP/EnvSet/EnvSet.h>
-#include "Util/MetricSender.h"
+#include "Util/MetricsPipeline.h"
 #include "Util/RenderSender.h"
+#include "Util/MemoryAccounting.h"
 #include "LearnerConfig.h"
 #include "PPO/TransferLearnConfig.h"
 
@@ -19,9 +20,10 @@ namespace GGL {
 
 		class PPOLearner* ppo;
 		class PolicyVersionManager* versionMgr;
+		class CheckpointWriter* checkpointWriter;
 
 		RLGC::EnvCreateFn envCreateFn;
-		MetricSender* metricSender;
+		MetricsPipeline* metricsPipeline;
 		RenderSender* renderSender;
 
 		int obsSize;
@@ -29,8 +31,11 @@ namespace GGL {
 
 		struct WelfordStat* returnStat;
 		struct BatchedWelfordStat* obsStat;
+		struct ObsStandardizer* obsStandardizer;
 
-		std::string runID = {};
+		std::string runID = {}; // Of the wandb run, kept in the running stats so it can be resumed
+
+		MemoryAccounting memAccounting = {};
 
 		uint64_t
 			totalTimesteps = 0,
@@ -45,10 +50,17 @@ namespace GGL {
 
 		void StartQuitKeyThread(bool& quitPressed, std::thread& outThread);
 
+		// Checkpoints are written in the background if config.asyncSave is set, see CheckpointWriter
 		void Save();
 		void Load();
 		void SaveStats(std::filesystem::path path);
+		std::string GetStatsJSON();
 		void LoadStats(std::filesystem::path path);
+		void LoadStatsFromJSON(const std::string& jsonStr);
+
+		// Exports the current policy, obs standardization and action table to one file that PolicyRuntime can run without libtorch
+		// The action table comes from ActionParser::GetActionTable(), closes with an error if the parser doesn't provide one
+		void ExportPolicy(std::filesystem::path path);
 
 		RG_NO_COPY(Learner);
 
@@ -10,6 +10,19 @@ namespace GGL {
 		GPU_CUDA
 	};
 
+	// How the weights of inactive policy versions are stored
+	enum class PolicyVersionStorageType {
+		FULL, // 32-bit floats, lossless
+		HALF, // 16-bit floats
+		INT8 // 8-bit ints with per-row scales (biases and 1D params are kept as 32-bit)
+	};
+
+	// What render mode sends to the render address
+	enum class RenderFormat {
+		ROCKETSIMVIS_JSON, // The JSON that RocketSimVis (https://github.com/ZealanL/RocketSimVis) reads
+		BINARY // Compact frames with delta encoding for custom viewers, see RenderFrame.h
+	};
+
 	// https://github.com/AechPro/rlgym-ppo/blob/main/rlgym_ppo/learner.py
 	struct LearnerConfig {
 		int numGames = 300;
@@ -22,6 +35,10 @@ namespace GGL {
 		// 1.0 = Run the game at real time
 		// 2.0 = Run the game twice as fast as real time
 		float renderTimeScale = 1.0f; 
+		RenderFormat renderFormat = RenderFormat::ROCKETSIMVIS_JSON;
+		std::string renderAddress = "127.0.0.1"; // IPv4 address to send frames to over UDP
+		int renderPort = 9273; // RocketSimVis's port
+		float renderSendRate = 60; // Max frames sent per second, the latest state is sent regardless of how fast the game runs
 
 		PPOLearnerConfig ppo = {};
 
@@ -36,13 +53,19 @@ namespace GGL {
 
 		int64_t randomSeed = -1; // Set to -1 to use the current time
 		int checkpointsToKeep = 8; // Checkpoint storage limit before old checkpoints are deleted, set to -1 to disable
+		bool exportPolicyOnSave = false; // Also export the policy to a self-contained file in each checkpoint (see Learner::ExportPolicy())
+		// Save each checkpoint as one memory-mappable file (see CheckpointFile) instead of a .lt file per model, either kind can be loaded
+		// Older builds and tools/checkpoint_converter.py only read the .lt files
+		bool singleFileCheckpoints = false;
+		bool asyncSave = true; // Write checkpoints on a background thread, so training only stalls while the state is copied into memory
 		LearnerDeviceType deviceType = LearnerDeviceType::AUTO; // Auto will use your CUDA GPU if available
 
 		// Standardize the obs values (doesn't seem to help much from my testing)
+		// Every obs is added to the stats, which are updated at the end of each iteration
 		bool standardizeObs = false;
 		float minObsSTD = 1 / 10.f;
 		float maxObsMeanRange = 3;
-		int maxObsSamples = 100;
+		int maxObsSamples = 100; // DEPRECATED: Ignored, every obs is added to the stats now
 
 		// Standardize the returns to help the critic (don't disable this unless you know what you're doing)
 		bool standardizeReturns = true;
@@ -53,20 +76,35 @@ namespace GGL {
 		int maxRewardSamples = 50; // Maximum reward samples per step for reward metrics
 		int rewardSampleRandInterval = 8; // Randomized interval range between sampling rewards (per step)
 
-		// Send metrics to the python metrics receiver
-		// The receiver can then log them to wandb or whatever
+		// Send metrics to wandb through the python metrics receiver (requires GGL_PYTHON_SUPPORT)
+		// Like every other metrics backend, this runs on the metrics thread and never stalls training
 		bool sendMetrics = true;
 		std::string metricsProjectName = "gigalearncpp"; // Project name for the python metrics receiver
 		std::string metricsGroupName = "unnamed-runs"; // Group name for the python metrics receiver
 		std::string metricsRunName = "gigalearncpp-run"; // Run name for the python metrics receiver
 
+		// Local metrics backends, see MetricsPipeline
+		std::filesystem::path metricsCSVPath = {}; // If set, every report is appended to this CSV file
+		std::filesystem::path metricsSocketPath = {}; // If set, reports are served to live dashboards on this Unix domain socket (not on Windows)
+
 		bool savePolicyVersions = false;
 		int64_t tsPerVersion = 25'000'000;
 		int maxOldVersions = 32;
+		PolicyVersionStorageType versionStorageType = PolicyVersionStorageType::HALF;
+		int maxLoadedVersions = 4; // Max number of old versions to keep fully loaded at once, others are only kept in compact form
 
 		bool trainAgainstOldVersions = false;
 		float trainAgainstOldChance = 0.15f; // Chance (from 0 - 1) that an iteration will train against an old version
+		int maxOldVersionsPerIteration = 1; // How many different old versions can be trained against at once (each arena gets one)
 
 		SkillTrackerConfig skillTracker = {};
+
+		// Record a Chrome trace of a window of iterations (open it in chrome://tracing or https://ui.perfetto.dev)
+		// Iterations are counted from when Start() is called, so the window is the same when resuming from a checkpoint
+		// GPU work is asynchronous, so GPU-heavy scopes may show up as time spent in whatever synchronizes next
+		bool profile = false;
+		int profileStartIteration = 5; // The first few iterations are slower while everything warms up
+		int profileIterations = 3;
+		std::filesystem::path profileTracePath = "profile_trace.json";
 	};
 }
\ No newline at end of file
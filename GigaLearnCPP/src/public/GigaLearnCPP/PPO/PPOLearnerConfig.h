@@ -30,6 +30,11 @@ namespace GGL {
 		// This is much faster on GPU, not so much for CPU
 		bool useHalfPrecision = false;
 
+		// Also run the critic during collection, reusing the policy's shared head output
+		// The values are stored with the rest of the experience, so only truncated next states need the critic afterwards
+		// This removes a full critic pass over the iteration's experience from the consumption phase
+		bool inferValuesDuringCollection = false;
+
 		PartialModelConfig policy, critic, sharedHead;
 
 		int epochs = 2;
@@ -44,6 +49,10 @@ namespace GGL {
 		bool maskEntropy = false; 
 
 		float clipRange = 0.2f;
+
+		// Stops the remaining epochs early once a batch's mean KL divergence exceeds this, set 0 to disable
+		// The batch that exceeded it is not applied
+		float targetKL = 0;
 		
 		// Temperature of the policy's softmax distribution
 		float policyTemperature = 1;
@@ -35,10 +35,19 @@ namespace GGL {
 
 		float lr = 3e-4;
 
-		// NOTE: There are no minibatches
 		int batchSize = 50'000;
 		int epochs = 5;
 
+		// Each epoch is still one update over the whole batch, but it is computed in minibatches of this size to limit memory usage
+		// Set to 0 to compute the whole batch at once
+		int miniBatchSize = 10'000;
+
+		// Collect the next batch while learning from the current one
+		// The policy used for collection will then be one update behind
+		bool overlapCollection = true;
+
+		// NOTE: The action map function (if set) is called from multiple threads at once, so it must be thread-safe
+
 		// Whether or not to use KL-Div (Kullback-Leibler divergence) as loss
 		//	Otherwise, (a-b).abs().mean() is used
 		bool useKLDiv = false;
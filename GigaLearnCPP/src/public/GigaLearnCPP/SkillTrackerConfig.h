@@ -10,6 +10,11 @@ namespace GGL {
 		// Don't put this much higher than your CPU thread count
 		int numArenas = 16;
 
+		// Number of threads dedicated to running skill matches in the background, against a snapshot of the current policy
+		// 0 runs skill matches on the main thread between iterations
+		// Background threads compete with collection, and keep snapshot copies of the current and old models
+		int numThreads = 0;
+
 		// Time (in seconds) to simulate each skill rating run, per arena
 		float simTime = 45;
 
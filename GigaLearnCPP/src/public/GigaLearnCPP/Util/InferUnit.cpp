@@ -2,6 +2,7 @@
 
 #include <GigaLearnCPP/Util/Models.h>
 #include <GigaLearnCPP/PPO/PPOLearner.h>
+#include <GigaLearnCPP/PPO/ActionSampler.h>
 
 GGL::InferUnit::InferUnit(
 	RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
@@ -27,6 +28,74 @@ GGL::InferUnit::InferUnit(
 	} catch (std::exception& e) {
 		RG_ERR_CLOSE("InferUnit: Exception when trying to load models: " << e.what());
 	}
+
+	if (!useGPU) {
+		if ((*models)["shared_head"])
+			sharedHeadEngine = (*models)["shared_head"]->MakeMLPEngine();
+		policyEngine = (*models)["policy"]->MakeMLPEngine();
+
+		if (policyConfig.int8Inference) {
+			if (sharedHeadEngine)
+				sharedHeadEngine->QuantizeInt8();
+			policyEngine->QuantizeInt8();
+		}
+
+		RG_LOG("InferUnit: Using " << MLPEngine::GetKernelName() << " kernels for " << (policyConfig.int8Inference ? "int8" : "float") << " CPU inference");
+	}
+}
+
+float GGL::InferUnit::CalibrateInt8(const std::vector<FList>& sampleObs) {
+	RG_ASSERT(!sampleObs.empty());
+	if (!policyEngine || !policyEngine->IsQuantized())
+		RG_ERR_CLOSE("InferUnit::CalibrateInt8(): Int8 inference is not enabled (requires CPU inference and policyConfig.int8Inference)");
+
+	std::vector<float> allObs;
+	for (auto& obs : sampleObs) {
+		if (obs.size() != obsSize)
+			RG_ERR_CLOSE("InferUnit::CalibrateInt8(): Sample obs has the wrong size (expected: " << obsSize << ", got: " << obs.size() << ")");
+		allObs += obs;
+	}
+	int numRows = sampleObs.size();
+
+	// Full-precision engines, both as the reference for agreement and to get the policy's calibration inputs
+	MLPEngine* fullSharedHead = sharedHeadEngine ? (*models)["shared_head"]->MakeMLPEngine() : NULL;
+	MLPEngine* fullPolicy = (*models)["policy"]->MakeMLPEngine();
+
+	const float* policyInput = allObs.data();
+	int policyInputStride = obsSize;
+	if (fullSharedHead) {
+		sharedHeadEngine->QuantizeInt8(allObs.data(), numRows);
+		policyInput = fullSharedHead->Forward(allObs.data(), numRows);
+		policyInputStride = fullSharedHead->GetOutputStride();
+	}
+	policyEngine->QuantizeInt8(policyInput, numRows, policyInputStride);
+
+	int numActions = policyEngine->GetNumOutputs();
+	auto fnArgmax = [numActions](const float* logits) {
+		return (int)(std::max_element(logits, logits + numActions) - logits);
+	};
+
+	std::vector<int> fullActions = std::vector<int>(numRows);
+	const float* fullLogits = fullPolicy->Forward(policyInput, numRows, policyInputStride);
+	for (int i = 0; i < numRows; i++)
+		fullActions[i] = fnArgmax(fullLogits + (size_t)i * fullPolicy->GetOutputStride());
+
+	if (sharedHeadEngine) {
+		policyInput = sharedHeadEngine->Forward(allObs.data(), numRows);
+		policyInputStride = sharedHeadEngine->GetOutputStride();
+	}
+	const float* int8Logits = policyEngine->Forward(policyInput, numRows, policyInputStride);
+
+	int numAgreed = 0;
+	for (int i = 0; i < numRows; i++)
+		numAgreed += fnArgmax(int8Logits + (size_t)i * policyEngine->GetOutputStride()) == fullActions[i];
+
+	delete fullSharedHead;
+	delete fullPolicy;
+
+	float agreement = (float)numAgreed / numRows;
+	RG_LOG("InferUnit: Calibrated int8 inference on " << numRows << " obs, " << (agreement * 100) << "% action agreement with full precision");
+	return agreement;
 }
 
 RLGC::Action GGL::InferUnit::InferAction(const RLGC::Player& player, const RLGC::GameState& state, bool deterministic, float temperature) {
@@ -56,6 +125,36 @@ std::vector<RLGC::Action> GGL::InferUnit::BatchInferActions(const std::vector<RL
 	
 	std::vector<RLGC::Action> results = {};
 
+	if (policyEngine) {
+		// The shared head's output is the policy's input, so each engine needs its own buffers
+		thread_local MLPEngine::Buffers sharedHeadBuffers = {}, policyBuffers = {};
+
+		const float* policyInput = allObs.data();
+		int policyInputStride = obsSize;
+		if (sharedHeadEngine) {
+			policyInput = sharedHeadEngine->Forward(allObs.data(), batchSize, 0, sharedHeadBuffers);
+			policyInputStride = sharedHeadEngine->GetOutputStride();
+		}
+		const float* logits = policyEngine->Forward(policyInput, batchSize, policyInputStride, policyBuffers);
+
+		uint64_t seed = 0;
+		if (!deterministic) {
+			auto& randEngine = RocketSim::Math::GetRandEngine();
+			seed = ((uint64_t)randEngine() << 32) ^ randEngine();
+		}
+
+		std::vector<int64_t> actionIndices = std::vector<int64_t>(batchSize);
+		ActionSampler::Sample(
+			logits, policyEngine->GetOutputStride(), allActionMasks.data(), actionParser->GetActionAmount(),
+			0, batchSize, temperature, deterministic, seed,
+			actionIndices.data(), NULL
+		);
+
+		for (int i = 0; i < batchSize; i++)
+			results.push_back(actionParser->ParseAction(actionIndices[i], players[i], states[i]));
+		return results;
+	}
+
 	try {
 		RG_NO_GRAD;
 
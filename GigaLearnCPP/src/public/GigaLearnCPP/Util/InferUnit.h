@@ -10,6 +10,12 @@ namespace GGL {
 		struct ModelSet* models;
 		bool useGPU;
 
+		// Without the GPU, inference runs on these torch-free engines instead of the models (the shared head engine is NULL if there is no shared head)
+		// If policyConfig.int8Inference is set, both engines use int8 weights
+		// Each thread runs them with its own activation buffers, so several bots can share one InferUnit
+		class MLPEngine* sharedHeadEngine = NULL;
+		class MLPEngine* policyEngine = NULL;
+
 		// NOTE: Reset() will never be called on your obs 
 		InferUnit(
 			RLGC::ObsBuilder* obsBuilder, int obsSize, RLGC::ActionParser* actionParser,
@@ -17,6 +23,11 @@ namespace GGL {
 			std::filesystem::path modelsFolder, bool useGPU);
 
 
+		// Calibrates the int8 engines on sample obs (e.g. recorded from real games), see PartialModelConfig::int8Inference
+		// Returns the fraction of the sample obs where the int8 engines pick the same most probable action as the full-precision engines
+		// NOTE: This requantizes the engines, so it must not run while other threads are inferring
+		float CalibrateInt8(const std::vector<FList>& sampleObs);
+
 		RLGC::Action InferAction(const RLGC::Player& player, const RLGC::GameState& state, bool deterministic, float temperature = 1);
 		std::vector<RLGC::Action> BatchInferActions(const std::vector<RLGC::Player>& players, const std::vector<RLGC::GameState>& states, bool deterministic, float temperature = 1);
 
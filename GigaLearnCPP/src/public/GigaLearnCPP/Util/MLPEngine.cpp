@@ -0,0 +1,348 @@
+#include "MLPEngine.h"
+
+#include <GigaLearnCPP/Util/MLPKernels.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Matches torch::nn::LayerNormOptions
+constexpr float LAYER_NORM_EPS = 1e-5f;
+
+// Matches torch::nn::LeakyReLUOptions
+constexpr float LEAKY_RELU_SLOPE = 0.01f;
+
+// Largest int8 magnitude used, symmetric so that negation can't overflow
+constexpr float INT8_MAX_VAL = 127;
+
+// When calibrating, this fraction of the largest-magnitude inputs to each layer get clipped
+constexpr float INT8_CALIBRATION_CLIP_FRAC = 1e-4f;
+
+namespace {
+	// Rounds to the nearest int (halves away from zero), inline unlike lrintf()
+	inline int RoundToInt(float val) {
+		return (int)(val + (val >= 0 ? 0.5f : -0.5f));
+	}
+
+	enum {
+		KERNEL_LEVEL_SCALAR,
+		KERNEL_LEVEL_AVX2,
+		KERNEL_LEVEL_AVX512,
+		KERNEL_LEVEL_AVX512_VNNI
+	};
+
+	int GetCPUKernelLevel() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int info[4];
+		__cpuid(info, 1);
+		bool hasFMA = info[2] & (1 << 12);
+		bool hasOSXSAVE = info[2] & (1 << 27);
+		if (!hasOSXSAVE)
+			return KERNEL_LEVEL_SCALAR;
+
+		// Make sure the OS saves the YMM (and ZMM) registers
+		uint64_t xcr0 = _xgetbv(0);
+		bool osHasAVX = (xcr0 & 0x6) == 0x6;
+		bool osHasAVX512 = (xcr0 & 0xE6) == 0xE6;
+
+		__cpuidex(info, 7, 0);
+		bool hasAVX2 = info[1] & (1 << 5);
+		bool hasAVX512F = info[1] & (1 << 16);
+		bool hasAVX512BW = info[1] & (1 << 30);
+		bool hasAVX512VNNI = info[2] & (1 << 11);
+
+		if (osHasAVX512 && hasAVX512F && hasAVX512BW && hasAVX2 && hasFMA)
+			return hasAVX512VNNI ? KERNEL_LEVEL_AVX512_VNNI : KERNEL_LEVEL_AVX512;
+		if (osHasAVX && hasAVX2 && hasFMA)
+			return KERNEL_LEVEL_AVX2;
+		return KERNEL_LEVEL_SCALAR;
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return __builtin_cpu_supports("avx512vnni") ? KERNEL_LEVEL_AVX512_VNNI : KERNEL_LEVEL_AVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+			return KERNEL_LEVEL_AVX2;
+		return KERNEL_LEVEL_SCALAR;
+#else
+		return KERNEL_LEVEL_SCALAR;
+#endif
+	}
+
+	std::atomic<int> g_MaxKernelLevel = KERNEL_LEVEL_AVX512_VNNI;
+	std::atomic<const GGL::MLPKernelSet*> g_Kernels = NULL;
+
+	const GGL::MLPKernelSet* GetKernels() {
+		const GGL::MLPKernelSet* kernels = g_Kernels;
+		if (kernels)
+			return kernels;
+
+		int cpuLevel = GetCPUKernelLevel();
+		int level = RS_MIN(cpuLevel, (int)g_MaxKernelLevel);
+		if (level >= KERNEL_LEVEL_AVX512_VNNI)
+			kernels = GGL::GetMLPKernelsAVX512VNNI();
+		if (level >= KERNEL_LEVEL_AVX512 && !kernels)
+			kernels = GGL::GetMLPKernelsAVX512();
+		if (level >= KERNEL_LEVEL_AVX2 && !kernels)
+			kernels = GGL::GetMLPKernelsAVX2();
+		if (!kernels)
+			kernels = GGL::GetMLPKernelsScalar();
+
+		g_Kernels = kernels;
+		return kernels;
+	}
+}
+
+void GGL::MLPEngine::AddLayer(
+	int numInputs, int numOutputs,
+	const float* weights, const float* biases,
+	const float* normWeights, const float* normBiases,
+	bool activate) {
+
+	RG_ASSERT(numInputs > 0 && numOutputs > 0);
+	if (!layers.empty() && layers.back().numOutputs != numInputs)
+		RG_ERR_CLOSE("MLPEngine::AddLayer(): Layer input size (" << numInputs << ") doesn't match the previous layer's output size (" << layers.back().numOutputs << ")");
+
+	Layer layer = {};
+	layer.numInputs = numInputs;
+	layer.numOutputs = numOutputs;
+	layer.paddedOutputs = ((numOutputs + MLP_OUTPUT_PAD - 1) / MLP_OUTPUT_PAD) * MLP_OUTPUT_PAD;
+	layer.activate = activate;
+
+	layer.weightsT.resize((size_t)numInputs * layer.paddedOutputs, 0);
+	for (int o = 0; o < numOutputs; o++)
+		for (int i = 0; i < numInputs; i++)
+			layer.weightsT[(size_t)i * layer.paddedOutputs + o] = weights[(size_t)o * numInputs + i];
+
+	layer.biases.resize(layer.paddedOutputs, 0);
+	std::copy(biases, biases + numOutputs, layer.biases.begin());
+
+	if (normWeights) {
+		RG_ASSERT(normBiases);
+		layer.normWeights.assign(normWeights, normWeights + numOutputs);
+		layer.normBiases.assign(normBiases, normBiases + numOutputs);
+	}
+
+	layers.push_back(std::move(layer));
+}
+
+void GGL::MLPEngine::Reserve(int maxRows) {
+	_Reserve(_buffers, maxRows);
+}
+
+void GGL::MLPEngine::_Reserve(Buffers& buffers, int maxRows) const {
+	int maxWidth = 0, maxQuantWidth = 0;
+	for (auto& layer : layers) {
+		maxWidth = RS_MAX(maxWidth, layer.paddedOutputs);
+		if (layer.quantized)
+			maxQuantWidth = RS_MAX(maxQuantWidth, (layer.numInputs + 1) / 2 * 2);
+	}
+
+	// Only ever grow, so that alternating batch sizes don't reallocate
+	size_t floatSize = (size_t)maxRows * maxWidth;
+	if (buffers.a.size() < floatSize) {
+		buffers.a.resize(floatSize);
+		buffers.b.resize(floatSize);
+	}
+
+	if (buffers.quant.size() < (size_t)maxRows * maxQuantWidth)
+		buffers.quant.resize((size_t)maxRows * maxQuantWidth);
+	if (maxQuantWidth && buffers.quantScales.size() < (size_t)maxRows)
+		buffers.quantScales.resize(maxRows);
+}
+
+void GGL::MLPEngine::QuantizeInt8(const float* calibrationInputs, int numCalibrationRows, int calibrationInputStride) {
+	RG_ASSERT(!layers.empty());
+
+	for (auto& layer : layers)
+		layer.quantized = false;
+
+	// Run the calibration rows through the float layers to find the input range of each layer
+	if (calibrationInputs && numCalibrationRows > 0) {
+		std::vector<float> in, out;
+		int inStride = calibrationInputStride ? calibrationInputStride : GetNumInputs();
+		in.assign(calibrationInputs, calibrationInputs + (size_t)(numCalibrationRows - 1) * inStride + GetNumInputs());
+
+		for (auto& layer : layers) {
+			std::vector<float> magnitudes = {};
+			magnitudes.reserve((size_t)numCalibrationRows * layer.numInputs);
+			for (int r = 0; r < numCalibrationRows; r++)
+				for (int i = 0; i < layer.numInputs; i++)
+					magnitudes.push_back(fabsf(in[(size_t)r * inStride + i]));
+
+			size_t clipIdx = RS_MIN((size_t)(magnitudes.size() * (1 - INT8_CALIBRATION_CLIP_FRAC)), magnitudes.size() - 1);
+			std::nth_element(magnitudes.begin(), magnitudes.begin() + clipIdx, magnitudes.end());
+			float clipVal = magnitudes[clipIdx];
+			layer.inputScale = clipVal > 0 ? (clipVal / INT8_MAX_VAL) : 0;
+
+			out.resize((size_t)numCalibrationRows * layer.paddedOutputs);
+			_Reserve(_buffers, numCalibrationRows);
+			_RunLayer(layer, in.data(), inStride, numCalibrationRows, out.data(), _buffers);
+			std::swap(in, out);
+			inStride = layer.paddedOutputs;
+		}
+	} else {
+		for (auto& layer : layers)
+			layer.inputScale = 0;
+	}
+
+	// The output layer stays as floats, since it directly determines the action probabilities, and is usually small
+	for (int layerIdx = 0; layerIdx < (int)layers.size() - 1; layerIdx++) {
+		Layer& layer = layers[layerIdx];
+		int numPairs = (layer.numInputs + 1) / 2;
+
+		layer.weightScales.assign(layer.paddedOutputs, 0);
+		layer.weightsQ.assign((size_t)numPairs * layer.paddedOutputs * 2, 0);
+
+		for (int o = 0; o < layer.numOutputs; o++) {
+			float maxAbs = 0;
+			for (int i = 0; i < layer.numInputs; i++)
+				maxAbs = RS_MAX(maxAbs, fabsf(layer.weightsT[(size_t)i * layer.paddedOutputs + o]));
+
+			float scale = maxAbs > 0 ? (maxAbs / INT8_MAX_VAL) : 1;
+			layer.weightScales[o] = scale;
+
+			for (int i = 0; i < layer.numInputs; i++) {
+				float val = layer.weightsT[(size_t)i * layer.paddedOutputs + o] / scale;
+				size_t idx = ((size_t)(i / 2) * layer.paddedOutputs + o) * 2 + (i % 2);
+				layer.weightsQ[idx] = (int8_t)RoundToInt(RS_CLAMP(val, -INT8_MAX_VAL, INT8_MAX_VAL));
+			}
+		}
+
+		layer.quantized = true;
+	}
+}
+
+bool GGL::MLPEngine::IsQuantized() const {
+	for (auto& layer : layers)
+		if (layer.quantized)
+			return true;
+	return false;
+}
+
+size_t GGL::MLPEngine::GetMemoryBytes() const {
+	size_t bytes = _buffers.GetMemoryBytes();
+	for (auto& layer : layers) {
+		bytes +=
+			(layer.weightsT.capacity() + layer.biases.capacity() + layer.normWeights.capacity() + layer.normBiases.capacity()
+				+ layer.weightScales.capacity()) * sizeof(float)
+			+ layer.weightsQ.capacity() * sizeof(int8_t);
+	}
+	return bytes;
+}
+
+void GGL::MLPEngine::_RunLayer(const Layer& layer, const float* in, int inStride, int numRows, float* out, Buffers& buffers) const {
+	const MLPKernelSet* kernels = GetKernels();
+
+	if (layer.quantized) {
+		// Quantize the inputs
+		int numPairs = (layer.numInputs + 1) / 2;
+		int quantStride = numPairs * 2;
+		for (int r = 0; r < numRows; r++) {
+			const float* row = in + (size_t)r * inStride;
+			int16_t* quantRow = buffers.quant.data() + (size_t)r * quantStride;
+
+			float scale = layer.inputScale;
+			if (scale == 0) {
+				float maxAbs = 0;
+				for (int i = 0; i < layer.numInputs; i++)
+					maxAbs = RS_MAX(maxAbs, fabsf(row[i]));
+				scale = maxAbs > 0 ? (maxAbs / INT8_MAX_VAL) : 1;
+			}
+			buffers.quantScales[r] = scale;
+
+			float invScale = 1 / scale;
+			for (int i = 0; i < layer.numInputs; i++) {
+				float val = row[i] * invScale;
+				quantRow[i] = (int16_t)RoundToInt(RS_CLAMP(val, -INT8_MAX_VAL, INT8_MAX_VAL));
+			}
+			if (layer.numInputs % 2)
+				quantRow[layer.numInputs] = 0;
+		}
+
+		kernels->gemmInt8(
+			buffers.quant.data(), quantStride, buffers.quantScales.data(), numRows, numPairs,
+			layer.weightsQ.data(), layer.weightScales.data(), layer.biases.data(), layer.paddedOutputs,
+			out
+		);
+	} else {
+		kernels->gemm(in, inStride, numRows, layer.numInputs, layer.weightsT.data(), layer.biases.data(), layer.paddedOutputs, out);
+	}
+
+	bool hasNorm = !layer.normWeights.empty();
+	if (hasNorm || layer.activate) {
+		for (int r = 0; r < numRows; r++) {
+			float* row = out + (size_t)r * layer.paddedOutputs;
+			int n = layer.numOutputs;
+
+			if (hasNorm) {
+				float mean = 0;
+				for (int i = 0; i < n; i++)
+					mean += row[i];
+				mean /= n;
+
+				float var = 0;
+				for (int i = 0; i < n; i++)
+					var += (row[i] - mean) * (row[i] - mean);
+				var /= n;
+
+				float invSTD = 1 / sqrtf(var + LAYER_NORM_EPS);
+				for (int i = 0; i < n; i++)
+					row[i] = (row[i] - mean) * invSTD * layer.normWeights[i] + layer.normBiases[i];
+			}
+
+			if (layer.activate) {
+				switch (activationType) {
+				case ModelActivationType::RELU:
+					for (int i = 0; i < n; i++)
+						row[i] = RS_MAX(row[i], 0.f);
+					break;
+				case ModelActivationType::LEAKY_RELU:
+					for (int i = 0; i < n; i++)
+						row[i] = row[i] > 0 ? row[i] : (row[i] * LEAKY_RELU_SLOPE);
+					break;
+				case ModelActivationType::SIGMOID:
+					for (int i = 0; i < n; i++)
+						row[i] = 1 / (1 + expf(-row[i]));
+					break;
+				case ModelActivationType::TANH:
+					for (int i = 0; i < n; i++)
+						row[i] = tanhf(row[i]);
+					break;
+				}
+			}
+		}
+	}
+}
+
+const float* GGL::MLPEngine::Forward(const float* inputs, int numRows, int inputStride) {
+	return Forward(inputs, numRows, inputStride, _buffers);
+}
+
+const float* GGL::MLPEngine::Forward(const float* inputs, int numRows, int inputStride, Buffers& buffers) const {
+	RG_ASSERT(!layers.empty());
+
+	_Reserve(buffers, numRows);
+
+	const float* in = inputs;
+	int inStride = inputStride ? inputStride : GetNumInputs();
+	float* out = buffers.a.data();
+
+	for (auto& layer : layers) {
+		_RunLayer(layer, in, inStride, numRows, out, buffers);
+
+		in = out;
+		inStride = layer.paddedOutputs;
+		out = (out == buffers.a.data()) ? buffers.b.data() : buffers.a.data();
+	}
+
+	return in;
+}
+
+const char* GGL::MLPEngine::GetKernelName() {
+	return GetKernels()->name;
+}
+
+void GGL::MLPEngine::SetMaxKernelLevel(int level) {
+	g_MaxKernelLevel = level;
+	g_Kernels = NULL;
+}
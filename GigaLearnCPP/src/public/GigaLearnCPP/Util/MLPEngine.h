@@ -0,0 +1,96 @@
+#pragma once
+
+#include "ModelConfig.h"
+
+namespace GGL {
+
+	// Dependency-free CPU inference for the MLPs built by Model (Linear, optional LayerNorm, activation)
+	// Uses hand-written AVX2/AVX-512 kernels when the CPU supports them, with a scalar fallback
+	// Can also run with int8 weights (see QuantizeInt8())
+	// Meant for small-batch inference (e.g. a bot inferring one player at a time), where libtorch's per-op overhead dominates
+	class RG_IMEXPORT MLPEngine {
+	public:
+		struct Layer {
+			int numInputs, numOutputs;
+			int paddedOutputs; // numOutputs rounded up so every SIMD width divides it
+			std::vector<float> weightsT; // (numInputs, paddedOutputs), transposed and zero-padded
+			std::vector<float> biases; // (paddedOutputs), zero-padded
+			std::vector<float> normWeights, normBiases; // (numOutputs), empty if there is no layer norm
+			bool activate;
+
+			// Int8 weights, see QuantizeInt8()
+			bool quantized = false;
+			std::vector<int8_t> weightsQ; // (numInputs / 2 rounded up, paddedOutputs, 2), each output's weights for a pair of inputs are interleaved
+			std::vector<float> weightScales; // (paddedOutputs), one scale per output
+			float inputScale = 0; // Fixed input quantization scale from calibration, or 0 to use the max of each input row
+		};
+
+		ModelActivationType activationType;
+		std::vector<Layer> layers = {};
+
+		MLPEngine(ModelActivationType activationType) : activationType(activationType) {}
+
+		// weights are (numOutputs, numInputs), the same layout as torch::nn::Linear
+		// normWeights and normBiases can be NULL if there is no layer norm
+		void AddLayer(
+			int numInputs, int numOutputs,
+			const float* weights, const float* biases,
+			const float* normWeights, const float* normBiases,
+			bool activate
+		);
+
+		int GetNumInputs() const { return layers.front().numInputs; }
+		int GetNumOutputs() const { return layers.back().numOutputs; }
+
+		// Row stride of the outputs returned by Forward()
+		int GetOutputStride() const { return layers.back().paddedOutputs; }
+
+		// Activation buffers used by Forward()
+		// Each engine owns one set, extra sets let several threads run the same engine at once
+		struct Buffers {
+			std::vector<float> a = {}, b = {};
+			std::vector<int16_t> quant = {}; // Quantized inputs, int8 values stored as int16 (see MLPKernelSet::gemmInt8)
+			std::vector<float> quantScales = {};
+
+			size_t GetMemoryBytes() const {
+				return (a.capacity() + b.capacity() + quantScales.capacity()) * sizeof(float) + quant.capacity() * sizeof(int16_t);
+			}
+		};
+
+		// Allocates activation buffers so Forward() won't need to allocate for batches up to this size
+		void Reserve(int maxRows);
+
+		// Runs numRows rows of inputs through the network
+		// If inputStride is 0, the inputs are packed (GetNumInputs() floats per row)
+		// The returned outputs have a row stride of GetOutputStride(), and are only valid until the next call
+		// NOTE: Not thread-safe, as the activations are written to buffers owned by the engine
+		const float* Forward(const float* inputs, int numRows, int inputStride = 0);
+
+		// Same as above, but writes the activations to the given buffers instead, so it can be called from several threads at once
+		// The returned outputs live in the given buffers
+		const float* Forward(const float* inputs, int numRows, int inputStride, Buffers& buffers) const;
+
+		// Switches every layer except the output layer to int8 weights (symmetric, per output)
+		// Inputs to the quantized layers are quantized to int8 on the fly
+		// If calibration inputs are given, each layer uses a fixed input scale that clips the rarest outliers of its inputs on those rows,
+		//	otherwise each input row is scaled by its own max
+		void QuantizeInt8(const float* calibrationInputs = NULL, int numCalibrationRows = 0, int calibrationInputStride = 0);
+		bool IsQuantized() const;
+
+		// Memory held by the weights and the engine's own activation buffers
+		size_t GetMemoryBytes() const;
+
+		// Name of the kernel set used on this CPU ("AVX-512 VNNI", "AVX-512", "AVX2", or "Scalar")
+		static const char* GetKernelName();
+
+		// Restricts which kernel sets can be picked, mostly for testing and benchmarking
+		// Must be called before any engine runs
+		static void SetMaxKernelLevel(int level); // 0 = Scalar, 1 = AVX2, 2 = AVX-512, 3 = AVX-512 VNNI
+
+	private:
+		Buffers _buffers = {};
+
+		void _Reserve(Buffers& buffers, int maxRows) const;
+		void _RunLayer(const Layer& layer, const float* in, int inStride, int numRows, float* out, Buffers& buffers) const;
+	};
+}
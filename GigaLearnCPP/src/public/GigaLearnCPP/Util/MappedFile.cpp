@@ -0,0 +1,79 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+GGL::MappedFile::MappedFile(std::filesystem::path path) {
+	constexpr const char* ERROR_PREFIX = "MappedFile::MappedFile(): ";
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to open " << path);
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to get the size of " << path);
+	}
+	size = (size_t)fileSize.QuadPart;
+	_fileHandle = file;
+
+	// Mapping an empty file fails, so leave data NULL
+	if (size > 0) {
+		HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!mapping)
+			RG_ERR_CLOSE(ERROR_PREFIX << "Failed to map " << path);
+		_mappingHandle = mapping;
+
+		data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!data)
+			RG_ERR_CLOSE(ERROR_PREFIX << "Failed to map a view of " << path);
+	}
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to open " << path);
+
+	struct stat fileStat;
+	if (fstat(fd, &fileStat) != 0) {
+		close(fd);
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to get the size of " << path);
+	}
+	size = (size_t)fileStat.st_size;
+
+	if (size > 0) {
+		void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED) {
+			close(fd);
+			RG_ERR_CLOSE(ERROR_PREFIX << "Failed to map " << path);
+		}
+		data = (const uint8_t*)mapped;
+	}
+
+	// The mapping stays valid after the file is closed
+	close(fd);
+#endif
+}
+
+GGL::MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (_mappingHandle)
+		CloseHandle(_mappingHandle);
+	if (_fileHandle)
+		CloseHandle(_fileHandle);
+#else
+	if (data)
+		munmap((void*)data, size);
+#endif
+}
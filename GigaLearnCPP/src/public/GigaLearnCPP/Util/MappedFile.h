@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../Framework.h"
+
+namespace GGL {
+	// Read-only memory mapping of a whole file
+	// Pages are only read from disk as they are touched, and are shared with any other process mapping the same file
+	class RG_IMEXPORT MappedFile {
+	public:
+		const uint8_t* data = NULL;
+		size_t size = 0;
+
+		// Closes with an error if the file can't be opened or mapped
+		MappedFile(std::filesystem::path path);
+		RG_NO_COPY(MappedFile);
+		~MappedFile();
+
+		// Returns a pointer to count objects of type T at offset, or NULL if that range is out of bounds or misaligned
+		template <typename T>
+		const T* Get(uint64_t offset, uint64_t count = 1) const {
+			if (offset > size || count > (size - offset) / sizeof(T))
+				return NULL;
+			if (offset % alignof(T) != 0)
+				return NULL;
+			return reinterpret_cast<const T*>(data + offset);
+		}
+
+	private:
+		void* _fileHandle = NULL;
+		void* _mappingHandle = NULL;
+	};
+}
@@ -0,0 +1,114 @@
+#include "MemoryAccounting.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+#endif
+
+constexpr double BYTES_PER_MB = 1024 * 1024;
+
+void GGL::MemoryAccounting::Set(Subsystem subsystem, MemoryUsage subsystemUsage) {
+	usage[subsystem] = subsystemUsage;
+	peakUsage[subsystem].host = RS_MAX(peakUsage[subsystem].host, subsystemUsage.host);
+	peakUsage[subsystem].device = RS_MAX(peakUsage[subsystem].device, subsystemUsage.device);
+}
+
+void GGL::MemoryAccounting::SetDeviceReserved(uint64_t numBytes) {
+	deviceReservedBytes = numBytes;
+	peakDeviceReservedBytes = RS_MAX(peakDeviceReservedBytes, numBytes);
+}
+
+GGL::MemoryUsage GGL::MemoryAccounting::GetTrackedUsage() const {
+	MemoryUsage total = {};
+	for (auto& subsystemUsage : usage)
+		total += subsystemUsage;
+	return total;
+}
+
+void GGL::MemoryAccounting::AddToReport(Report& report) {
+	for (int i = 0; i < SUBSYSTEM_AMOUNT; i++) {
+		std::string prefix = std::string("Memory/") + SUBSYSTEM_NAMES[i];
+		report[prefix + " MB"] = usage[i].host / BYTES_PER_MB;
+		report[prefix + " Peak MB"] = peakUsage[i].host / BYTES_PER_MB;
+		if (peakUsage[i].device > 0) {
+			report[prefix + " Device MB"] = usage[i].device / BYTES_PER_MB;
+			report[prefix + " Device Peak MB"] = peakUsage[i].device / BYTES_PER_MB;
+		}
+	}
+
+	// The peak of the sum, not the sum of the peaks, since subsystems peak at different points in the iteration
+	MemoryUsage trackedUsage = GetTrackedUsage();
+	peakTrackedUsage.host = RS_MAX(peakTrackedUsage.host, trackedUsage.host);
+	peakTrackedUsage.device = RS_MAX(peakTrackedUsage.device, trackedUsage.device);
+	report["Memory/Tracked MB"] = trackedUsage.host / BYTES_PER_MB;
+	report["Memory/Tracked Peak MB"] = peakTrackedUsage.host / BYTES_PER_MB;
+
+	if (peakTrackedUsage.device > 0 || peakDeviceReservedBytes > 0) {
+		report["Memory/Device Tracked MB"] = trackedUsage.device / BYTES_PER_MB;
+		report["Memory/Device Tracked Peak MB"] = peakTrackedUsage.device / BYTES_PER_MB;
+	}
+
+	if (peakDeviceReservedBytes > 0) {
+		report["Memory/Device Reserved MB"] = deviceReservedBytes / BYTES_PER_MB;
+		report["Memory/Device Reserved Peak MB"] = peakDeviceReservedBytes / BYTES_PER_MB;
+		report["Memory/Device Untracked MB"] = ((int64_t)deviceReservedBytes - (int64_t)trackedUsage.device) / BYTES_PER_MB;
+	}
+
+	uint64_t processBytes = GetProcessBytes();
+	if (processBytes > 0) {
+		report["Memory/Process MB"] = processBytes / BYTES_PER_MB;
+		report["Memory/Process Peak MB"] = GetProcessPeakBytes() / BYTES_PER_MB;
+		report["Memory/Untracked MB"] = ((int64_t)processBytes - (int64_t)trackedUsage.host) / BYTES_PER_MB;
+	}
+}
+
+uint64_t GGL::MemoryAccounting::GetProcessBytes() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize;
+#elif defined(__APPLE__)
+	mach_task_basic_info info = {};
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+		return 0;
+	return info.resident_size;
+#else
+	// Second field is the resident page count
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+	unsigned long long totalPages = 0, residentPages = 0;
+	int numRead = fscanf(file, "%llu %llu", &totalPages, &residentPages);
+	fclose(file);
+	if (numRead != 2)
+		return 0;
+	return residentPages * (uint64_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+uint64_t GGL::MemoryAccounting::GetProcessPeakBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss; // Bytes
+#else
+	return usage.ru_maxrss * 1024ull; // Kilobytes
+#endif
+#endif
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "Report.h"
+
+namespace GGL {
+	// Bytes held in host (CPU) memory and on a device (e.g. the GPU)
+	struct MemoryUsage {
+		uint64_t host = 0, device = 0;
+
+		MemoryUsage& operator+=(const MemoryUsage& other) {
+			host += other.host;
+			device += other.device;
+			return *this;
+		}
+	};
+
+	// Tracks how many bytes each part of training is using, so growth can be traced to a subsystem
+	// Sizes are set by whoever owns the memory (usually once per iteration, from container and tensor sizes), so tracking costs nothing in the hot path
+	// Host and device memory are tracked separately, since only host memory is part of the process's resident memory
+	// The process memory is reported alongside, with the difference from the tracked host memory as "Untracked" (allocator overhead, libraries, code, etc.)
+	struct MemoryAccounting {
+		enum Subsystem {
+			ARENAS,			// RocketSim arenas and everything else made when creating the envs
+			ENV_STATE,		// EnvSet state (game states, obs, action masks, rewards)
+			TRAJECTORIES,	// Per-player and combined trajectories during collection
+			EXPERIENCE,		// Experience buffer tensors
+			MODELS,			// Parameters, gradients and inference copies of the learning models
+			OPTIMIZER,		// Optimizer state of the learning models
+			VERSIONS,		// Old policy versions (compact parameters and materialized models)
+
+			SUBSYSTEM_AMOUNT
+		};
+
+		static constexpr const char* SUBSYSTEM_NAMES[SUBSYSTEM_AMOUNT] = {
+			"Arenas",
+			"Env State",
+			"Trajectories",
+			"Experience",
+			"Models",
+			"Optimizer",
+			"Versions"
+		};
+
+		MemoryUsage usage[SUBSYSTEM_AMOUNT] = {};
+		MemoryUsage peakUsage[SUBSYSTEM_AMOUNT] = {}; // High-water mark of each subsystem
+		MemoryUsage peakTrackedUsage = {};
+
+		// Memory reserved by libtorch's CUDA caching allocator
+		// This already includes every subsystem's device tensors, so it is reported next to the device total rather than added to it
+		uint64_t deviceReservedBytes = 0, peakDeviceReservedBytes = 0;
+
+		// Also raises the subsystem's high-water marks if needed
+		void Set(Subsystem subsystem, MemoryUsage subsystemUsage);
+		void Set(Subsystem subsystem, uint64_t hostBytes) {
+			Set(subsystem, MemoryUsage{ hostBytes, 0 });
+		}
+		void SetDeviceReserved(uint64_t numBytes);
+		MemoryUsage GetTrackedUsage() const;
+
+		// Adds "Memory/..." metrics for each subsystem, the totals, and the process
+		// Device metrics are only added once something has been on the device
+		void AddToReport(Report& report);
+
+		// Resident memory of the whole process, 0 if unsupported on this platform
+		static uint64_t GetProcessBytes();
+		static uint64_t GetProcessPeakBytes();
+
+		// Size of the elements a vector has room for, which is what it is actually holding onto
+		template <typename T>
+		static uint64_t GetVectorBytes(const std::vector<T>& vec) {
+			if constexpr (std::is_same<T, bool>::value) {
+				return vec.capacity() / 8;
+			} else {
+				return vec.capacity() * sizeof(T);
+			}
+		}
+	};
+}
@@ -1,5 +1,6 @@
 #include "MetricSender.h"
 
+#ifdef RG_PYTHON_SUPPORT
 #include "Timer.h"
 
 namespace py = pybind11;
@@ -10,6 +11,8 @@ GGL::MetricSender::MetricSender(std::string _projectName, std::string _groupName
 
 	RG_LOG("Initializing MetricSender...");
 
+	py::gil_scoped_acquire gil;
+
 	try {
 		pyMod = py::module::import("python_scripts.metric_receiver");
 	} catch (std::exception& e) {
@@ -28,7 +31,9 @@ GGL::MetricSender::MetricSender(std::string _projectName, std::string _groupName
 	RG_LOG(" > MetricSender initalized.");
 }
 
-void GGL::MetricSender::Send(const Report& report) {
+void GGL::MetricSender::Write(const Report& report) {
+	py::gil_scoped_acquire gil;
+
 	py::dict reportDict = {};
 
 	for (auto& pair : report.data)
@@ -42,5 +47,8 @@ void GGL::MetricSender::Send(const Report& report) {
 }
 
 GGL::MetricSender::~MetricSender() {
-	
-}
\ No newline at end of file
+	// Releasing the module needs the GIL
+	py::gil_scoped_acquire gil;
+	pyMod = py::module();
+}
+#endif
\ No newline at end of file
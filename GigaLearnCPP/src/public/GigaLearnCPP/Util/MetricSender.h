@@ -1,9 +1,13 @@
 #pragma once
-#include "Report.h"
+#include "MetricsPipeline.h"
+
+#ifdef RG_PYTHON_SUPPORT
 #include <pybind11/pybind11.h>
 
 namespace GGL {
-	struct RG_IMEXPORT MetricSender {
+	// Metrics backend that sends reports to wandb through python_scripts/metric_receiver.py
+	// Holds the GIL while calling into Python, so it is safe to use from the metrics thread
+	struct RG_IMEXPORT MetricSender : MetricsBackend {
 		std::string curRunID;
 		std::string projectName, groupName, runName;
 		pybind11::module pyMod;
@@ -12,8 +16,9 @@ namespace GGL {
 		
 		RG_NO_COPY(MetricSender);
 
-		void Send(const Report& report);
+		void Write(const Report& report) override;
 
 		~MetricSender();
 	};
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,232 @@
+#include "MetricsPipeline.h"
+
+#include <nlohmann/json.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // Not on macOS, which uses SO_NOSIGPIPE instead
+#endif
+#endif
+
+GGL::MetricsPipeline::MetricsPipeline(size_t maxQueuedReports) : maxQueuedReports(maxQueuedReports) {
+	_thread = std::thread(&MetricsPipeline::_Run, this);
+}
+
+void GGL::MetricsPipeline::AddBackend(MetricsBackend* backend) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	_backends.push_back(backend);
+}
+
+void GGL::MetricsPipeline::Send(const Report& report) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_queue.size() >= maxQueuedReports) {
+			_queue.pop_front();
+			_numDropped++;
+			RG_LOG("MetricsPipeline: WARNING: Metrics backends are falling behind, dropped " << _numDropped << " report(s) so far");
+		}
+		_queue.push_back(report);
+	}
+	_queueCV.notify_one();
+}
+
+void GGL::MetricsPipeline::Flush() {
+	std::unique_lock<std::mutex> lock(_mutex);
+	_flushQueued = true;
+	_queueCV.notify_one();
+	_idleCV.wait(lock, [&] { return _queue.empty() && !_writing && !_flushQueued; });
+}
+
+void GGL::MetricsPipeline::_Run() {
+	while (true) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_queueCV.wait(lock, [&] { return !_queue.empty() || _flushQueued || _stop; });
+
+		Report report;
+		bool flush = false;
+		if (!_queue.empty()) {
+			report = std::move(_queue.front());
+			_queue.pop_front();
+		} else if (_flushQueued) {
+			flush = true;
+			_flushQueued = false;
+		} else {
+			break; // Stopping, and everything has been written
+		}
+
+		_writing = true;
+		lock.unlock();
+
+		for (MetricsBackend* backend : _backends) {
+			try {
+				if (flush) {
+					backend->Flush();
+				} else {
+					backend->Write(report);
+				}
+			} catch (std::exception& e) {
+				RG_LOG("MetricsPipeline: WARNING: Backend failed to " << (flush ? "flush" : "write a report") << ", exception: " << e.what());
+			}
+		}
+
+		lock.lock();
+		_writing = false;
+		lock.unlock();
+		_idleCV.notify_all();
+	}
+}
+
+GGL::MetricsPipeline::~MetricsPipeline() {
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_queueCV.notify_one();
+	_thread.join();
+
+	for (MetricsBackend* backend : _backends)
+		delete backend;
+}
+
+//////////////////////////
+
+GGL::CSVMetricsBackend::CSVMetricsBackend(std::filesystem::path path) : path(path) {
+	bool isNew = !std::filesystem::exists(path) || std::filesystem::file_size(path) == 0;
+
+	fOut = std::ofstream(path, std::ios::app);
+	if (!fOut.good())
+		RG_ERR_CLOSE("CSVMetricsBackend: Can't open file at " << path);
+
+	if (isNew)
+		fOut << "unix_time,name,value\n";
+	fOut << std::setprecision(15);
+}
+
+void GGL::CSVMetricsBackend::Write(const Report& report) {
+	if (failed)
+		return;
+
+	double unixTime = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+	for (auto& pair : report.data) {
+		const std::string& name = pair.first;
+
+		fOut << std::fixed << std::setprecision(3) << unixTime << ',';
+		if (name.find_first_of(",\"\n") != std::string::npos) {
+			fOut << '"';
+			for (char c : name) {
+				if (c == '"')
+					fOut << '"';
+				fOut << c;
+			}
+			fOut << '"';
+		} else {
+			fOut << name;
+		}
+		fOut << ',' << std::defaultfloat << std::setprecision(15) << pair.second << '\n';
+	}
+
+	if (!fOut.good()) {
+		RG_LOG("CSVMetricsBackend: WARNING: Failed to write to " << path << ", no more metrics will be written to it");
+		failed = true;
+	}
+}
+
+void GGL::CSVMetricsBackend::Flush() {
+	if (failed)
+		return;
+
+	fOut.flush();
+	if (!fOut.good()) {
+		RG_LOG("CSVMetricsBackend: WARNING: Failed to flush " << path << ", no more metrics will be written to it");
+		failed = true;
+	}
+}
+
+//////////////////////////
+
+GGL::SocketMetricsBackend::SocketMetricsBackend(std::filesystem::path path) : path(path) {
+	constexpr const char* ERROR_PREFIX = "SocketMetricsBackend: ";
+
+#ifdef _WIN32
+	RG_ERR_CLOSE(ERROR_PREFIX << "Unix domain sockets are not supported on Windows");
+#else
+	sockaddr_un addr = {};
+	addr.sun_family = AF_UNIX;
+	std::string pathStr = path.string();
+	if (pathStr.empty() || pathStr.size() >= sizeof(addr.sun_path))
+		RG_ERR_CLOSE(ERROR_PREFIX << "Invalid socket path " << path << " (must be 1-" << (sizeof(addr.sun_path) - 1) << " characters)");
+	memcpy(addr.sun_path, pathStr.data(), pathStr.size());
+
+	// A socket file left over from a previous run would make bind() fail
+	std::filesystem::remove(path);
+
+	listenFD = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFD < 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to create socket, error: " << strerror(errno));
+
+	if (bind(listenFD, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFD, 16) != 0) {
+		int error = errno;
+		close(listenFD);
+		listenFD = -1;
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to listen on " << path << ", error: " << strerror(error));
+	}
+
+	// Clients are only accepted when a report is written, which must never block
+	fcntl(listenFD, F_SETFL, fcntl(listenFD, F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+void GGL::SocketMetricsBackend::Write(const Report& report) {
+#ifndef _WIN32
+	while (true) {
+		int clientFD = accept(listenFD, NULL, NULL);
+		if (clientFD < 0)
+			break;
+
+		fcntl(clientFD, F_SETFL, fcntl(clientFD, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+		int noSigPipe = 1;
+		setsockopt(clientFD, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+		clientFDs.push_back(clientFD);
+	}
+
+	if (clientFDs.empty())
+		return;
+
+	nlohmann::json j = {};
+	for (auto& pair : report.data)
+		j[pair.first] = pair.second;
+	std::string line = j.dump() + '\n';
+
+	for (int i = 0; i < clientFDs.size(); i++) {
+		// Also catches disconnected clients
+		// A partial line would corrupt the stream, so a client that can't take the whole line is dropped too
+		ssize_t numSent = send(clientFDs[i], line.data(), line.size(), MSG_NOSIGNAL);
+		if (numSent != (ssize_t)line.size()) {
+			close(clientFDs[i]);
+			clientFDs.erase(clientFDs.begin() + i);
+			i--;
+		}
+	}
+#endif
+}
+
+GGL::SocketMetricsBackend::~SocketMetricsBackend() {
+#ifndef _WIN32
+	for (int clientFD : clientFDs)
+		close(clientFD);
+
+	if (listenFD >= 0) {
+		close(listenFD);
+		std::filesystem::remove(path);
+	}
+#endif
+}
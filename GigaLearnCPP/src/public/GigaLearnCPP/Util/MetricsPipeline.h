@@ -0,0 +1,85 @@
+#pragma once
+#include "Report.h"
+
+#include <deque>
+#include <condition_variable>
+
+namespace GGL {
+	// Somewhere reports are written to
+	// Backends are only ever called from the pipeline's background thread
+	struct RG_IMEXPORT MetricsBackend {
+		virtual void Write(const Report& report) = 0;
+		virtual void Flush() {}
+		virtual ~MetricsBackend() = default;
+	};
+
+	// Queues reports and writes them to every backend on a background thread, so slow or failing backends never stall training
+	// A backend that throws only loses that report, training continues either way
+	class RG_IMEXPORT MetricsPipeline {
+	public:
+		// If the backends fall this far behind, the oldest queued reports are dropped
+		size_t maxQueuedReports;
+
+		MetricsPipeline(size_t maxQueuedReports = 64);
+		RG_NO_COPY(MetricsPipeline);
+
+		// Takes ownership of the backend
+		// All backends must be added before the first Send()
+		void AddBackend(MetricsBackend* backend);
+
+		bool HasBackends() const {
+			return !_backends.empty();
+		}
+
+		// Copies the report onto the queue and returns immediately
+		void Send(const Report& report);
+
+		// Blocks until every queued report has been written and the backends are flushed
+		void Flush();
+
+		// Flushes, then deletes the backends
+		~MetricsPipeline();
+
+	private:
+		std::vector<MetricsBackend*> _backends = {};
+
+		std::thread _thread;
+		std::mutex _mutex = {};
+		std::condition_variable _queueCV = {}, _idleCV = {};
+		std::deque<Report> _queue = {};
+		bool _writing = false, _flushQueued = false, _stop = false;
+		uint64_t _numDropped = 0;
+
+		void _Run();
+	};
+
+	// Appends every metric as a "unix_time,name,value" row (all rows of a report share their time)
+	// Unlike one column per metric, this stays valid as metrics come and go, and when resuming into the same file
+	// If a write fails (e.g. the disk is full), the error is logged once and the backend stops writing
+	struct RG_IMEXPORT CSVMetricsBackend : MetricsBackend {
+		std::filesystem::path path;
+		std::ofstream fOut;
+		bool failed = false;
+
+		CSVMetricsBackend(std::filesystem::path path);
+		RG_NO_COPY(CSVMetricsBackend);
+
+		void Write(const Report& report) override;
+		void Flush() override;
+	};
+
+	// Listens on a Unix domain socket, and sends each report to every connected client as one line of JSON
+	// Clients can connect and disconnect at any time, clients that can't keep up are dropped
+	struct RG_IMEXPORT SocketMetricsBackend : MetricsBackend {
+		std::filesystem::path path;
+		int listenFD = -1;
+		std::vector<int> clientFDs = {};
+
+		SocketMetricsBackend(std::filesystem::path path);
+		RG_NO_COPY(SocketMetricsBackend);
+
+		void Write(const Report& report) override;
+
+		~SocketMetricsBackend();
+	};
+}
@@ -26,6 +26,19 @@ namespace GGL {
 		bool addLayerNorm = true;
 		bool addOutputLayer = true;
 
+		// Packs all parameters into one flat buffer, and steps them with a single fused optimizer pass (no per-parameter ops or syncs)
+		bool fuseOptim = false;
+
+		// When running on the CPU without autograd, run through a torch-free MLPEngine copy of the weights instead of the module chain
+		// The copy is rebuilt automatically whenever the parameters change, use GGL_InferenceBench to check that it is faster for your model
+		bool engineInference = false;
+
+		// When running on the CPU without autograd, use int8 weights for every layer except the output layer (see MLPEngine::QuantizeInt8())
+		// This also affects collection: the int8 model acts and its own log probs are stored, so the PPO ratio stays a correct importance weight (like with useHalfPrecision)
+		// "Int8 Action Agreement" in the metrics shows how often it still picks the same action as full precision
+		// Inputs are quantized per row unless the model has been calibrated (see PPOLearner::CalibrateInt8())
+		bool int8Inference = false;
+
 		bool IsValid() const {
 			return !layerSizes.empty();
 		}
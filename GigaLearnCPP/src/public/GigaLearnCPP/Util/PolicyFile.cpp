@@ -0,0 +1,110 @@
+#include "PolicyFile.h"
+
+namespace {
+	struct FileBuilder {
+		std::vector<uint8_t> bytes = {};
+
+		uint64_t Align() {
+			uint64_t padded = (bytes.size() + GGL::PolicyFile::ALIGN - 1) / GGL::PolicyFile::ALIGN * GGL::PolicyFile::ALIGN;
+			bytes.resize(padded, 0);
+			return padded;
+		}
+
+		// Returns the offset of the appended data
+		uint64_t Append(const void* data, size_t size) {
+			uint64_t offset = Align();
+			bytes.insert(bytes.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+			return offset;
+		}
+
+		uint64_t AppendFloats(const std::vector<float>& floats) {
+			return Append(floats.data(), floats.size() * sizeof(float));
+		}
+	};
+}
+
+void GGL::PolicyFile::Write(
+	std::filesystem::path path,
+	const MLPEngine* sharedHead, const MLPEngine& policy,
+	const std::vector<float>& obsMean, const std::vector<float>& obsInvSTD,
+	const std::vector<RLGC::Action>& actions) {
+
+	constexpr const char* ERROR_PREFIX = "PolicyFile::Write(): ";
+
+	if (sharedHead && sharedHead->activationType != policy.activationType)
+		RG_ERR_CLOSE(ERROR_PREFIX << "The shared head and policy must use the same activation function");
+	if (policy.GetNumOutputs() != actions.size())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Policy outputs (" << policy.GetNumOutputs() << ") don't match the number of actions (" << actions.size() << ")");
+	if (sharedHead && sharedHead->GetNumOutputs() != policy.GetNumInputs())
+		RG_ERR_CLOSE(ERROR_PREFIX << "Shared head outputs (" << sharedHead->GetNumOutputs() << ") don't match the policy inputs (" << policy.GetNumInputs() << ")");
+
+	int obsSize = sharedHead ? sharedHead->GetNumInputs() : policy.GetNumInputs();
+	if (!obsMean.empty() && (obsMean.size() != obsSize || obsInvSTD.size() != obsSize))
+		RG_ERR_CLOSE(ERROR_PREFIX << "Obs standardization stats don't match the obs size (" << obsSize << ")");
+
+	std::vector<std::pair<int32_t, const MLPEngine::Layer*>> allLayers = {};
+	if (sharedHead)
+		for (auto& layer : sharedHead->layers)
+			allLayers.push_back({ STACK_SHARED_HEAD, &layer });
+	for (auto& layer : policy.layers)
+		allLayers.push_back({ STACK_POLICY, &layer });
+
+	FileBuilder builder = {};
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.obsSize = obsSize;
+	header.numActions = actions.size();
+	header.activationType = (int32_t)policy.activationType;
+	header.numLayers = allLayers.size();
+	builder.Append(&header, sizeof(header)); // Rewritten at the end, once the offsets are known
+
+	std::vector<LayerDesc> layerDescs = {};
+	for (auto& pair : allLayers) {
+		const MLPEngine::Layer& layer = *pair.second;
+
+		// Engines store transposed, padded weights, so convert back to the torch layout
+		std::vector<float> weights = std::vector<float>((size_t)layer.numOutputs * layer.numInputs);
+		for (int o = 0; o < layer.numOutputs; o++)
+			for (int i = 0; i < layer.numInputs; i++)
+				weights[(size_t)o * layer.numInputs + i] = layer.weightsT[(size_t)i * layer.paddedOutputs + o];
+
+		LayerDesc desc = {};
+		desc.stack = pair.first;
+		desc.numInputs = layer.numInputs;
+		desc.numOutputs = layer.numOutputs;
+		desc.flags = (layer.normWeights.empty() ? 0 : LAYER_HAS_NORM) | (layer.activate ? LAYER_ACTIVATE : 0);
+		desc.weightsOffset = builder.AppendFloats(weights);
+		desc.biasesOffset = builder.Append(layer.biases.data(), layer.numOutputs * sizeof(float));
+		if (desc.flags & LAYER_HAS_NORM) {
+			desc.normWeightsOffset = builder.AppendFloats(layer.normWeights);
+			desc.normBiasesOffset = builder.AppendFloats(layer.normBiases);
+		}
+		layerDescs.push_back(desc);
+	}
+	header.layersOffset = builder.Append(layerDescs.data(), layerDescs.size() * sizeof(LayerDesc));
+
+	if (!obsMean.empty()) {
+		header.obsMeanOffset = builder.AppendFloats(obsMean);
+		header.obsInvSTDOffset = builder.AppendFloats(obsInvSTD);
+	}
+
+	static_assert(sizeof(RLGC::Action) == RLGC::Action::ELEM_AMOUNT * sizeof(float));
+	header.actionsOffset = builder.Append(actions.data(), actions.size() * sizeof(RLGC::Action));
+
+	header.fileSize = builder.bytes.size();
+	memcpy(builder.bytes.data(), &header, sizeof(header));
+
+	// Write to a temporary file first so a crash can't leave a half-written policy behind
+	std::filesystem::path tempPath = path;
+	tempPath += ".tmp";
+	{
+		std::ofstream fOut(tempPath, std::ios::binary);
+		if (!fOut.good())
+			RG_ERR_CLOSE(ERROR_PREFIX << "Can't open file at " << tempPath);
+		fOut.write((const char*)builder.bytes.data(), builder.bytes.size());
+		if (!fOut.good())
+			RG_ERR_CLOSE(ERROR_PREFIX << "Failed to write to " << tempPath);
+	}
+	std::filesystem::rename(tempPath, path);
+}
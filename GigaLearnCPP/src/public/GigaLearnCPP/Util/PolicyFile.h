@@ -0,0 +1,61 @@
+#pragma once
+
+#include "MLPEngine.h"
+
+// Self-contained exported policy format, loaded by PolicyRuntime
+// Everything needed to turn a built obs into an action: network topology and weights, obs standardization, and the action table
+// All values are little-endian, and every array starts on a POLICY_FILE_ALIGN boundary so it can be used straight from a memory mapping
+namespace GGL {
+	namespace PolicyFile {
+		constexpr char MAGIC[4] = { 'G', 'G', 'L', 'P' };
+
+		// Increment whenever the layout changes
+		constexpr uint32_t VERSION = 1;
+
+		constexpr uint64_t ALIGN = 64;
+
+		enum : int32_t {
+			LAYER_HAS_NORM = 1 << 0,
+			LAYER_ACTIVATE = 1 << 1
+		};
+
+		enum : int32_t {
+			STACK_SHARED_HEAD,
+			STACK_POLICY
+		};
+
+		struct Header {
+			char magic[4];
+			uint32_t version;
+			uint64_t fileSize; // To catch truncated files
+
+			int32_t obsSize, numActions;
+			int32_t activationType; // ModelActivationType
+			int32_t numLayers;
+
+			uint64_t layersOffset; // LayerDesc[numLayers], shared head layers first
+			uint64_t obsMeanOffset, obsInvSTDOffset; // float[obsSize] each, 0 if obs aren't standardized
+			uint64_t actionsOffset; // float[numActions][RLGC::Action::ELEM_AMOUNT]
+		};
+
+		struct LayerDesc {
+			int32_t stack; // STACK_SHARED_HEAD or STACK_POLICY
+			int32_t numInputs, numOutputs;
+			int32_t flags; // LAYER_HAS_NORM and/or LAYER_ACTIVATE
+
+			uint64_t weightsOffset; // float[numOutputs][numInputs], the same layout as torch::nn::Linear
+			uint64_t biasesOffset; // float[numOutputs]
+			uint64_t normWeightsOffset, normBiasesOffset; // float[numOutputs] each, 0 without LAYER_HAS_NORM
+		};
+
+		// sharedHead can be NULL
+		// obsMean and obsInvSTD can be empty if obs aren't standardized
+		// actions is the output of the action parser for every action index
+		RG_IMEXPORT void Write(
+			std::filesystem::path path,
+			const MLPEngine* sharedHead, const MLPEngine& policy,
+			const std::vector<float>& obsMean, const std::vector<float>& obsInvSTD,
+			const std::vector<RLGC::Action>& actions
+		);
+	}
+}
@@ -0,0 +1,143 @@
+#include "PolicyRuntime.h"
+
+#include "PolicyFile.h"
+#include "MappedFile.h"
+#include <GigaLearnCPP/PPO/ActionSampler.h>
+
+GGL::PolicyRuntime::PolicyRuntime(std::filesystem::path path) {
+	constexpr const char* ERROR_PREFIX = "PolicyRuntime::PolicyRuntime(): ";
+	using namespace PolicyFile;
+
+	// The engines copy everything they need, so the mapping only lives until we're done loading
+	MappedFile file = MappedFile(path);
+
+	const Header* header = file.Get<Header>(0);
+	if (!header || memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is not a policy file");
+	if (header->version != VERSION)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is version " << header->version << ", but only version " << VERSION << " is supported, re-export it");
+	if (header->fileSize != file.size)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " is truncated or corrupt (expected " << header->fileSize << " bytes, got " << file.size << ")");
+
+	obsSize = header->obsSize;
+	numActions = header->numActions;
+	if (obsSize <= 0 || numActions <= 0 || header->numLayers <= 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has an invalid header");
+
+	auto fnGetFloats = [&](uint64_t offset, uint64_t count) {
+		const float* result = file.Get<float>(offset, count);
+		if (!result)
+			RG_ERR_CLOSE(ERROR_PREFIX << path << " has an out-of-bounds array (offset: " << offset << ", count: " << count << ")");
+		return result;
+	};
+
+	const LayerDesc* layerDescs = file.Get<LayerDesc>(header->layersOffset, header->numLayers);
+	if (!layerDescs)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has an out-of-bounds layer table");
+
+	auto activationType = (ModelActivationType)header->activationType;
+	for (int i = 0; i < header->numLayers; i++) {
+		const LayerDesc& desc = layerDescs[i];
+		if (desc.numInputs <= 0 || desc.numOutputs <= 0)
+			RG_ERR_CLOSE(ERROR_PREFIX << path << " has an invalid layer size");
+
+		MLPEngine*& engine = (desc.stack == STACK_SHARED_HEAD) ? sharedHeadEngine : policyEngine;
+		if (!engine)
+			engine = new MLPEngine(activationType);
+
+		bool hasNorm = desc.flags & LAYER_HAS_NORM;
+		engine->AddLayer(
+			desc.numInputs, desc.numOutputs,
+			fnGetFloats(desc.weightsOffset, (uint64_t)desc.numOutputs * desc.numInputs),
+			fnGetFloats(desc.biasesOffset, desc.numOutputs),
+			hasNorm ? fnGetFloats(desc.normWeightsOffset, desc.numOutputs) : NULL,
+			hasNorm ? fnGetFloats(desc.normBiasesOffset, desc.numOutputs) : NULL,
+			desc.flags & LAYER_ACTIVATE
+		);
+	}
+
+	if (!policyEngine)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has no policy layers");
+	int policyInputs = sharedHeadEngine ? sharedHeadEngine->GetNumOutputs() : obsSize;
+	if ((sharedHeadEngine && sharedHeadEngine->GetNumInputs() != obsSize) || policyEngine->GetNumInputs() != policyInputs || policyEngine->GetNumOutputs() != numActions)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has layer sizes that don't match the obs size and action count");
+
+	if (header->obsMeanOffset) {
+		const float* mean = fnGetFloats(header->obsMeanOffset, obsSize);
+		const float* invSTD = fnGetFloats(header->obsInvSTDOffset, obsSize);
+		obsMean.assign(mean, mean + obsSize);
+		obsInvSTD.assign(invSTD, invSTD + obsSize);
+	}
+
+	const RLGC::Action* actionTable = file.Get<RLGC::Action>(header->actionsOffset, numActions);
+	if (!actionTable)
+		RG_ERR_CLOSE(ERROR_PREFIX << path << " has an out-of-bounds action table");
+	actions.assign(actionTable, actionTable + numActions);
+}
+
+GGL::PolicyRuntime::~PolicyRuntime() {
+	delete sharedHeadEngine;
+	delete policyEngine;
+}
+
+void GGL::PolicyRuntime::BatchInferActionIndices(
+	const float* obs, int numRows, const uint8_t* actionMasks,
+	bool deterministic, float temperature,
+	int64_t* outActionIndices) const {
+
+	RG_ASSERT(numRows > 0);
+
+	// Per-thread, so several bots can share one runtime
+	// The shared head's output is the policy's input, so each engine needs its own buffers
+	thread_local std::vector<float> standardizedObs = {};
+	thread_local MLPEngine::Buffers sharedHeadBuffers = {}, policyBuffers = {};
+
+	const float* input = obs;
+	if (!obsMean.empty()) {
+		if (standardizedObs.size() < (size_t)numRows * obsSize)
+			standardizedObs.resize((size_t)numRows * obsSize);
+		for (int r = 0; r < numRows; r++) {
+			const float* __restrict rowIn = obs + (size_t)r * obsSize;
+			float* __restrict rowOut = standardizedObs.data() + (size_t)r * obsSize;
+			for (int i = 0; i < obsSize; i++)
+				rowOut[i] = (rowIn[i] - obsMean[i]) * obsInvSTD[i];
+		}
+		input = standardizedObs.data();
+	}
+
+	int inputStride = obsSize;
+	if (sharedHeadEngine) {
+		input = sharedHeadEngine->Forward(input, numRows, 0, sharedHeadBuffers);
+		inputStride = sharedHeadEngine->GetOutputStride();
+	}
+	const float* logits = policyEngine->Forward(input, numRows, inputStride, policyBuffers);
+
+	std::vector<uint8_t> allowAll;
+	if (!actionMasks) {
+		allowAll.assign((size_t)numRows * numActions, 1);
+		actionMasks = allowAll.data();
+	}
+
+	uint64_t seed = 0;
+	if (!deterministic) {
+		auto& randEngine = RocketSim::Math::GetRandEngine();
+		seed = ((uint64_t)randEngine() << 32) ^ randEngine();
+	}
+
+	ActionSampler::Sample(
+		logits, policyEngine->GetOutputStride(), actionMasks, numActions,
+		0, numRows, temperature, deterministic, seed,
+		outActionIndices, NULL
+	);
+}
+
+int GGL::PolicyRuntime::InferActionIndex(const FList& obs, const std::vector<uint8_t>* actionMask, bool deterministic, float temperature) const {
+	if (obs.size() != obsSize)
+		RG_ERR_CLOSE("PolicyRuntime: Obs builder produced an obs that differs from the exported obs size (expected: " << obsSize << ", got: " << obs.size() << ")");
+	if (actionMask && actionMask->size() != numActions)
+		RG_ERR_CLOSE("PolicyRuntime: Action mask size (" << actionMask->size() << ") doesn't match the exported action count (" << numActions << ")");
+
+	int64_t actionIndex;
+	BatchInferActionIndices(obs.data(), 1, actionMask ? actionMask->data() : NULL, deterministic, temperature, &actionIndex);
+	return (int)actionIndex;
+}
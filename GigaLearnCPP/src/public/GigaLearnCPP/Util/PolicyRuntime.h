@@ -0,0 +1,37 @@
+#pragma once
+
+#include "MLPEngine.h"
+
+namespace GGL {
+	// Runs a policy exported to a PolicyFile (see Learner::ExportPolicy()) without needing libtorch
+	// The network, obs standardization and action table all come from the file, only the obs builder is still needed
+	// Unlike InferUnit, obs are standardized the same way they were during training
+	// Inference is thread-safe, each thread uses its own buffers
+	class RG_IMEXPORT PolicyRuntime {
+	public:
+		int obsSize, numActions;
+		MLPEngine* sharedHeadEngine = NULL; // NULL if there is no shared head
+		MLPEngine* policyEngine = NULL;
+		std::vector<float> obsMean = {}, obsInvSTD = {}; // Empty if obs aren't standardized
+		std::vector<RLGC::Action> actions = {};
+
+		// Closes with an error if the file is missing, truncated, or from an incompatible version
+		PolicyRuntime(std::filesystem::path path);
+		RG_NO_COPY(PolicyRuntime);
+		~PolicyRuntime();
+
+		// obs are numRows rows of unstandardized obs from the obs builder, packed back-to-back
+		// actionMasks are packed the same way, and can be NULL to allow every action
+		void BatchInferActionIndices(
+			const float* obs, int numRows, const uint8_t* actionMasks,
+			bool deterministic, float temperature,
+			int64_t* outActionIndices
+		) const;
+
+		int InferActionIndex(const FList& obs, const std::vector<uint8_t>* actionMask, bool deterministic, float temperature = 1) const;
+
+		RLGC::Action InferAction(const FList& obs, const std::vector<uint8_t>* actionMask, bool deterministic, float temperature = 1) const {
+			return actions[InferActionIndex(obs, actionMask, deterministic, temperature)];
+		}
+	};
+}
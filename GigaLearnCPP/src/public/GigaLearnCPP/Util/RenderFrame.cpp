@@ -0,0 +1,238 @@
+#include "RenderFrame.h"
+
+using namespace GGL::RenderFrame;
+
+namespace {
+	size_t GetFullFrameWords(int numCars, int numPads) {
+		return HEADER_WORDS + BALL_WORDS + numCars * CAR_WORDS + (numPads + 31) / 32;
+	}
+
+	struct WordWriter {
+		std::vector<uint32_t>& words;
+
+		void Add(uint32_t word) {
+			words.push_back(word);
+		}
+
+		void Add(float val) {
+			uint32_t word;
+			memcpy(&word, &val, sizeof(word));
+			words.push_back(word);
+		}
+
+		void Add(Vec vec) {
+			Add(vec.x);
+			Add(vec.y);
+			Add(vec.z);
+		}
+	};
+
+	struct WordReader {
+		const uint32_t* words;
+		size_t idx = 0;
+
+		uint32_t ReadWord() {
+			return words[idx++];
+		}
+
+		float ReadFloat() {
+			float val;
+			memcpy(&val, &words[idx++], sizeof(val));
+			return val;
+		}
+
+		Vec ReadVec() {
+			Vec vec;
+			vec.x = ReadFloat();
+			vec.y = ReadFloat();
+			vec.z = ReadFloat();
+			return vec;
+		}
+	};
+}
+
+GGL::RenderFrame::Frame GGL::RenderFrame::Frame::FromState(const RLGC::GameState& state) {
+	Frame frame = {};
+	frame.gameMode = state.lastArena ? state.lastArena->gameMode : GameMode::SOCCAR;
+	frame.ballPos = state.ball.pos;
+	frame.ballVel = state.ball.vel;
+	frame.ballAngVel = state.ball.angVel;
+
+	for (auto& player : state.players) {
+		Car car;
+		car.carId = player.carId;
+		car.team = player.team;
+		car.isDemoed = player.isDemoed;
+		car.isOnGround = player.isOnGround;
+		car.hasFlip = player.HasFlipOrJump();
+		car.ballTouched = player.ballTouchedStep;
+		car.boost = player.boost;
+		car.pos = player.pos;
+		car.forward = player.rotMat.forward;
+		car.right = player.rotMat.right;
+		car.up = player.rotMat.up;
+		car.vel = player.vel;
+		car.angVel = player.angVel;
+		frame.cars.push_back(car);
+	}
+
+	frame.boostPads = state.boostPads;
+	return frame;
+}
+
+std::vector<uint32_t> GGL::RenderFrame::Encode(const Frame& frame, uint32_t frameIdx) {
+	RG_ASSERT(frame.cars.size() <= UINT8_MAX && frame.boostPads.size() <= UINT16_MAX);
+
+	std::vector<uint32_t> words = {};
+	words.reserve(GetFullFrameWords(frame.cars.size(), frame.boostPads.size()));
+	WordWriter writer = { words };
+
+	writer.Add(MAGIC);
+	writer.Add(VERSION);
+	writer.Add(frameIdx);
+	writer.Add(frameIdx); // A full frame is its own keyframe
+	writer.Add((uint32_t)frame.gameMode | ((uint32_t)frame.cars.size() << 8) | ((uint32_t)frame.boostPads.size() << 16));
+
+	writer.Add(frame.ballPos);
+	writer.Add(frame.ballVel);
+	writer.Add(frame.ballAngVel);
+
+	for (auto& car : frame.cars) {
+		uint32_t teamAndFlags = (uint32_t)car.team;
+		if (car.isDemoed)
+			teamAndFlags |= CAR_DEMOED;
+		if (car.isOnGround)
+			teamAndFlags |= CAR_ON_GROUND;
+		if (car.hasFlip)
+			teamAndFlags |= CAR_HAS_FLIP;
+		if (car.ballTouched)
+			teamAndFlags |= CAR_BALL_TOUCHED;
+
+		writer.Add(car.carId);
+		writer.Add(teamAndFlags);
+		writer.Add(car.boost);
+		writer.Add(car.pos);
+		writer.Add(car.forward);
+		writer.Add(car.right);
+		writer.Add(car.up);
+		writer.Add(car.vel);
+		writer.Add(car.angVel);
+	}
+
+	size_t padsStart = words.size();
+	words.resize(padsStart + (frame.boostPads.size() + 31) / 32, 0);
+	for (int i = 0; i < frame.boostPads.size(); i++)
+		if (frame.boostPads[i])
+			words[padsStart + i / 32] |= 1u << (i % 32);
+
+	return words;
+}
+
+std::vector<uint32_t> GGL::RenderFrame::EncodeDelta(const std::vector<uint32_t>& fullFrame, const std::vector<uint32_t>& keyframe) {
+	if (fullFrame.size() != keyframe.size() || fullFrame.size() < HEADER_WORDS || fullFrame[4] != keyframe[4])
+		return {};
+
+	size_t numBodyWords = fullFrame.size() - HEADER_WORDS;
+	size_t numMaskWords = (numBodyWords + 31) / 32;
+
+	std::vector<uint32_t> delta = std::vector<uint32_t>(fullFrame.begin(), fullFrame.begin() + HEADER_WORDS);
+	delta[1] = VERSION | (FLAG_DELTA << 16);
+	delta[3] = keyframe[2];
+	delta.push_back(numBodyWords);
+
+	size_t maskStart = delta.size();
+	delta.resize(maskStart + numMaskWords, 0);
+	for (size_t i = 0; i < numBodyWords; i++) {
+		if (fullFrame[HEADER_WORDS + i] != keyframe[HEADER_WORDS + i]) {
+			delta[maskStart + i / 32] |= 1u << (i % 32);
+			delta.push_back(fullFrame[HEADER_WORDS + i]);
+		}
+	}
+
+	if (delta.size() >= fullFrame.size())
+		return {};
+	return delta;
+}
+
+bool GGL::RenderFrame::Decode(const void* data, size_t size, std::vector<uint32_t>& keyframe, Frame& outFrame, uint32_t& outFrameIdx) {
+	if (size % sizeof(uint32_t) != 0 || size < HEADER_WORDS * sizeof(uint32_t))
+		return false;
+
+	// Copied, since datagram buffers aren't necessarily aligned
+	std::vector<uint32_t> words = std::vector<uint32_t>(size / sizeof(uint32_t));
+	memcpy(words.data(), data, size);
+
+	if (words[0] != MAGIC || (words[1] & 0xFFFF) != VERSION)
+		return false;
+
+	uint32_t flags = words[1] >> 16;
+	int numCars = (words[4] >> 8) & 0xFF;
+	int numPads = words[4] >> 16;
+	size_t numFullWords = GetFullFrameWords(numCars, numPads);
+
+	std::vector<uint32_t> fullFrame;
+	if (flags & FLAG_DELTA) {
+		if (keyframe.size() != numFullWords || keyframe[2] != words[3] || keyframe[4] != words[4])
+			return false;
+
+		size_t numBodyWords = numFullWords - HEADER_WORDS;
+		size_t numMaskWords = (numBodyWords + 31) / 32;
+		if (words.size() < HEADER_WORDS + 1 + numMaskWords || words[HEADER_WORDS] != numBodyWords)
+			return false;
+
+		fullFrame = keyframe;
+		std::copy(words.begin(), words.begin() + HEADER_WORDS, fullFrame.begin());
+
+		const uint32_t* mask = &words[HEADER_WORDS + 1];
+		size_t changedIdx = HEADER_WORDS + 1 + numMaskWords;
+		for (size_t i = 0; i < numBodyWords; i++) {
+			if (mask[i / 32] & (1u << (i % 32))) {
+				if (changedIdx >= words.size())
+					return false;
+				fullFrame[HEADER_WORDS + i] = words[changedIdx++];
+			}
+		}
+		if (changedIdx != words.size())
+			return false;
+	} else {
+		if (words.size() != numFullWords)
+			return false;
+		fullFrame = std::move(words);
+	}
+
+	Frame frame = {};
+	WordReader reader = { fullFrame.data(), HEADER_WORDS };
+	frame.gameMode = (GameMode)(fullFrame[4] & 0xFF);
+	frame.ballPos = reader.ReadVec();
+	frame.ballVel = reader.ReadVec();
+	frame.ballAngVel = reader.ReadVec();
+
+	for (int i = 0; i < numCars; i++) {
+		Car car;
+		car.carId = reader.ReadWord();
+		uint32_t teamAndFlags = reader.ReadWord();
+		car.team = (Team)(teamAndFlags & 0xFF);
+		car.isDemoed = teamAndFlags & CAR_DEMOED;
+		car.isOnGround = teamAndFlags & CAR_ON_GROUND;
+		car.hasFlip = teamAndFlags & CAR_HAS_FLIP;
+		car.ballTouched = teamAndFlags & CAR_BALL_TOUCHED;
+		car.boost = reader.ReadFloat();
+		car.pos = reader.ReadVec();
+		car.forward = reader.ReadVec();
+		car.right = reader.ReadVec();
+		car.up = reader.ReadVec();
+		car.vel = reader.ReadVec();
+		car.angVel = reader.ReadVec();
+		frame.cars.push_back(car);
+	}
+
+	frame.boostPads.resize(numPads);
+	for (int i = 0; i < numPads; i++)
+		frame.boostPads[i] = fullFrame[reader.idx + i / 32] & (1u << (i % 32));
+
+	outFrameIdx = fullFrame[2];
+	outFrame = std::move(frame);
+	if (!(flags & FLAG_DELTA))
+		keyframe = std::move(fullFrame);
+	return true;
+}
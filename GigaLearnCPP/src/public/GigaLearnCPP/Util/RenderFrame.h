@@ -0,0 +1,56 @@
+#pragma once
+#include "../Framework.h"
+#include <RLGymCPP/Gamestates/GameState.h>
+
+// Compact binary render frames, for streaming gamestates to a viewer over UDP
+// A frame is one datagram, made of 32-bit words in host byte order (little-endian on everything we run on):
+//	Header: MAGIC, VERSION | (flags << 16), frame index, keyframe index, game mode | (num cars << 8) | (num boost pads << 16)
+//	Full body: the ball (BALL_WORDS), each car (CAR_WORDS), then the boost pads as a bitset
+//	Delta body: the full body's word count, a bitmask of the words that differ from the keyframe's body, then just those words
+// Deltas are always against the last keyframe rather than the previous frame, so a lost datagram only loses that one frame
+namespace GGL {
+	namespace RenderFrame {
+		constexpr uint32_t MAGIC = 0x52464747; // "GGFR"
+		constexpr uint32_t VERSION = 1;
+
+		constexpr uint32_t FLAG_DELTA = 1 << 0;
+
+		constexpr int HEADER_WORDS = 5;
+		constexpr int BALL_WORDS = 3 * 3; // Pos, vel, ang vel
+		constexpr int CAR_WORDS = 3 + 6 * 3; // ID, team and flags, boost, pos, forward, right, up, vel, ang vel
+
+		// Bits of a car's team and flags word, the team is in the low byte
+		constexpr uint32_t
+			CAR_DEMOED = 1 << 8,
+			CAR_ON_GROUND = 1 << 9,
+			CAR_HAS_FLIP = 1 << 10,
+			CAR_BALL_TOUCHED = 1 << 11;
+
+		struct Car {
+			uint32_t carId;
+			Team team;
+			bool isDemoed, isOnGround, hasFlip, ballTouched;
+			float boost; // 0-100
+			Vec pos, forward, right, up, vel, angVel;
+		};
+
+		struct Frame {
+			GameMode gameMode = GameMode::SOCCAR;
+			Vec ballPos, ballVel, ballAngVel;
+			std::vector<Car> cars = {};
+			std::vector<bool> boostPads = {};
+
+			static Frame FromState(const RLGC::GameState& state);
+		};
+
+		std::vector<uint32_t> Encode(const Frame& frame, uint32_t frameIdx);
+
+		// Returns a delta of a full frame against a keyframe (both from Encode())
+		// Returns an empty list if they have different layouts, or if the delta wouldn't be any smaller
+		std::vector<uint32_t> EncodeDelta(const std::vector<uint32_t>& fullFrame, const std::vector<uint32_t>& keyframe);
+
+		// Decodes a full or delta frame, decoding a full frame also makes it the new keyframe
+		// Returns false if the frame is malformed, or if it is a delta against a different keyframe (i.e. the keyframe was lost)
+		bool Decode(const void* data, size_t size, std::vector<uint32_t>& keyframe, Frame& outFrame, uint32_t& outFrameIdx);
+	}
+}
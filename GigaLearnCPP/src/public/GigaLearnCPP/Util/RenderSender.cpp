@@ -2,99 +2,108 @@
 
 #include <nlohmann/json.hpp>
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET SocketHandle;
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#endif
+
 using namespace nlohmann;
 using namespace RLGC;
 
-GGL::RenderSender::RenderSender(float timeScale) : timeScale(timeScale) {
-	RG_LOG("Initializing RenderSender...");
+GGL::RenderSender::RenderSender(float timeScale, RenderFormat format, std::string address, int port, float sendRate) :
+	timeScale(timeScale), format(format), address(address), port(port), sendRate(sendRate) {
+	constexpr const char* ERROR_PREFIX = "RenderSender: ";
 
-	try {
-		RG_LOG("Current dir: " << std::filesystem::current_path());
-		pyMod = pybind11::module::import("python_scripts.render_receiver");
-	} catch (std::exception& e) {
-		RG_ERR_CLOSE("RenderSender: Failed to import render receiver, exception: " << e.what());
-	}
+	RG_LOG("Initializing RenderSender...");
 
-	RG_LOG(" > RenderSender initalized.");
+	if (port <= 0 || port > UINT16_MAX)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Invalid port " << port);
+	if (sendRate <= 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Send rate must be positive");
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to initialize Winsock");
+#endif
+
+	in_addr destIP;
+	if (inet_pton(AF_INET, address.c_str(), &destIP) != 1)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Invalid IPv4 address \"" << address << "\"");
+	_destIP = destIP.s_addr;
+
+	SocketHandle sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#ifdef _WIN32
+	if (sock == INVALID_SOCKET)
+#else
+	if (sock < 0)
+#endif
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to create UDP socket");
+	_socket = (uint64_t)sock;
+
+	_thread = std::thread(&RenderSender::_Run, this);
+
+	RG_LOG(" > RenderSender initalized, sending to " << address << ":" << port << ".");
 }
 
 FList VecToList(const Vec& vec) {
 	return FList({ vec.x, vec.y, vec.z });
 }
 
-json PhysToJSON(const PhysState& obj) {
+// Same layout that RocketSimVis reads
+json FrameToJSON(const GGL::RenderFrame::Frame& frame) {
 	json j = {};
-
-	j["pos"] = VecToList(obj.pos);
-
-	j["forward"] = VecToList(obj.rotMat.forward);
-	j["right"] = VecToList(obj.rotMat.right);
-	j["up"] = VecToList(obj.rotMat.up);
-
-	j["vel"] = VecToList(obj.vel);
-	j["ang_vel"] = VecToList(obj.angVel);
-
-	return j;
-}
-
-json PlayerToJSON(const Player& player) {
-	json j = {};
-
-	j["car_id"] = player.carId;
-	j["team_num"] = (int)player.team;
-	j["phys"] = PhysToJSON(player);
-	j["is_demoed"] = player.isDemoed;
-	j["on_ground"] = player.isOnGround;
-	j["ball_touched"] = player.ballTouchedStep;
-	j["has_flip"] = player.HasFlipOrJump();
-	j["boost_amount"] = player.boost / 100;
-
-	return j;
-}
-
-json GameStateToJSON(const GameState& state) {
-	json j = {};
-	
-	j["ball"] = PhysToJSON(state.ball);
-
-	std::vector<json> players;
-	for (auto& player : state.players)
-		players.push_back(PlayerToJSON(player));
-
-	j["players"] = players;
-	j["boost_pads"] = state.boostPads;
-
-	return j;
-}
-
-std::vector<json> ActionSetToJSON(const std::vector<Action>& actions) {
-	std::vector<json> js = {};
-	for (auto& action : actions) {
-		FList vals  = FList(action.begin(), action.end());
-		js.push_back(json(vals));
+	j["gamemode"] = GAMEMODE_STRS[(int)frame.gameMode];
+
+	json ballJ = {};
+	ballJ["pos"] = VecToList(frame.ballPos);
+	ballJ["vel"] = VecToList(frame.ballVel);
+	ballJ["ang_vel"] = VecToList(frame.ballAngVel);
+	j["ball_phys"] = ballJ;
+
+	std::vector<json> cars = {};
+	for (auto& car : frame.cars) {
+		json physJ = {};
+		physJ["pos"] = VecToList(car.pos);
+		physJ["forward"] = VecToList(car.forward);
+		physJ["right"] = VecToList(car.right);
+		physJ["up"] = VecToList(car.up);
+		physJ["vel"] = VecToList(car.vel);
+		physJ["ang_vel"] = VecToList(car.angVel);
+
+		json carJ = {};
+		carJ["car_id"] = car.carId;
+		carJ["team_num"] = (int)car.team;
+		carJ["phys"] = physJ;
+		carJ["is_demoed"] = car.isDemoed;
+		carJ["on_ground"] = car.isOnGround;
+		carJ["ball_touched"] = car.ballTouched;
+		carJ["has_flip"] = car.hasFlip;
+		carJ["boost_amount"] = car.boost / 100;
+		cars.push_back(carJ);
 	}
+	j["cars"] = cars;
+	j["boost_pad_states"] = frame.boostPads;
 
-	return js;
+	return j;
 }
 
 void GGL::RenderSender::Send(const GameState& state) {
-	json j = {};
-	j["gamemode"] = state.lastArena ? GAMEMODE_STRS[(int)state.lastArena->gameMode] : "soccar";
-	j["state"] = GameStateToJSON(state);
-
-	std::vector<Action> actions = {};
-	for (auto& player : state.players)
-		actions.push_back(player.prevAction);
-
-	j["actions"] = ActionSetToJSON(actions);
-	
-	std::string jStr = j.dump();
-
-	try {
-		pyMod.attr("render_state")(jStr);
-	} catch (std::exception& e) {
-		RG_ERR_CLOSE("RenderSender: Failed to send gamestate, exception: " << e.what());
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_latestFrame = RenderFrame::Frame::FromState(state);
+		_hasNewFrame = true;
 	}
+	_cv.notify_one();
 
 	// Delay
 	{
@@ -122,4 +131,84 @@ void GGL::RenderSender::Send(const GameState& state) {
 	}
 }
 
-GGL::RenderSender::~RenderSender() {}
\ No newline at end of file
+void GGL::RenderSender::_Run() {
+	sockaddr_in destAddr = {};
+	destAddr.sin_family = AF_INET;
+	destAddr.sin_port = htons((uint16_t)port);
+	destAddr.sin_addr.s_addr = _destIP;
+
+	auto sendInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / sendRate));
+	auto nextSendTime = std::chrono::steady_clock::now();
+
+	uint32_t frameIdx = 0;
+	std::vector<uint32_t> keyframe = {};
+	bool warnedSendFailed = false;
+
+	while (true) {
+		RenderFrame::Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+
+			// Frames that arrive faster than the send rate are skipped, only the latest one is sent
+			_cv.wait_until(lock, nextSendTime, [&] { return _stop; });
+			if (_stop)
+				break;
+			_cv.wait(lock, [&] { return _hasNewFrame || _stop; });
+			if (_stop)
+				break;
+
+			frame = std::move(_latestFrame);
+			_hasNewFrame = false;
+		}
+		nextSendTime = std::chrono::steady_clock::now() + sendInterval;
+
+		std::string jsonStr;
+		std::vector<uint32_t> words;
+		const char* data;
+		size_t size;
+		if (format == RenderFormat::BINARY) {
+			words = RenderFrame::Encode(frame, frameIdx);
+			std::vector<uint32_t> delta = {};
+			if (frameIdx % keyframeInterval != 0)
+				delta = RenderFrame::EncodeDelta(words, keyframe);
+
+			// Every full frame becomes the receiver's keyframe
+			if (delta.empty()) {
+				keyframe = words;
+			} else {
+				words = std::move(delta);
+			}
+			frameIdx++;
+
+			data = (const char*)words.data();
+			size = words.size() * sizeof(uint32_t);
+		} else {
+			jsonStr = FrameToJSON(frame).dump();
+			data = jsonStr.data();
+			size = jsonStr.size();
+		}
+
+		// Nothing may be listening, which is fine, so failures are only reported once
+		int64_t sentSize = sendto((SocketHandle)_socket, data, (int)size, 0, (sockaddr*)&destAddr, sizeof(destAddr));
+		if (sentSize != size && !warnedSendFailed) {
+			RG_LOG("RenderSender: WARNING: Failed to send a " << size << "-byte frame to " << address << ":" << port);
+			warnedSendFailed = true;
+		}
+	}
+}
+
+GGL::RenderSender::~RenderSender() {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_one();
+	_thread.join();
+
+#ifdef _WIN32
+	closesocket((SocketHandle)_socket);
+	WSACleanup();
+#else
+	close((SocketHandle)_socket);
+#endif
+}
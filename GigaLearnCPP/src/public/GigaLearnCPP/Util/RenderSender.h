@@ -1,24 +1,48 @@
 #pragma once
 #include "Report.h"
-#include <pybind11/pybind11.h>
+#include "RenderFrame.h"
 #include <RLGymCPP/Gamestates/GameState.h>
 #include <RLGymCPP/BasicTypes/Action.h>
 #include <GigaLearnCPP/Util/Timer.h>
+#include <GigaLearnCPP/LearnerConfig.h>
+
+#include <condition_variable>
 
 namespace GGL {
+	// Streams gamestates to a viewer over UDP
+	// Frames are encoded and sent on a background thread at a fixed rate, so rendering never waits on the network
 	struct RG_IMEXPORT RenderSender {
-		pybind11::module pyMod;
-
 		float timeScale;
+		RenderFormat format;
+		std::string address;
+		int port;
+		float sendRate;
+
+		// With the binary format, a full frame is sent this often, and deltas against it are sent in between
+		int keyframeInterval = 30;
+
 		double adaptiveRenderDelay = -1;
 		Timer renderTimer = {};
 
-		RenderSender(float timeScale);
+		RenderSender(float timeScale, RenderFormat format = RenderFormat::ROCKETSIMVIS_JSON, std::string address = "127.0.0.1", int port = 9273, float sendRate = 60);
 
 		RG_NO_COPY(RenderSender);
 
+		// Hands the state to the sender thread, then sleeps to keep the game running at timeScale
 		void Send(const RLGC::GameState& state);
 
 		~RenderSender();
+
+	private:
+		std::thread _thread;
+		std::mutex _mutex = {};
+		std::condition_variable _cv = {};
+		RenderFrame::Frame _latestFrame = {};
+		bool _hasNewFrame = false, _stop = false;
+
+		uint64_t _socket; // Platform socket handle
+		uint32_t _destIP; // Network byte order
+
+		void _Run();
 	};
-}
\ No newline at end of file
+}
@@ -1,5 +1,14 @@
 #include "Utils.h"
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 std::set<int64_t> GGL::Utils::FindNumberedDirs(std::filesystem::path basePath) {
 	std::set<int64_t> results = {};
 
@@ -24,4 +33,34 @@ std::set<int64_t> GGL::Utils::FindNumberedDirs(std::filesystem::path basePath) {
 	}
 
 	return results;
-}
\ No newline at end of file
+}
+
+void GGL::Utils::SyncToDisk(std::filesystem::path path, bool recursive) {
+	constexpr const char* ERROR_PREFIX = "Utils::SyncToDisk(): ";
+
+	bool isDir = std::filesystem::is_directory(path);
+	if (isDir && recursive)
+		for (auto& entry : std::filesystem::directory_iterator(path))
+			SyncToDisk(entry.path());
+
+#ifdef _WIN32
+	// Folder entries are flushed with the files on Windows, and folders can't be opened for writing
+	if (isDir)
+		return;
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to open " << path);
+	bool flushed = FlushFileBuffers(file);
+	CloseHandle(file);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd == -1)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to open " << path);
+	bool flushed = fsync(fd) == 0;
+	close(fd);
+#endif
+
+	if (!flushed)
+		RG_ERR_CLOSE(ERROR_PREFIX << "Failed to flush " << path);
+}
@@ -26,6 +26,10 @@ namespace GGL {
 
 		std::set<int64_t> FindNumberedDirs(std::filesystem::path basePath);
 
+		// Flushes a file or folder from the OS cache to disk, and everything inside a folder if recursive
+		// Closes with an error if anything can't be flushed
+		void SyncToDisk(std::filesystem::path path, bool recursive = true);
+
 		template <typename T>
 		std::string NumToStr(T val) {
 			// https://stackoverflow.com/a/7277333
@@ -0,0 +1,46 @@
+// Example RLBot bot that runs a policy exported with Learner::ExportPolicy() (or LearnerConfig::exportPolicyOnSave)
+// Only needs RLGymCPP and the GGLPolicyRuntime library, not libtorch or GigaLearnCPP
+// Usage: GigaLearnRuntimeBot [-policy <path to POLICY.gglp>]
+//	By default, the policy is loaded from next to the executable
+
+#include "RuntimeRLBotClient.h"
+
+#include <GigaLearnCPP/Util/Timer.h>
+#include <RLGymCPP/ObsBuilders/AdvancedObs.h>
+#include <RLGymCPP/ActionParsers/DefaultAction.h>
+#include <rlbot/platform.h>
+
+using namespace GGL;
+using namespace RLGC;
+
+int main(int argc, char* argv[]) {
+	std::filesystem::path policyPath = std::filesystem::path(rlbot::platform::GetExecutableDirectory()) / "POLICY.gglp";
+
+	// RLBot also passes its own arguments (like -dll-path), so skip anything we don't know
+	for (int i = 1; i < argc - 1; i++)
+		if (std::string(argv[i]) == "-policy")
+			policyPath = argv[i + 1];
+
+	Timer loadTimer = {};
+	PolicyRuntime* policy = new PolicyRuntime(policyPath);
+	RG_LOG(
+		"Loaded policy " << policyPath << " in " << (loadTimer.Elapsed() * 1000) << "ms " <<
+		"(obs size: " << policy->obsSize << ", actions: " << policy->numActions << ", kernels: " << MLPEngine::GetKernelName() << ")"
+	);
+
+	// These must match the obs builder, action parser, tick skip and action delay used in training
+	RuntimeRLBotParams params = {};
+	params.port = 42653; // Same as rlbot/port.cfg
+	params.tickSkip = 8;
+	params.actionDelay = params.tickSkip - 1;
+	params.policy = policy;
+	params.obsBuilder = new AdvancedObs();
+	params.maskParser = new DefaultAction();
+
+	RuntimeRLBotClient::Run(params);
+
+	delete params.obsBuilder;
+	delete params.maskParser;
+	delete policy;
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <rlbot/bot.h>
+#include <RLGymCPP/ObsBuilders/ObsBuilder.h>
+#include <RLGymCPP/ActionParsers/ActionParser.h>
+#include <GigaLearnCPP/Util/PolicyRuntime.h>
+
+// Same as RLBotClient, but runs a policy exported with Learner::ExportPolicy() through PolicyRuntime, so no libtorch is needed
+struct RuntimeRLBotParams {
+	// Set this to the same port used in rlbot/port.cfg
+	int port;
+
+	int tickSkip; // Your tick skip
+	int actionDelay; // Your action delay
+
+	GGL::PolicyRuntime* policy = NULL;
+	RLGC::ObsBuilder* obsBuilder = NULL; // Must be the obs builder the policy was trained with
+	RLGC::ActionParser* maskParser = NULL; // Optional, only used for action masks (actions themselves come from the policy file)
+};
+
+class RuntimeRLBotBot : public rlbot::Bot {
+public:
+
+	// Parameters to define the bot
+	RuntimeRLBotParams params;
+
+	// Queued action and current action
+	RLGC::Action
+		action = {},
+		controls = {};
+
+	// Persistent info
+	bool updateAction = true;
+	float prevTime = 0;
+	int ticks = -1;
+
+	RuntimeRLBotBot(int _index, int _team, std::string _name, const RuntimeRLBotParams& params);
+
+	rlbot::Controller GetOutput(rlbot::GameTickPacket gameTickPacket) override;
+};
+
+namespace RuntimeRLBotClient {
+	void Run(const RuntimeRLBotParams& params);
+}